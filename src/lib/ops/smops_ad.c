@@ -1,42 +1,25 @@
 #include <stdlib.h>
-#include <omp.h>
 #include <time.h>
 
 #include "../smops.h"
 
 #define OP ADD
 
-void sequential_add_to_dense_elem(MATRIX_DATA *dense_matrix, MATRIX_DATA elem, TYPE type, int pos)
-{
-    switch(type) {
-        case FLOAT:
-            dense_matrix[pos].f += elem.f;
-            break;
-        case INT:
-            dense_matrix[pos].i += elem.i;
-            break;
-        default:
-            break;
-    }
-}
-
 /** Adds the element to dense matrix arbitrary to type
 *
 *   paramaters:
 *       MATRIX_DATA *dense_matrix: the dense matrix where the element is added
 *       MATRIX_DATA elem: the element to add
 *       TYPE: the type the data is
-*       int pos: the 1D position of the element being added
+*       size_t pos: the 1D position of the element being added
 */
-void parallel_add_to_dense_elem(MATRIX_DATA *dense_matrix, MATRIX_DATA elem, TYPE type, int pos)
+void add_to_dense_elem(MATRIX_DATA *dense_matrix, MATRIX_DATA elem, TYPE type, size_t pos)
 {
     switch(type) {
         case FLOAT:
-            #pragma omp atomic
             dense_matrix[pos].f += elem.f;
             break;
         case INT:
-            #pragma omp atomic
             dense_matrix[pos].i += elem.i;
             break;
         default:
@@ -44,58 +27,44 @@ void parallel_add_to_dense_elem(MATRIX_DATA *dense_matrix, MATRIX_DATA elem, TYP
     }
 }
 
-void sequential_addition(MATRIX_DATA *dense_matrix, CSR_DATA *csr_a, CSR_DATA *csr_b,
-                        TYPE type, int rows)
-{
-    int p_a, q_a, p_b, q_b;
-    for(int r = 1; r < rows + 1; r++) {
-        p_a = csr_a->ia[r-1];
-        q_a = csr_a->ia[r];
-        for(int i = p_a; i < q_a; i++) {
-            sequential_add_to_dense_elem(dense_matrix, csr_a->nnz[i], type, (r-1)*rows + csr_a->ja[i]);
-        }
-
-        p_b = csr_b->ia[r-1];
-        q_b = csr_b->ia[r];
-        for(int i = p_b; i < q_b; i++) {
-            sequential_add_to_dense_elem(dense_matrix, csr_b->nnz[i], type, (r-1)*rows + csr_b->ja[i]);
-        }
-    }
-}
-
-void parallel_addition(SMOPS_CTX *ctx, MATRIX_DATA *dense_matrix, CSR_DATA *csr_a,
-                        CSR_DATA *csr_b, TYPE type, int rows)
+/** Arguments of addition_task
+*   copies: how many times every element is added, 2 when a matrix is added to itself
+*/
+struct addition_args {
+    MATRIX_DATA *dense_matrix;
+    CSR_DATA *csr;
+    CSR_SPLIT *splits;
+    TYPE type;
+    int rows;
+    int cols;
+    int copies;
+};
+
+/** Adds the merge path parts p to q of a CSR matrix into the dense matrix. Every
+*   non zero element is in one part and has its own element of the result, so a
+*   row split between parts needs no atomics.
+*
+*   paramaters:
+*       void *arg: the struct addition_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void addition_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
 {
-    MATRIX_DATA *a_nnz = csr_a->nnz;
-    int *a_ia = csr_a->ia;
-    int *a_ja = csr_a->ja;
-
-    MATRIX_DATA *b_nnz = csr_b->nnz;
-    int *b_ia = csr_b->ia;
-    int *b_ja = csr_b->ja;
-
-    #pragma omp parallel num_threads(ctx->thread_num) firstprivate(type, rows)
-    {
-        #pragma omp single
-        {
-            int p_a, q_a, p_b, q_b;
-            for(int r = 1; r < rows + 1; r++) {
-                #pragma omp task firstprivate(r)
-                {
-                    p_a = a_ia[r-1];
-                    q_a = a_ia[r];
-                    for(int i = p_a; i < q_a; i++) {
-                        parallel_add_to_dense_elem(dense_matrix, a_nnz[i], type, (r-1)*rows + a_ja[i]);
-                    }
-                }
-
-                #pragma omp task firstprivate(r)
-                {
-                    p_b = b_ia[r-1];
-                    q_b = b_ia[r];
-                    for(int i = p_b; i < q_b; i++) {
-                        parallel_add_to_dense_elem(dense_matrix, b_nnz[i], type, (r-1)*rows + b_ja[i]);
-                    }
+    struct addition_args *a = (struct addition_args *)arg;
+    CSR_DATA *csr = a->csr;
+    CSR_SPLIT start, end;
+    SMOPS_INDEX first, last;
+    for(SMOPS_INDEX k = p; k < q; k++) {
+        start = a->splits[k];
+        end = a->splits[k+1];
+        for(int r = start.row; r <= end.row && r < a->rows; r++) {
+            first = CSR_ROW(csr, r) > start.nz ? CSR_ROW(csr, r) : start.nz;
+            last = CSR_ROW(csr, r+1) < end.nz ? CSR_ROW(csr, r+1) : end.nz;
+            for(SMOPS_INDEX i = first; i < last; i++) {
+                for(int c = 0; c < a->copies; c++) {
+                    add_to_dense_elem(a->dense_matrix, csr->nnz[i], a->type, (size_t)r*a->cols + CSR_COL(csr, i));
                 }
             }
         }
@@ -118,24 +87,63 @@ int addition(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
     TYPE type = matrix_a->type;
 
     int rows = matrix_a->rows;
-    int size = matrix_a->size;
+    int64_t size = matrix_a->size;
 
     CSR_DATA *csr_a = matrix_a->csr_data;
     CSR_DATA *csr_b = matrix_b->csr_data;
 
-    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)calloc(size, sizeof(MATRIX_DATA));
+    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)POOL_calloc(ctx, size, sizeof(MATRIX_DATA));
     if(dense_matrix == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dense matrix in addition");
         return 0;
     }
 
-    switch(ctx->thread_num) {
-        case 1:
-            sequential_addition(dense_matrix, csr_a, csr_b, type, rows);
-            break;
-        default:
-            parallel_addition(ctx, dense_matrix, csr_a, csr_b, type, rows);
-            break;
+    if(matrix_a->format == DENSE) {
+        DENSE_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+    if(matrix_a->format == BCSR) {
+        BCSR_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+    if(matrix_a->format == DIA) {
+        DIA_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+    if(matrix_a->format == BITMAP) {
+        BITMAP_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+    if(matrix_a->format == CSRDU) {
+        CSRDU_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+    if(matrix_a->format == DCSR) {
+        DCSR_addition(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
+        return 1;
+    }
+
+    //One matrix at a time, as an element of a and of b would share an element of the result.
+    //A matrix added to itself is walked once adding every element twice.
+    CSR_DATA *csr[] = { csr_a, csr_b };
+    int aliased = MATRIX_aliases(matrix_a, matrix_b);
+    struct addition_args args = { dense_matrix, NULL, NULL, type, rows, matrix_a->cols, aliased ? 2 : 1 };
+    int parts;
+    for(int m = 0; m < (aliased ? 1 : 2); m++) {
+        parts = POOL_merge_path(ctx, csr[m], rows, &args.splits);
+        if(parts == 0) {
+            free(dense_matrix);
+            return 0;
+        }
+        args.csr = csr[m];
+        POOL_parallel_for(ctx, parts, 1, addition_task, &args);
+        free(args.splits);
     }
 
     SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows, matrix_a->cols);
@@ -158,8 +166,28 @@ int MATRIX_OP_addition(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
     struct timespec start, end;
     clock_gettime(CLOCK_REALTIME, &start);
 
-    if(OPS_check_format(ctx, matrix_a, OP, NONE) == 0) {return 0;}
-    if(OPS_check_format(ctx, matrix_b, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_a, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_b, OP, NONE) == 0) {return 0;}
+
+    //If either matrix was dense enough to be loaded as DENSE then both use the dense engine
+    if(matrix_a->format == DENSE || matrix_b->format == DENSE) {
+        if(MATRIX_convert(ctx, matrix_a, DENSE) == 0) {return 0;}
+        if(MATRIX_convert(ctx, matrix_b, DENSE) == 0) {return 0;}
+    }
+    //A banded matrix only keeps DIA if the other one is banded too
+    if(DIA_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    //Likewise a matrix with dense blocks brings the other one into BCSR with its block size
+    if(BCSR_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    //A matrix with semi-dense tiles brings a CSR, DCSR or CSRDU matrix into BITMAP
+    if(BITMAP_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    //A large matrix with compressed columns brings a CSR or DCSR matrix into CSRDU
+    if(CSRDU_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    //What is left is CSR or DCSR, a hypersparse matrix brings the other one into DCSR
+    if(DCSR_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix_a, OP, DENSE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix_b, OP, DENSE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix_a, matrix_b);
 
     if(matrix_a->rows != matrix_b->rows || matrix_a->cols != matrix_b->cols) {
         SMOPS_CTX_fill_err_msg(ctx, "input matrices for addition do not have same dimensions");
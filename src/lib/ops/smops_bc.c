@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../smops.h"
+
+#define BC_ROW_CHUNK 16
+
+/** Defines a kernel adding the blocks in the block rows p to q of a BCSR matrix
+*   with a block size of B into a dense matrix. B is a constant so the block loops
+*   are fully unrolled, blocks hanging over the last row or column are added
+*   element by element.
+*
+*   kernel parameters:
+*       MATRIX_DATA *dense: the dense matrix (rows x cols) the blocks are added to
+*       BCSR_DATA *bcsr: the BCSR_DATA of the matrix
+*       int rows: the number of rows in the matrix
+*       int cols: the number of columns in the matrix
+*       int p: the first block row
+*       int q: the block row after the last block row
+*/
+#define DEFINE_BCSR_ADD_KERNEL(NAME, FIELD, B) \
+void NAME(MATRIX_DATA *dense, BCSR_DATA *bcsr, int rows, int cols, int p, int q) \
+{ \
+    MATRIX_DATA *blk, *d; \
+    int r0, c0, i, j; \
+    for(int b_row = p; b_row < q; b_row++) { \
+        r0 = b_row*B; \
+        for(int n = bcsr->ia[b_row]; n < bcsr->ia[b_row+1]; n++) { \
+            c0 = bcsr->ja[n]*B; \
+            blk = bcsr->nnz + (size_t)n*B*B; \
+            if(r0 + B <= rows && c0 + B <= cols) { \
+                for(i = 0; i < B; i++) { \
+                    d = dense + (size_t)(r0 + i)*cols + c0; \
+                    for(j = 0; j < B; j++) { \
+                        d[j].FIELD += blk[i*B + j].FIELD; \
+                    } \
+                } \
+            } else { \
+                for(i = 0; i < B && r0 + i < rows; i++) { \
+                    for(j = 0; j < B && c0 + j < cols; j++) { \
+                        dense[(size_t)(r0 + i)*cols + c0 + j].FIELD += blk[i*B + j].FIELD; \
+                    } \
+                } \
+            } \
+        } \
+    } \
+}
+
+DEFINE_BCSR_ADD_KERNEL(float_bcsr_add_b2, f, 2)
+DEFINE_BCSR_ADD_KERNEL(float_bcsr_add_b3, f, 3)
+DEFINE_BCSR_ADD_KERNEL(float_bcsr_add_b4, f, 4)
+
+DEFINE_BCSR_ADD_KERNEL(int_bcsr_add_b2, i, 2)
+DEFINE_BCSR_ADD_KERNEL(int_bcsr_add_b3, i, 3)
+DEFINE_BCSR_ADD_KERNEL(int_bcsr_add_b4, i, 4)
+
+typedef void (*BCSR_ADD_KERNEL)(MATRIX_DATA *, BCSR_DATA *, int, int, int, int);
+
+/** Defines a kernel multiplying the block rows p to q of the BCSR matrix a with
+*   the BCSR matrix b into the padded dense matrix c (c += a*b). Every pair of
+*   blocks is a fully unrolled B x B x B block multiply.
+*
+*   kernel parameters:
+*       MATRIX_DATA *c: the padded dense result (block rows of a*B x ldc)
+*       BCSR_DATA *a: the BCSR_DATA of the left matrix
+*       BCSR_DATA *b: the BCSR_DATA of the right matrix
+*       int ldc: the number of columns in c, block columns of b*B
+*       int p: the first block row of a
+*       int q: the block row after the last block row of a
+*/
+#define DEFINE_BCSR_GEMM_KERNEL(NAME, FIELD, ACC_T, B) \
+void NAME(MATRIX_DATA *c, BCSR_DATA *a, BCSR_DATA *b, int ldc, int p, int q) \
+{ \
+    MATRIX_DATA *a_blk, *b_blk, *c_blk; \
+    ACC_T a_ik; \
+    int b_k, i, k, j; \
+    for(int b_row = p; b_row < q; b_row++) { \
+        for(int n = a->ia[b_row]; n < a->ia[b_row+1]; n++) { \
+            b_k = a->ja[n]; \
+            a_blk = a->nnz + (size_t)n*B*B; \
+            for(int m = b->ia[b_k]; m < b->ia[b_k+1]; m++) { \
+                b_blk = b->nnz + (size_t)m*B*B; \
+                c_blk = c + (size_t)b_row*B*ldc + b->ja[m]*B; \
+                for(i = 0; i < B; i++) { \
+                    for(k = 0; k < B; k++) { \
+                        a_ik = a_blk[i*B + k].FIELD; \
+                        for(j = 0; j < B; j++) { \
+                            c_blk[(size_t)i*ldc + j].FIELD += a_ik*b_blk[k*B + j].FIELD; \
+                        } \
+                    } \
+                } \
+            } \
+        } \
+    } \
+}
+
+DEFINE_BCSR_GEMM_KERNEL(float_bcsr_gemm_b2, f, double, 2)
+DEFINE_BCSR_GEMM_KERNEL(float_bcsr_gemm_b3, f, double, 3)
+DEFINE_BCSR_GEMM_KERNEL(float_bcsr_gemm_b4, f, double, 4)
+
+DEFINE_BCSR_GEMM_KERNEL(int_bcsr_gemm_b2, i, int, 2)
+DEFINE_BCSR_GEMM_KERNEL(int_bcsr_gemm_b3, i, int, 3)
+DEFINE_BCSR_GEMM_KERNEL(int_bcsr_gemm_b4, i, int, 4)
+
+typedef void (*BCSR_GEMM_KERNEL)(MATRIX_DATA *, BCSR_DATA *, BCSR_DATA *, int, int, int);
+
+/** Makes sure both matrices use the BCSR engine with the same block size if either
+*   of them was loaded as BCSR. The block size of matrix_a is kept if it is BCSR.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int BCSR_reconcile(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if(matrix_a->format != BCSR && matrix_b->format != BCSR) {return 1;}
+    int block = matrix_a->format == BCSR ? matrix_a->bcsr_data->block : matrix_b->bcsr_data->block;
+    MATRIX *matrices[] = { matrix_a, matrix_b };
+    for(int i = 0; i < 2; i++) {
+        if(matrices[i]->format != BCSR || matrices[i]->bcsr_data->block != block) {
+            matrices[i]->stats.bcsr_block = block;
+            if(MATRIX_convert(ctx, matrices[i], BCSR) == 0) {return 0;}
+        }
+    }
+    return 1;
+}
+
+/** Gets the add kernel for the type and block size
+*
+*   parameters:
+*       TYPE type: the type of the matrix
+*       int block: the block size
+*
+*   return:
+*       the add kernel, NULL if the type is UNDEFINED
+*/
+BCSR_ADD_KERNEL bcsr_add_kernel(TYPE type, int block)
+{
+    BCSR_ADD_KERNEL float_kernels[] = { float_bcsr_add_b2, float_bcsr_add_b3, float_bcsr_add_b4 };
+    BCSR_ADD_KERNEL int_kernels[] = { int_bcsr_add_b2, int_bcsr_add_b3, int_bcsr_add_b4 };
+    switch(type) {
+        case FLOAT:
+            return float_kernels[block - BCSR_MIN_BLOCK];
+        case INT:
+            return int_kernels[block - BCSR_MIN_BLOCK];
+        default:
+            return NULL;
+    }
+}
+
+/** Arguments of bcsr_add_task */
+struct bcsr_add_args {
+    MATRIX_DATA *result;
+    BCSR_DATA *a;
+    BCSR_DATA *b;
+    BCSR_ADD_KERNEL kernel;
+    int rows;
+    int cols;
+};
+
+/** Adds the block rows p to q of both BCSR matrices into the dense result
+*
+*   parameters:
+*       void *arg: the struct bcsr_add_args
+*       SMOPS_INDEX p: the first block row
+*       SMOPS_INDEX q: the block row after the last block row
+*       int worker: unused
+*/
+void bcsr_add_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct bcsr_add_args *args = (struct bcsr_add_args *)arg;
+    args->kernel(args->result, args->a, args->rows, args->cols, (int)p, (int)q);
+    args->kernel(args->result, args->b, args->rows, args->cols, (int)p, (int)q);
+}
+
+/** Performs the addition result = matrix_a + matrix_b with both matrices in BCSR
+*   format with the same block size. Threads are given block rows so no two threads
+*   write to the same element of the result.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void BCSR_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    BCSR_DATA *a = matrix_a->bcsr_data;
+    BCSR_DATA *b = matrix_b->bcsr_data;
+    BCSR_ADD_KERNEL kernel = bcsr_add_kernel(matrix_a->type, a->block);
+    int rows = matrix_a->rows;
+    int cols = matrix_a->cols;
+    int block_rows = a->block_rows;
+
+    struct bcsr_add_args args = { result, a, b, kernel, rows, cols };
+    POOL_parallel_for(ctx, block_rows, BC_ROW_CHUNK, bcsr_add_task, &args);
+}
+
+/** Gets the block multiply kernel for the type and block size
+*
+*   parameters:
+*       TYPE type: the type of the matrix
+*       int block: the block size
+*
+*   return:
+*       the block multiply kernel, NULL if the type is UNDEFINED
+*/
+BCSR_GEMM_KERNEL bcsr_gemm_kernel(TYPE type, int block)
+{
+    BCSR_GEMM_KERNEL float_kernels[] = { float_bcsr_gemm_b2, float_bcsr_gemm_b3, float_bcsr_gemm_b4 };
+    BCSR_GEMM_KERNEL int_kernels[] = { int_bcsr_gemm_b2, int_bcsr_gemm_b3, int_bcsr_gemm_b4 };
+    switch(type) {
+        case FLOAT:
+            return float_kernels[block - BCSR_MIN_BLOCK];
+        case INT:
+            return int_kernels[block - BCSR_MIN_BLOCK];
+        default:
+            return NULL;
+    }
+}
+
+/** Arguments of bcsr_gemm_task */
+struct bcsr_gemm_args {
+    MATRIX_DATA *c;
+    BCSR_DATA *a;
+    BCSR_DATA *b;
+    BCSR_GEMM_KERNEL kernel;
+    int ldc;
+};
+
+/** Multiplies the block rows p to q of the left BCSR matrix into the dense result
+*
+*   parameters:
+*       void *arg: the struct bcsr_gemm_args
+*       SMOPS_INDEX p: the first block row
+*       SMOPS_INDEX q: the block row after the last block row
+*       int worker: unused
+*/
+void bcsr_gemm_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct bcsr_gemm_args *args = (struct bcsr_gemm_args *)arg;
+    args->kernel(args->c, args->a, args->b, args->ldc, (int)p, (int)q);
+}
+
+/** Performs the multiplication result = matrix_a*matrix_b with both matrices in
+*   BCSR format with the same block size. The blocks are multiplied into a dense
+*   matrix padded to whole blocks which is copied into the result when the
+*   dimensions are not multiples of the block size.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads and error handling
+*       MATRIX_DATA *result: the zeroed dense result matrix (rows of a x cols of b)
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int BCSR_multiplication(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    BCSR_DATA *a = matrix_a->bcsr_data;
+    BCSR_DATA *b = matrix_b->bcsr_data;
+    BCSR_GEMM_KERNEL kernel = bcsr_gemm_kernel(matrix_a->type, a->block);
+    int rows = matrix_a->rows;
+    int cols = matrix_b->cols;
+    int ldc = b->block_cols*b->block;
+    int block_rows = a->block_rows;
+    int padded = rows % a->block != 0 || cols % b->block != 0;
+
+    MATRIX_DATA *c = result;
+    if(padded) {
+        c = (MATRIX_DATA *)calloc((size_t)block_rows*a->block*ldc, sizeof(MATRIX_DATA));
+        if(c == NULL) {
+            SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for bcsr multiplication");
+            return 0;
+        }
+    }
+
+    struct bcsr_gemm_args args = { c, a, b, kernel, ldc };
+    POOL_parallel_for(ctx, block_rows, 1, bcsr_gemm_task, &args);
+
+    if(padded) {
+        for(int r = 0; r < rows; r++) {
+            memcpy(result + (size_t)r*cols, c + (size_t)r*ldc, sizeof(MATRIX_DATA)*cols);
+        }
+        free(c);
+    }
+    return 1;
+}
@@ -0,0 +1,227 @@
+#include <stdlib.h>
+#include <limits.h>
+
+#include "../smops.h"
+
+#define BM_ROW_CHUNK 8
+#define BM_ROW_BITS 0x0101010101010101ULL //the lowest bit of every tile row
+#define BM_ROW_GATHER 0x0102040810204080ULL //moves bit 8i to bit 56 + i
+
+/** Gets the columns of a tile with a non zero element by OR-ing its rows together
+*
+*   parameters:
+*       uint64_t mask: the mask of the tile
+*
+*   return:
+*       the 8 bit column occupancy of the tile
+*/
+static inline unsigned bitmap_col_bits(uint64_t mask)
+{
+    mask |= mask >> 32;
+    mask |= mask >> 16;
+    mask |= mask >> 8;
+    return (unsigned)(mask & 0xFF);
+}
+
+/** Gets the rows of a tile with a non zero element, every row is OR-ed into its
+*   lowest bit and the lowest bits are gathered into the top byte by a multiply
+*
+*   parameters:
+*       uint64_t mask: the mask of the tile
+*
+*   return:
+*       the 8 bit row occupancy of the tile
+*/
+static inline unsigned bitmap_row_bits(uint64_t mask)
+{
+    mask |= mask >> 4;
+    mask |= mask >> 2;
+    mask |= mask >> 1;
+    return (unsigned)(((mask & BM_ROW_BITS)*BM_ROW_GATHER) >> 56);
+}
+
+/** Defines a kernel adding the tile rows p to q of two bitmap tile matrices into
+*   a dense matrix. The tiles of a tile row are merged by column, the mask of the
+*   sum is the OR of the masks so every element of the result is written once.
+*
+*   kernel parameters:
+*       MATRIX_DATA *dense: the zeroed dense matrix (rows x cols) the tiles are added to
+*       BITMAP_DATA *a: the BITMAP_DATA of one of the matrices
+*       BITMAP_DATA *b: the BITMAP_DATA of the other matrix
+*       int cols: the number of columns in the matrix
+*       int p: the first tile row
+*       int q: the tile row after the last tile row
+*/
+#define DEFINE_BITMAP_ADD_KERNEL(NAME, FIELD) \
+void NAME(MATRIX_DATA *dense, BITMAP_DATA *a, BITMAP_DATA *b, int cols, int p, int q) \
+{ \
+    MATRIX_DATA *va, *vb, *d; \
+    uint64_t ma, mb, both, bit; \
+    int na, nb, ca, cb, pos; \
+    for(int t_row = p; t_row < q; t_row++) { \
+        na = a->ia[t_row]; \
+        nb = b->ia[t_row]; \
+        while(na < a->ia[t_row+1] || nb < b->ia[t_row+1]) { \
+            ca = na < a->ia[t_row+1] ? a->ja[na] : INT_MAX; \
+            cb = nb < b->ia[t_row+1] ? b->ja[nb] : INT_MAX; \
+            ma = ca <= cb ? a->masks[na] : 0; \
+            mb = cb <= ca ? b->masks[nb] : 0; \
+            va = a->values + (ma != 0 ? a->val_ptr[na++] : 0); \
+            vb = b->values + (mb != 0 ? b->val_ptr[nb++] : 0); \
+            d = dense + (size_t)t_row*BITMAP_TILE*cols + (ca < cb ? ca : cb)*BITMAP_TILE; \
+            for(both = ma | mb; both != 0; both &= both - 1) { \
+                pos = __builtin_ctzll(both); \
+                bit = (uint64_t)1 << pos; \
+                d[(size_t)(pos/BITMAP_TILE)*cols + pos % BITMAP_TILE].FIELD = \
+                    ((ma & bit) != 0 ? (va++)->FIELD : 0) + ((mb & bit) != 0 ? (vb++)->FIELD : 0); \
+            } \
+        } \
+    } \
+}
+
+DEFINE_BITMAP_ADD_KERNEL(float_bitmap_add, f)
+DEFINE_BITMAP_ADD_KERNEL(int_bitmap_add, i)
+
+/** Defines a kernel multiplying the tile rows p to q of the bitmap tile matrix a
+*   with the bitmap tile matrix b into the dense matrix c (c += a*b). A pair of
+*   tiles is skipped when the AND of the columns of the tile of a with the rows
+*   of the tile of b is empty, otherwise every element of the tile of a is
+*   multiplied with the matching row of the tile of b.
+*
+*   kernel parameters:
+*       MATRIX_DATA *c: the dense result (rows of a x ldc)
+*       BITMAP_DATA *a: the BITMAP_DATA of the left matrix
+*       BITMAP_DATA *b: the BITMAP_DATA of the right matrix
+*       int ldc: the number of columns in c
+*       int p: the first tile row of a
+*       int q: the tile row after the last tile row of a
+*/
+#define DEFINE_BITMAP_GEMM_KERNEL(NAME, FIELD, ACC_T) \
+void NAME(MATRIX_DATA *c, BITMAP_DATA *a, BITMAP_DATA *b, int ldc, int p, int q) \
+{ \
+    MATRIX_DATA *va, *vb, *row_b[BITMAP_TILE], *c_tile; \
+    uint64_t ma, mb, elems; \
+    unsigned cols_a, cols_b; \
+    ACC_T a_ik; \
+    int t_k, pos, k, j; \
+    for(int t_row = p; t_row < q; t_row++) { \
+        for(int n = a->ia[t_row]; n < a->ia[t_row+1]; n++) { \
+            t_k = a->ja[n]; \
+            ma = a->masks[n]; \
+            cols_a = bitmap_col_bits(ma); \
+            for(int m = b->ia[t_k]; m < b->ia[t_k+1]; m++) { \
+                mb = b->masks[m]; \
+                if((cols_a & bitmap_row_bits(mb)) == 0) {continue;} \
+                vb = b->values + b->val_ptr[m]; \
+                for(k = 0; k < BITMAP_TILE; k++) { \
+                    row_b[k] = vb; \
+                    vb += __builtin_popcountll(mb & ((uint64_t)0xFF << k*BITMAP_TILE)); \
+                } \
+                va = a->values + a->val_ptr[n]; \
+                c_tile = c + (size_t)t_row*BITMAP_TILE*ldc + b->ja[m]*BITMAP_TILE; \
+                for(elems = ma; elems != 0; elems &= elems - 1) { \
+                    pos = __builtin_ctzll(elems); \
+                    a_ik = (va++)->FIELD; \
+                    k = pos % BITMAP_TILE; \
+                    vb = row_b[k]; \
+                    for(cols_b = (mb >> k*BITMAP_TILE) & 0xFF; cols_b != 0; cols_b &= cols_b - 1) { \
+                        j = __builtin_ctz(cols_b); \
+                        c_tile[(size_t)(pos/BITMAP_TILE)*ldc + j].FIELD += a_ik*(vb++)->FIELD; \
+                    } \
+                } \
+            } \
+        } \
+    } \
+}
+
+DEFINE_BITMAP_GEMM_KERNEL(float_bitmap_gemm, f, double)
+DEFINE_BITMAP_GEMM_KERNEL(int_bitmap_gemm, i, int)
+
+/** Makes sure both matrices use the bitmap engine if either of them was loaded
+*   as BITMAP. By then any DENSE, BCSR or DIA matrix has brought the other matrix
+*   into its format.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int BITMAP_reconcile(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if(matrix_a->format != BITMAP && matrix_b->format != BITMAP) {return 1;}
+    if(MATRIX_convert(ctx, matrix_a, BITMAP) == 0) {return 0;}
+    return MATRIX_convert(ctx, matrix_b, BITMAP);
+}
+
+/** Arguments of bitmap_task */
+struct bitmap_args {
+    MATRIX_DATA *result;
+    BITMAP_DATA *a;
+    BITMAP_DATA *b;
+    void (*kernel)(MATRIX_DATA *, BITMAP_DATA *, BITMAP_DATA *, int, int, int);
+    int cols;
+};
+
+/** Runs the addition or multiplication kernel over the tile rows p to q
+*
+*   parameters:
+*       void *arg: the struct bitmap_args
+*       SMOPS_INDEX p: the first tile row
+*       SMOPS_INDEX q: the tile row after the last tile row
+*       int worker: unused
+*/
+void bitmap_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct bitmap_args *args = (struct bitmap_args *)arg;
+    args->kernel(args->result, args->a, args->b, args->cols, (int)p, (int)q);
+}
+
+/** Performs the addition result = matrix_a + matrix_b with both matrices in
+*   BITMAP format. Threads are given tile rows so no two threads write to the
+*   same element of the result.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void BITMAP_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    BITMAP_DATA *a = matrix_a->bitmap_data;
+    BITMAP_DATA *b = matrix_b->bitmap_data;
+    void (*kernel)(MATRIX_DATA *, BITMAP_DATA *, BITMAP_DATA *, int, int, int)
+        = matrix_a->type == FLOAT ? float_bitmap_add : int_bitmap_add;
+    int cols = matrix_a->cols;
+    int tile_rows = a->tile_rows;
+
+    struct bitmap_args args = { result, a, b, kernel, cols };
+    POOL_parallel_for(ctx, tile_rows, BM_ROW_CHUNK, bitmap_task, &args);
+}
+
+/** Performs the multiplication result = matrix_a*matrix_b with both matrices in
+*   BITMAP format. Only the set bits of the masks are visited, which all lie
+*   inside the matrices, so the result needs no padding. Threads are given tile
+*   rows of matrix_a.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix (rows of a x cols of b)
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*/
+void BITMAP_multiplication(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    BITMAP_DATA *a = matrix_a->bitmap_data;
+    BITMAP_DATA *b = matrix_b->bitmap_data;
+    void (*kernel)(MATRIX_DATA *, BITMAP_DATA *, BITMAP_DATA *, int, int, int)
+        = matrix_a->type == FLOAT ? float_bitmap_gemm : int_bitmap_gemm;
+    int ldc = matrix_b->cols;
+    int tile_rows = a->tile_rows;
+
+    struct bitmap_args args = { result, a, b, kernel, ldc };
+    POOL_parallel_for(ctx, tile_rows, 1, bitmap_task, &args);
+}
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+
+#include "../smops.h"
+
+#define DC_ROW_CHUNK 32
+
+/** Adds the stored rows p to q of a DCSR matrix into a dense matrix arbitrary to type
+*
+*   parameters:
+*       MATRIX_DATA *dense: the dense matrix (rows x cols) the rows are added to
+*       DCSR_DATA *dcsr: the DCSR_DATA of the matrix
+*       TYPE type: the type of the matrix
+*       int cols: the number of columns in the matrix
+*       int p: the first stored row
+*       int q: the stored row after the last stored row
+*/
+void dcsr_add_rows(MATRIX_DATA *dense, DCSR_DATA *dcsr, TYPE type, int cols, int p, int q)
+{
+    MATRIX_DATA *row;
+    SMOPS_INDEX i;
+    for(int n = p; n < q; n++) {
+        row = dense + (size_t)dcsr->row_ids[n]*cols;
+        switch(type) {
+            case FLOAT:
+                for(i = dcsr->ia[n]; i < dcsr->ia[n+1]; i++) {
+                    row[dcsr->ja[i]].f += dcsr->nnz[i].f;
+                }
+                break;
+            case INT:
+                for(i = dcsr->ia[n]; i < dcsr->ia[n+1]; i++) {
+                    row[dcsr->ja[i]].i += dcsr->nnz[i].i;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/** Makes sure both matrices use the DCSR engine if either of them was loaded as
+*   DCSR. By then any DENSE, BCSR, DIA, BITMAP or CSRDU matrix has brought the
+*   other matrix into its format, so the other matrix is CSR.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int DCSR_reconcile(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if(matrix_a->format != DCSR && matrix_b->format != DCSR) {return 1;}
+    if(MATRIX_convert(ctx, matrix_a, DCSR) == 0) {return 0;}
+    return MATRIX_convert(ctx, matrix_b, DCSR);
+}
+
+/** Arguments of dcsr_add_task */
+struct dcsr_add_args {
+    MATRIX_DATA *result;
+    DCSR_DATA *dcsr;
+    TYPE type;
+    int cols;
+};
+
+/** Adds the stored rows p to q of a DCSR matrix into the dense result
+*
+*   parameters:
+*       void *arg: the struct dcsr_add_args
+*       SMOPS_INDEX p: the first stored row
+*       SMOPS_INDEX q: the stored row after the last stored row
+*       int worker: unused
+*/
+void dcsr_add_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dcsr_add_args *args = (struct dcsr_add_args *)arg;
+    dcsr_add_rows(args->result, args->dcsr, args->type, args->cols, (int)p, (int)q);
+}
+
+/** Performs the addition result = matrix_a + matrix_b with both matrices in DCSR
+*   format. The stored rows of one matrix are split between threads before the
+*   other, a stored row is only in one chunk so no two threads write to the same
+*   element of the result. Empty rows are never visited.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void DCSR_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    DCSR_DATA *dcsr[] = { matrix_a->dcsr_data, matrix_b->dcsr_data };
+    TYPE type = matrix_a->type;
+    int cols = matrix_a->cols;
+
+    struct dcsr_add_args args = { result, NULL, type, cols };
+    for(int m = 0; m < 2; m++) {
+        args.dcsr = dcsr[m];
+        POOL_parallel_for(ctx, dcsr[m]->nzr, DC_ROW_CHUNK, dcsr_add_task, &args);
+    }
+}
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+
+#include "../smops.h"
+
+#define DI_ROW_CHUNK 64
+
+/** Adds the rows p to q of every diagonal of a float DIA matrix into a dense
+*   matrix. A diagonal steps cols + 1 elements through the dense matrix per row.
+*
+*   parameters:
+*       MATRIX_DATA *dense: the dense matrix (rows x cols) the diagonals are added to
+*       DIA_DATA *dia: the DIA_DATA of the matrix
+*       int cols: the number of columns in the matrix
+*       int p: the first row
+*       int q: the row after the last row
+*/
+void float_dia_add_rows(MATRIX_DATA *dense, DIA_DATA *dia, int cols, int p, int q)
+{
+    MATRIX_DATA *values;
+    int k, first, lo, hi, r;
+    for(int d = 0; d < dia->diagonals; d++) {
+        k = dia->offsets[d];
+        first = k < 0 ? -k : 0;
+        lo = first > p ? first : p;
+        hi = cols - k < q ? cols - k : q;
+        values = dia->values + dia->start[d];
+        for(r = lo; r < hi; r++) {
+            dense[(size_t)r*cols + r + k].f += values[r - first].f;
+        }
+    }
+}
+
+/** Adds the rows p to q of every diagonal of an int DIA matrix into a dense matrix
+*
+*   parameters: see float_dia_add_rows
+*/
+void int_dia_add_rows(MATRIX_DATA *dense, DIA_DATA *dia, int cols, int p, int q)
+{
+    MATRIX_DATA *values;
+    int k, first, lo, hi, r;
+    for(int d = 0; d < dia->diagonals; d++) {
+        k = dia->offsets[d];
+        first = k < 0 ? -k : 0;
+        lo = first > p ? first : p;
+        hi = cols - k < q ? cols - k : q;
+        values = dia->values + dia->start[d];
+        for(r = lo; r < hi; r++) {
+            dense[(size_t)r*cols + r + k].i += values[r - first].i;
+        }
+    }
+}
+
+/** Adds the rows p to q of both DIA matrices into the dense matrix arbitrary to type
+*
+*   parameters: see float_dia_add_rows
+*       DIA_DATA *a: the DIA_DATA of one of the matrices
+*       DIA_DATA *b: the DIA_DATA of the other matrix
+*       TYPE type: the type of the matrices
+*/
+void dia_add_rows(MATRIX_DATA *dense, DIA_DATA *a, DIA_DATA *b, TYPE type, int cols, int p, int q)
+{
+    switch(type) {
+        case FLOAT:
+            float_dia_add_rows(dense, a, cols, p, q);
+            float_dia_add_rows(dense, b, cols, p, q);
+            break;
+        case INT:
+            int_dia_add_rows(dense, a, cols, p, q);
+            int_dia_add_rows(dense, b, cols, p, q);
+            break;
+        default:
+            break;
+    }
+}
+
+/** Makes sure both matrices are in the same format if only one of them was loaded
+*   as DIA. The DIA matrix is brought into the format of the other matrix, taking
+*   the block size of the other matrix if it is BCSR.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int DIA_reconcile(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if((matrix_a->format == DIA) == (matrix_b->format == DIA)) {return 1;}
+    MATRIX *dia = matrix_a->format == DIA ? matrix_a : matrix_b;
+    MATRIX *other = matrix_a->format == DIA ? matrix_b : matrix_a;
+    if(other->format == BCSR) {
+        dia->stats.bcsr_block = other->bcsr_data->block;
+    }
+    return MATRIX_convert(ctx, dia, other->format);
+}
+
+/** Arguments of dia_add_task */
+struct dia_add_args {
+    MATRIX_DATA *result;
+    DIA_DATA *a;
+    DIA_DATA *b;
+    TYPE type;
+    int cols;
+};
+
+/** Adds the rows p to q of both DIA matrices into the dense result
+*
+*   parameters:
+*       void *arg: the struct dia_add_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void dia_add_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dia_add_args *args = (struct dia_add_args *)arg;
+    dia_add_rows(args->result, args->a, args->b, args->type, args->cols, (int)p, (int)q);
+}
+
+/** Performs the addition result = matrix_a + matrix_b with both matrices in DIA
+*   format. Threads are given blocks of rows so no two threads write to the same
+*   element of the result.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void DIA_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    DIA_DATA *a = matrix_a->dia_data;
+    DIA_DATA *b = matrix_b->dia_data;
+    TYPE type = matrix_a->type;
+    int rows = matrix_a->rows;
+    int cols = matrix_a->cols;
+
+    struct dia_add_args args = { result, a, b, type, cols };
+    POOL_parallel_for(ctx, rows, DI_ROW_CHUNK, dia_add_task, &args);
+}
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+
+#include "../smops.h"
+
+#define DN_BLOCK_I 32
+#define DN_BLOCK_K 128
+#define DN_BLOCK_J 512
+
+/** Multiplies the rows p to q of the dense float matrix a with b into c (c += a*b).
+*   The k and j loops are blocked so a DN_BLOCK_K x DN_BLOCK_J tile of b stays in cache
+*   while the rows of a are streamed over it, the inner j loop is vectorised.
+*
+*   parameters:
+*       MATRIX_DATA *c: the dense result matrix (n x l)
+*       MATRIX_DATA *a: the dense left matrix (n x m)
+*       MATRIX_DATA *b: the dense right matrix (m x l)
+*       int m: the number of columns in a and rows in b
+*       int l: the number of columns in b and c
+*       int p: the first row of c to compute
+*       int q: the row after the last row of c to compute
+*/
+void float_dense_gemm_rows(MATRIX_DATA *c, MATRIX_DATA *a, MATRIX_DATA *b, int m, int l, int p, int q)
+{
+    int k_end, j_end, j;
+    double a_ik;
+    MATRIX_DATA *c_i, *b_k;
+    for(int kk = 0; kk < m; kk += DN_BLOCK_K) {
+        k_end = kk + DN_BLOCK_K < m ? kk + DN_BLOCK_K : m;
+        for(int jj = 0; jj < l; jj += DN_BLOCK_J) {
+            j_end = jj + DN_BLOCK_J < l ? jj + DN_BLOCK_J : l;
+            for(int i = p; i < q; i++) {
+                c_i = c + (size_t)i*l;
+                for(int k = kk; k < k_end; k++) {
+                    a_ik = a[(size_t)i*m + k].f;
+                    if(a_ik == 0) {continue;}
+                    b_k = b + (size_t)k*l;
+                    #pragma omp simd
+                    for(j = jj; j < j_end; j++) {
+                        c_i[j].f += a_ik*b_k[j].f;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Multiplies the rows p to q of the dense int matrix a with b into c (c += a*b).
+*
+*   parameters: see float_dense_gemm_rows
+*/
+void int_dense_gemm_rows(MATRIX_DATA *c, MATRIX_DATA *a, MATRIX_DATA *b, int m, int l, int p, int q)
+{
+    int k_end, j_end, j;
+    int a_ik;
+    MATRIX_DATA *c_i, *b_k;
+    for(int kk = 0; kk < m; kk += DN_BLOCK_K) {
+        k_end = kk + DN_BLOCK_K < m ? kk + DN_BLOCK_K : m;
+        for(int jj = 0; jj < l; jj += DN_BLOCK_J) {
+            j_end = jj + DN_BLOCK_J < l ? jj + DN_BLOCK_J : l;
+            for(int i = p; i < q; i++) {
+                c_i = c + (size_t)i*l;
+                for(int k = kk; k < k_end; k++) {
+                    a_ik = a[(size_t)i*m + k].i;
+                    if(a_ik == 0) {continue;}
+                    b_k = b + (size_t)k*l;
+                    #pragma omp simd
+                    for(j = jj; j < j_end; j++) {
+                        c_i[j].i += a_ik*b_k[j].i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Multiplies the rows p to q of the dense matrices a and b arbitrary to type
+*
+*   parameters: see float_dense_gemm_rows
+*       TYPE type: the type of the matrices
+*/
+void dense_gemm_rows(MATRIX_DATA *c, MATRIX_DATA *a, MATRIX_DATA *b, TYPE type,
+                    int m, int l, int p, int q)
+{
+    switch(type) {
+        case FLOAT:
+            float_dense_gemm_rows(c, a, b, m, l, p, q);
+            break;
+        case INT:
+            int_dense_gemm_rows(c, a, b, m, l, p, q);
+            break;
+        default:
+            break;
+    }
+}
+
+/** Arguments of dense_gemm_task and dense_add_task */
+struct dense_args {
+    MATRIX_DATA *result;
+    MATRIX_DATA *a;
+    MATRIX_DATA *b;
+    TYPE type;
+    int m;
+    int l;
+};
+
+/** Computes the rows p to q of the dense product
+*
+*   parameters:
+*       void *arg: the struct dense_args
+*       SMOPS_INDEX p: the first row of the result
+*       SMOPS_INDEX q: the row after the last row of the result
+*       int worker: unused
+*/
+void dense_gemm_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dense_args *args = (struct dense_args *)arg;
+    dense_gemm_rows(args->result, args->a, args->b, args->type, args->m, args->l, (int)p, (int)q);
+}
+
+/** Adds the rows p to q of the dense matrices, m is the number of columns
+*
+*   parameters:
+*       void *arg: the struct dense_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void dense_add_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dense_args *args = (struct dense_args *)arg;
+    MATRIX_DATA *result = args->result;
+    MATRIX_DATA *a = args->a;
+    MATRIX_DATA *b = args->b;
+    size_t end = (size_t)q*args->m;
+    size_t i;
+
+    switch(args->type) {
+        case FLOAT:
+            #pragma omp simd
+            for(i = (size_t)p*args->m; i < end; i++) {
+                result[i].f = a[i].f + b[i].f;
+            }
+            break;
+        case INT:
+            #pragma omp simd
+            for(i = (size_t)p*args->m; i < end; i++) {
+                result[i].i = a[i].i + b[i].i;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/** Performs the dense multiplication result = matrix_a*matrix_b with both
+*   matrices in DENSE format. Threads are given blocks of rows of the result
+*   so no two threads write to the same element.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix (rows of a x cols of b)
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*/
+void DENSE_multiplication(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    MATRIX_DATA *a = matrix_a->dense_data->values;
+    MATRIX_DATA *b = matrix_b->dense_data->values;
+    TYPE type = matrix_a->type;
+    int n = matrix_a->rows;
+    int m = matrix_a->cols;
+    int l = matrix_b->cols;
+
+    struct dense_args args = { result, a, b, type, m, l };
+    POOL_parallel_for(ctx, n, DN_BLOCK_I, dense_gemm_task, &args);
+}
+
+/** Performs the dense addition result = matrix_a + matrix_b with both
+*   matrices in DENSE format.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void DENSE_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    MATRIX_DATA *a = matrix_a->dense_data->values;
+    MATRIX_DATA *b = matrix_b->dense_data->values;
+    struct dense_args args = { result, a, b, matrix_a->type, matrix_a->cols, 0 };
+    POOL_parallel_for(ctx, matrix_a->rows, 0, dense_add_task, &args);
+}
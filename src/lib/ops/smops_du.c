@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "../smops.h"
+
+#define DU_ROW_CHUNK 64
+#define DU_HIGH_BITS 0x8080808080808080ULL //the continuation bit of 8 varint bytes
+
+/** Decodes the next n columns of a CSR-DU row one varint at a time
+*
+*   parameters:
+*       int *cols: where the n decoded columns are stored
+*       const uint8_t *ja: the position in the varint stream of the row
+*       int col: the column before the first decoded column, 0 at the start of a row
+*       int n: the number of columns to decode
+*
+*   return:
+*       the position in the stream after the decoded columns
+*/
+const uint8_t *CSRDU_decode(int *cols, const uint8_t *ja, int col, int n)
+{
+    int delta, shift;
+    uint8_t byte;
+    for(int k = 0; k < n; k++) {
+        delta = 0;
+        shift = 0;
+        do {
+            byte = *ja++;
+            delta |= (byte & 0x7F) << shift;
+            shift += 7;
+        } while(byte & 0x80);
+        col += delta;
+        cols[k] = col;
+    }
+    return ja;
+}
+
+/** AVX2 version of CSRDU_decode. When the next 8 bytes have no continuation bit
+*   they are 8 one byte differences, which are widened to 8 lanes and turned into
+*   columns with a prefix sum in 3 adds. Other varints are decoded one at a time.
+*   A run of 8 is only tried with 8 columns left, so no byte past them is read.
+*
+*   parameters: see CSRDU_decode
+*/
+__attribute__((target("avx2")))
+const uint8_t *CSRDU_decode_avx2(int *cols, const uint8_t *ja, int col, int n)
+{
+    uint64_t bytes;
+    __m256i d, carry;
+    int k = 0;
+    while(k < n) {
+        if(k + 8 <= n) {
+            memcpy(&bytes, ja, sizeof(uint64_t));
+            if((bytes & DU_HIGH_BITS) == 0) {
+                d = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)bytes));
+                d = _mm256_add_epi32(d, _mm256_slli_si256(d, 4));
+                d = _mm256_add_epi32(d, _mm256_slli_si256(d, 8));
+                carry = _mm256_shuffle_epi32(d, 0xFF);
+                d = _mm256_add_epi32(d, _mm256_permute2x128_si256(carry, carry, 0x08));
+                d = _mm256_add_epi32(d, _mm256_set1_epi32(col));
+                _mm256_storeu_si256((__m256i *)(cols + k), d);
+                col = cols[k + 7];
+                ja += 8;
+                k += 8;
+                continue;
+            }
+        }
+        ja = CSRDU_decode(cols + k, ja, col, 1);
+        col = cols[k];
+        k++;
+    }
+    return ja;
+}
+
+/** Gets the decoder for the kernel variant chosen by the planner
+*
+*   parameters:
+*       KERNEL kernel: the kernel variant of the matrix
+*
+*   return:
+*       the decoder of the varint column stream
+*/
+CSRDU_DECODER CSRDU_decoder(KERNEL kernel)
+{
+    return kernel == KERNEL_SIMD ? CSRDU_decode_avx2 : CSRDU_decode;
+}
+
+/** Adds the rows p to q of a CSR-DU matrix into a dense matrix arbitrary to type.
+*   The columns of a row are decoded CSRDU_BATCH at a time.
+*
+*   parameters:
+*       MATRIX_DATA *dense: the dense matrix (rows x cols) the rows are added to
+*       CSRDU_DATA *du: the CSRDU_DATA of the matrix
+*       CSRDU_DECODER decode: the decoder of the column stream
+*       TYPE type: the type of the matrix
+*       int cols: the number of columns in the matrix
+*       int p: the first row
+*       int q: the row after the last row
+*/
+void csrdu_add_rows(MATRIX_DATA *dense, CSRDU_DATA *du, CSRDU_DECODER decode, TYPE type, int cols, int p, int q)
+{
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    MATRIX_DATA *row, *nnz;
+    SMOPS_INDEX i;
+    int k, j, col;
+    for(int r = p; r < q; r++) {
+        row = dense + (size_t)r*cols;
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = decode(buf, ja, col, k);
+            col = buf[k - 1];
+            nnz = du->nnz + i;
+            switch(type) {
+                case FLOAT:
+                    for(j = 0; j < k; j++) {
+                        row[buf[j]].f += nnz[j].f;
+                    }
+                    break;
+                case INT:
+                    for(j = 0; j < k; j++) {
+                        row[buf[j]].i += nnz[j].i;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+/** Makes sure both matrices use the CSR-DU engine if either of them was loaded
+*   as CSRDU. By then any DENSE, BCSR, DIA or BITMAP matrix has brought the other
+*   matrix into its format, so the other matrix is CSR or DCSR.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix_a: the left matrix
+*       MATRIX *matrix_b: the right matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int CSRDU_reconcile(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if(matrix_a->format != CSRDU && matrix_b->format != CSRDU) {return 1;}
+    if(MATRIX_convert(ctx, matrix_a, CSRDU) == 0) {return 0;}
+    return MATRIX_convert(ctx, matrix_b, CSRDU);
+}
+
+/** Arguments of csrdu_add_task */
+struct csrdu_add_args {
+    MATRIX_DATA *result;
+    CSRDU_DATA *a;
+    CSRDU_DATA *b;
+    CSRDU_DECODER decode_a;
+    CSRDU_DECODER decode_b;
+    TYPE type;
+    int cols;
+};
+
+/** Adds the rows p to q of both CSRDU matrices into the dense result
+*
+*   parameters:
+*       void *arg: the struct csrdu_add_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void csrdu_add_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct csrdu_add_args *args = (struct csrdu_add_args *)arg;
+    csrdu_add_rows(args->result, args->a, args->decode_a, args->type, args->cols, (int)p, (int)q);
+    csrdu_add_rows(args->result, args->b, args->decode_b, args->type, args->cols, (int)p, (int)q);
+}
+
+/** Performs the addition result = matrix_a + matrix_b with both matrices in CSRDU
+*   format. Threads are given blocks of rows so no two threads write to the same
+*   element of the result.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads
+*       MATRIX_DATA *result: the zeroed dense result matrix
+*       MATRIX *matrix_a: one of the matrices that is added together
+*       MATRIX *matrix_b: the other matrix that is added together
+*/
+void CSRDU_addition(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    CSRDU_DATA *a = matrix_a->csrdu_data;
+    CSRDU_DATA *b = matrix_b->csrdu_data;
+    CSRDU_DECODER decode_a = CSRDU_decoder(matrix_a->kernel);
+    CSRDU_DECODER decode_b = CSRDU_decoder(matrix_b->kernel);
+    TYPE type = matrix_a->type;
+    int rows = matrix_a->rows;
+    int cols = matrix_a->cols;
+
+    struct csrdu_add_args args = { result, a, b, decode_a, decode_b, type, cols };
+    POOL_parallel_for(ctx, rows, DU_ROW_CHUNK, csrdu_add_task, &args);
+}
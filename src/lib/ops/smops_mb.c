@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "../smops.h"
+
+#define OP MATRIX_BLOCK_MULT
+#define MB_MAX_PANEL 16
+
+/** Defines a register blocked micro kernel multiplying the rows p to q of a CSR
+*   matrix with a K column wide panel of the dense row major block x.
+*   Each ja and nnz load is reused for all K columns of the panel.
+*
+*   kernel parameters:
+*       MATRIX_DATA *y: the dense row major result block (rows x k)
+*       CSR_DATA *csr: the CSR_DATA of the matrix
+*       MATRIX_DATA *x: the dense row major block (cols x k)
+*       int k: the number of columns in x and y
+*       int col: the first column of the panel
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+#define DEFINE_SPMM_KERNEL(NAME, FIELD, ACC_T, K) \
+void NAME(MATRIX_DATA *y, CSR_DATA *csr, MATRIX_DATA *x, int k, int col, int p, int q) \
+{ \
+    MATRIX_DATA *nnz = csr->nnz; \
+    SMOPS_INDEX end; \
+    ACC_T acc[K]; \
+    ACC_T v; \
+    MATRIX_DATA *xr; \
+    MATRIX_DATA *yr; \
+    int c; \
+    for(int r = p; r < q; r++) { \
+        for(c = 0; c < K; c++) { \
+            acc[c] = 0; \
+        } \
+        end = CSR_ROW(csr, r+1); \
+        for(SMOPS_INDEX i = CSR_ROW(csr, r); i < end; i++) { \
+            v = nnz[i].FIELD; \
+            xr = x + (size_t)CSR_COL(csr, i)*k + col; \
+            for(c = 0; c < K; c++) { \
+                acc[c] += v*xr[c].FIELD; \
+            } \
+        } \
+        yr = y + (size_t)r*k + col; \
+        for(c = 0; c < K; c++) { \
+            yr[c].FIELD = acc[c]; \
+        } \
+    } \
+}
+
+DEFINE_SPMM_KERNEL(float_spmm_k1, f, double, 1)
+DEFINE_SPMM_KERNEL(float_spmm_k2, f, double, 2)
+DEFINE_SPMM_KERNEL(float_spmm_k4, f, double, 4)
+DEFINE_SPMM_KERNEL(float_spmm_k8, f, double, 8)
+DEFINE_SPMM_KERNEL(float_spmm_k16, f, double, 16)
+
+DEFINE_SPMM_KERNEL(int_spmm_k1, i, int, 1)
+DEFINE_SPMM_KERNEL(int_spmm_k2, i, int, 2)
+DEFINE_SPMM_KERNEL(int_spmm_k4, i, int, 4)
+DEFINE_SPMM_KERNEL(int_spmm_k8, i, int, 8)
+DEFINE_SPMM_KERNEL(int_spmm_k16, i, int, 16)
+
+typedef void (*SPMM_KERNEL)(MATRIX_DATA *, CSR_DATA *, MATRIX_DATA *, int, int, int, int);
+
+/** Gets the widest micro kernel that fits in the remaining columns of the block
+*
+*   parameters:
+*       TYPE type: the type of the matrix
+*       int remaining: the number of columns left to multiply
+*       int *width: set to the number of columns the kernel multiplies
+*
+*   return:
+*       the micro kernel, NULL if the type is UNDEFINED
+*/
+SPMM_KERNEL spmm_panel_kernel(TYPE type, int remaining, int *width)
+{
+    SPMM_KERNEL float_kernels[] = { float_spmm_k1, float_spmm_k2, float_spmm_k4,
+                                    float_spmm_k8, float_spmm_k16 };
+    SPMM_KERNEL int_kernels[] = { int_spmm_k1, int_spmm_k2, int_spmm_k4,
+                                    int_spmm_k8, int_spmm_k16 };
+    int level = 4;
+    *width = MB_MAX_PANEL;
+    while(*width > remaining) {
+        *width /= 2;
+        level--;
+    }
+    switch(type) {
+        case INT:
+            return int_kernels[level];
+        case FLOAT:
+            return float_kernels[level];
+        default:
+            return NULL;
+    }
+}
+
+/** Multiplies the rows p to q of the matrix with every column panel of the block
+*
+*   parameters: see DEFINE_SPMM_KERNEL
+*       TYPE type: the type of the matrix
+*/
+void spmm_rows(MATRIX_DATA *y, CSR_DATA *csr, MATRIX_DATA *x, TYPE type, int k, int p, int q)
+{
+    int width;
+    SPMM_KERNEL kernel;
+    for(int col = 0; col < k; col += width) {
+        kernel = spmm_panel_kernel(type, k - col, &width);
+        kernel(y, csr, x, k, col, p, q);
+    }
+}
+
+/** Multiplies the non zero elements p to q of a row of a CSR matrix with x into
+*   one row of y by running spmm_rows on a copy of the CSR_DATA whose only row
+*   is them
+*
+*   parameters:
+*       MATRIX_DATA *y: the row of the result (1 x k)
+*       CSR_DATA *csr: the CSR_DATA of the matrix
+*       MATRIX_DATA *x: the dense row major block (cols x k)
+*       TYPE type: the type of the matrix
+*       int k: the number of columns in x and y
+*       SMOPS_INDEX p: the first non zero element
+*       SMOPS_INDEX q: the non zero element after the last one
+*/
+void spmm_segment(MATRIX_DATA *y, CSR_DATA *csr, MATRIX_DATA *x, TYPE type, int k, SMOPS_INDEX p, SMOPS_INDEX q)
+{
+    CSR_DATA segment = *csr;
+    SMOPS_INDEX ia[2] = { p, q };
+    segment.ia = ia;
+    segment.ia32 = NULL;
+    spmm_rows(y, &segment, x, type, k, 0, 1);
+}
+
+/** Arguments of spmm_task
+*   splits: the merge path splits of the matrix
+*   carry: a row of y for every part, holding the row the part ends in
+*/
+struct spmm_args {
+    MATRIX_DATA *y;
+    CSR_DATA *csr;
+    MATRIX_DATA *x;
+    CSR_SPLIT *splits;
+    MATRIX_DATA *carry;
+    TYPE type;
+    int rows;
+    int k;
+};
+
+/** Computes the merge path parts p to q of the spmm result. A row begun by an
+*   earlier part is finished with its own elements only, the rows inside the part
+*   go to the panel kernels and the row the part ends in goes to its carry.
+*
+*   parameters:
+*       void *arg: the struct spmm_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void spmm_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct spmm_args *args = (struct spmm_args *)arg;
+    CSR_DATA *csr = args->csr;
+    CSR_SPLIT start, end;
+    int first, k = args->k;
+    for(SMOPS_INDEX part = p; part < q; part++) {
+        start = args->splits[part];
+        end = args->splits[part+1];
+        first = start.row;
+        if(first < end.row && CSR_ROW(csr, first) < start.nz) {
+            spmm_segment(args->y + (size_t)first*k, csr, args->x, args->type, k, start.nz, CSR_ROW(csr, first+1));
+            first++;
+        }
+        if(first < end.row) {
+            spmm_rows(args->y, csr, args->x, args->type, k, first, end.row);
+        }
+        if(end.row < args->rows) {
+            spmm_segment(args->carry + (size_t)part*k, csr, args->x, args->type, k,
+                            CSR_ROW(csr, end.row) > start.nz ? CSR_ROW(csr, end.row) : start.nz, end.nz);
+        }
+    }
+}
+
+/** Performs the sparse matrix by dense block multiplication result = matrix*block
+*   The result is stored as a dense rows x k matrix, k being the columns in block.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix in CSR format
+*       MATRIX *block: the dense row major block in DENSE format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int MATRIX_OP_spmm(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX *block)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, block, OP, DENSE) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, block, OP, DENSE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, block);
+
+    if(matrix->cols != block->rows || block->cols < 1) {
+        SMOPS_CTX_fill_err_msg(ctx, "input block does not have the correct dimensions for spmm");
+        return 0;
+    }
+    if(matrix->type != block->type || matrix->type == UNDEFINED) {
+        SMOPS_CTX_fill_err_msg(ctx, "type not properly set for matrices used in spmm");
+        return 0;
+    }
+
+    int rows = matrix->rows;
+    int k = block->cols;
+    TYPE type = matrix->type;
+    CSR_DATA *csr = matrix->csr_data;
+    MATRIX_DATA *x = block->dense_data->values;
+    MATRIX_DATA *y = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(rows > 0 ? (size_t)rows*k : 1));
+    if(y == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for spmm result");
+        return 0;
+    }
+
+    CSR_SPLIT *splits;
+    int parts = POOL_merge_path(ctx, csr, rows, &splits);
+    MATRIX_DATA *carry = parts > 0 ? (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*parts*k) : NULL;
+    if(carry == NULL) {
+        if(parts > 0) {
+            SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for spmm carries");
+            free(splits);
+        }
+        free(y);
+        return 0;
+    }
+    struct spmm_args args = { y, csr, x, splits, carry, type, rows, k };
+    POOL_parallel_for(ctx, parts, 1, spmm_task, &args);
+    MATRIX_DATA *row, *part;
+    for(int n = 0; n < parts; n++) {
+        if(splits[n+1].row == rows) {continue;}
+        row = y + (size_t)splits[n+1].row*k;
+        part = carry + (size_t)n*k;
+        for(int c = 0; c < k; c++) {
+            if(type == FLOAT) {
+                row[c].f += part[c].f;
+            } else {
+                row[c].i += part[c].i;
+            }
+        }
+    }
+    free(carry);
+    free(splits);
+
+    int panels = k/MB_MAX_PANEL + __builtin_popcount(k % MB_MAX_PANEL);
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    ctx->flop_count = 2.0*matrix->non_zero_size*k;
+    ctx->byte_count = ((double)matrix->non_zero_size*(sizeof(MATRIX_DATA) + sizeof(int))
+                        + (rows + 1.0)*sizeof(SMOPS_INDEX))*panels
+                        + (double)(block->rows + rows)*k*sizeof(MATRIX_DATA);
+    SMOPS_RESULT_save_matrix_result(ctx, y, type, rows, k);
+    return 1;
+}
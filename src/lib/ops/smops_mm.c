@@ -1,5 +1,4 @@
 #include <stdlib.h>
-#include <omp.h>
 #include <time.h>
 #include <stdio.h>
 
@@ -7,7 +6,7 @@
 
 #define OP MATRIX_MULT
 
-void sequential_mult_to_dense(MATRIX_DATA *dense_matrix, MATRIX_DATA a, MATRIX_DATA b, TYPE type, int pos)
+void mult_to_dense(MATRIX_DATA *dense_matrix, MATRIX_DATA a, MATRIX_DATA b, TYPE type, size_t pos)
 {
     switch(type) {
         case FLOAT:
@@ -21,82 +20,110 @@ void sequential_mult_to_dense(MATRIX_DATA *dense_matrix, MATRIX_DATA a, MATRIX_D
     }
 }
 
-void parallel_mult_to_dense(MATRIX_DATA *dense_matrix, MATRIX_DATA a, MATRIX_DATA b, TYPE type, int pos)
+/** Arguments of multiplication_task
+*   splits: the merge path splits of a
+*   carry: a row of the result for every part, holding the row the part ends in
+*/
+struct multiplication_args {
+    MATRIX_DATA *dense_matrix;
+    CSR_DATA *csr_a;
+    CSC_DATA *csc_b;
+    CSR_SPLIT *splits;
+    MATRIX_DATA *carry;
+    TYPE type;
+    int rows_result;
+    int cols_result;
+};
+
+/** Adds the merged dot products of the non zero elements p to q of a row of a
+*   with every column of b to a row of the result
+*
+*   parameters:
+*       struct multiplication_args *a: the arguments of the multiplication
+*       MATRIX_DATA *row: the row of the result
+*       SMOPS_INDEX p: the first non zero element of a
+*       SMOPS_INDEX q: the non zero element after the last one
+*/
+void multiply_row_segment(struct multiplication_args *a, MATRIX_DATA *row, SMOPS_INDEX p, SMOPS_INDEX q)
 {
-    switch(type) {
-        case FLOAT:
-            #pragma omp atomic
-            dense_matrix[pos].f += a.f*b.f;
-            break;
-        case INT:
-            #pragma omp atomic
-            dense_matrix[pos].i += a.i*b.i;
-            break;
-        default:
-            break;
+    CSR_DATA *csr_a = a->csr_a;
+    CSC_DATA *csc_b = a->csc_b;
+    SMOPS_INDEX p_b, q_b;
+    int k;
+    for(int c = 0; c < a->cols_result; c++) {
+        p_b = CSR_ROW(csc_b, c);
+        q_b = CSR_ROW(csc_b, c+1);
+        for(SMOPS_INDEX i = p; i < q; i++) {
+            k = CSR_COL(csr_a, i);
+            for(SMOPS_INDEX j = p_b; j < q_b; j++) {
+                if(k == CSR_COL(csc_b, j)) {
+                    mult_to_dense(row, csr_a->nnz[i], csc_b->nnz[j], a->type, c);
+                    break;
+                }
+            }
+        }
     }
 }
 
-void sequential_multiplication(MATRIX_DATA *dense_matrix, CSR_DATA *csr_a,
-                            CSC_DATA *csc_b, TYPE type, int rows_result, int cols_result)
+/** Finds the merge path parts p to q of the result. The rows ending in a part
+*   are written to the result, the row a part ends in is written to the carry of
+*   the part, so no two parts write the same element and no atomics are needed.
+*
+*   parameters:
+*       void *arg: the struct multiplication_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void multiplication_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
 {
-    int p_a, q_a, p_b, q_b, index;
-    for(int r = 0; r < rows_result; r++) {
-        for(int c = 0; c < cols_result; c++) {
-            index = r*rows_result + c;
-            p_a = csr_a->ia[r];
-            q_a = csr_a->ia[r+1];
-            p_b = csc_b->ia[c];
-            q_b = csc_b->ia[c+1];
-
-            for(int i = p_a; i < q_a; i++) {
-                for(int j = p_b; j < q_b; j++) {
-                    if(csr_a->ja[i] == csc_b->ja[j]) {
-                        sequential_mult_to_dense(dense_matrix, csr_a->nnz[i], csc_b->nnz[j], type, index);
-                        break;
-                    }
-                }
-            }
+    struct multiplication_args *a = (struct multiplication_args *)arg;
+    CSR_DATA *csr_a = a->csr_a;
+    CSR_SPLIT start, end;
+    for(SMOPS_INDEX k = p; k < q; k++) {
+        start = a->splits[k];
+        end = a->splits[k+1];
+        for(int r = start.row; r < end.row; r++) {
+            multiply_row_segment(a, a->dense_matrix + (size_t)r*a->cols_result,
+                                    CSR_ROW(csr_a, r) > start.nz ? CSR_ROW(csr_a, r) : start.nz, CSR_ROW(csr_a, r+1));
+        }
+        if(end.row < a->rows_result) {
+            multiply_row_segment(a, a->carry + (size_t)k*a->cols_result,
+                                    CSR_ROW(csr_a, end.row) > start.nz ? CSR_ROW(csr_a, end.row) : start.nz, end.nz);
         }
     }
 }
 
-void parallel_multiplication(SMOPS_CTX *ctx, MATRIX_DATA *dense_matrix, CSR_DATA *csr_a,
-                            CSC_DATA *csc_b, TYPE type, int rows_result, int cols_result)
+/** Arguments of square_task */
+struct square_args {
+    MATRIX_DATA *dense_matrix;
+    CSR_DATA *csr;
+    TYPE type;
+    int cols;
+};
+
+/** Computes the rows p to q of A*A from the CSR_DATA of A alone, every element
+*   a_ik of a row is multiplied with row k of the same CSR_DATA. A row of the
+*   result is only written by the task computing it.
+*
+*   parameters:
+*       void *arg: the struct square_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void square_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
 {
-    MATRIX_DATA *a_nnz = csr_a->nnz;
-    int *a_ia = csr_a->ia;
-    int *a_ja = csr_a->ja;
-
-    MATRIX_DATA *b_nnz = csc_b->nnz;
-    int *b_ia = csc_b->ia;
-    int *b_ja = csc_b->ja;
-
-    #pragma omp parallel num_threads(ctx->thread_num) firstprivate(type, rows_result, cols_result)
-    {
-        #pragma omp single
-        {
-            int p_a, q_a, p_b, q_b, index;
-            for(int r = 0; r < rows_result; r++) {
-                for(int c = 0; c < cols_result; c++) {
-                    #pragma omp task firstprivate(r,c)
-                    {
-                        index = r*rows_result + c;
-                        p_a = a_ia[r];
-                        q_a = a_ia[r+1];
-                        p_b = b_ia[c];
-                        q_b = b_ia[c+1];
-
-                        for(int i = p_a; i < q_a; i++) {
-                            for(int j = p_b; j < q_b; j++) {
-                                if(a_ja[i] == b_ja[j]) {
-                                    parallel_mult_to_dense(dense_matrix, a_nnz[i], b_nnz[j], type, index);
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
+    struct square_args *a = (struct square_args *)arg;
+    CSR_DATA *csr = a->csr;
+    MATRIX_DATA *row;
+    int k;
+    for(SMOPS_INDEX r = p; r < q; r++) {
+        row = a->dense_matrix + (size_t)r*a->cols;
+        for(SMOPS_INDEX i = CSR_ROW(csr, r); i < CSR_ROW(csr, r+1); i++) {
+            k = CSR_COL(csr, i);
+            for(SMOPS_INDEX j = CSR_ROW(csr, k); j < CSR_ROW(csr, k+1); j++) {
+                mult_to_dense(row, csr->nnz[i], csr->nnz[j], a->type, CSR_COL(csr, j));
             }
         }
     }
@@ -108,25 +135,74 @@ int multiplication(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
 
     int rows_result = matrix_a->rows;
     int cols_result = matrix_b->cols;
-    int size_result = rows_result*cols_result;
+    size_t size_result = (size_t)rows_result*cols_result;
 
     CSR_DATA *csr_a = matrix_a->csr_data;
     CSC_DATA *csc_b = matrix_b->csc_data;
 
-    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)calloc(size_result, sizeof(MATRIX_DATA));
+    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)POOL_calloc(ctx, size_result, sizeof(MATRIX_DATA));
     if(dense_matrix == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dense matrix operation");
         return 0;
     }
 
-    switch(ctx->thread_num) {
-        case 1:
-            sequential_multiplication(dense_matrix, csr_a, csc_b, type, rows_result, cols_result);
-            break;
-        default:
-            parallel_multiplication(ctx, dense_matrix, csr_a, csc_b, type, rows_result, cols_result);
-            break;
+    if(matrix_a->format == DENSE) {
+        DENSE_multiplication(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows_result, cols_result);
+        return 1;
+    }
+    if(matrix_a->format == BCSR) {
+        if(BCSR_multiplication(ctx, dense_matrix, matrix_a, matrix_b) == 0) {
+            free(dense_matrix);
+            return 0;
+        }
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows_result, cols_result);
+        return 1;
+    }
+    if(matrix_a->format == BITMAP) {
+        BITMAP_multiplication(ctx, dense_matrix, matrix_a, matrix_b);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows_result, cols_result);
+        return 1;
     }
+
+    //A matrix multiplied with itself only needs its rows, b may be a CSR view without columns
+    if(MATRIX_aliases(matrix_a, matrix_b) && matrix_a->format == CSR) {
+        struct square_args args = { dense_matrix, csr_a, type, cols_result };
+        POOL_parallel_for(ctx, rows_result, 0, square_task, &args);
+        SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows_result, cols_result);
+        return 1;
+    }
+
+    CSR_SPLIT *splits;
+    int parts = POOL_merge_path(ctx, csr_a, rows_result, &splits);
+    if(parts == 0) {
+        free(dense_matrix);
+        return 0;
+    }
+    MATRIX_DATA *carry = (MATRIX_DATA *)calloc((size_t)parts*cols_result + 1, sizeof(MATRIX_DATA));
+    if(carry == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for multiplication carries");
+        free(splits);
+        free(dense_matrix);
+        return 0;
+    }
+    struct multiplication_args args = { dense_matrix, csr_a, csc_b, splits, carry, type, rows_result, cols_result };
+    POOL_parallel_for(ctx, parts, 1, multiplication_task, &args);
+    MATRIX_DATA *row, *part;
+    for(int k = 0; k < parts; k++) {
+        if(splits[k+1].row == rows_result) {continue;}
+        row = dense_matrix + (size_t)splits[k+1].row*cols_result;
+        part = carry + (size_t)k*cols_result;
+        for(int c = 0; c < cols_result; c++) {
+            if(type == FLOAT) {
+                row[c].f += part[c].f;
+            } else {
+                row[c].i += part[c].i;
+            }
+        }
+    }
+    free(carry);
+    free(splits);
     SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, type, rows_result, cols_result);
     return 1;
 }
@@ -136,8 +212,24 @@ int MATRIX_OP_multiplication(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
     struct timespec start, end;
     clock_gettime(CLOCK_REALTIME, &start);
 
-    if(OPS_check_format(ctx, matrix_a, OP, NONE) == 0) {return 0;}
-    if(OPS_check_format(ctx, matrix_b, OP, CSC) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_a, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_b, OP, CSC) == 0) {return 0;}
+
+    //If either matrix was dense enough to be loaded as DENSE then both use the dense engine
+    if(matrix_a->format == DENSE || matrix_b->format == DENSE) {
+        if(MATRIX_convert(ctx, matrix_a, DENSE) == 0) {return 0;}
+        if(MATRIX_convert(ctx, matrix_b, DENSE) == 0) {return 0;}
+    } else if(matrix_a->format == BCSR || matrix_b->format == BCSR) {
+        //Likewise a matrix with dense blocks brings the other one into BCSR with its block size
+        if(BCSR_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    } else if(matrix_a->format == BITMAP || matrix_b->format == BITMAP) {
+        //and a matrix with semi-dense tiles brings the other one into BITMAP
+        if(BITMAP_reconcile(ctx, matrix_a, matrix_b) == 0) {return 0;}
+    } else {
+        if(OPS_check_format(ctx, matrix_a, OP, NONE) == 0) {return 0;}
+        if(OPS_check_format(ctx, matrix_b, OP, CSC) == 0) {return 0;}
+    }
+    OPS_plan_phase(ctx, OP, matrix_a, matrix_b);
 
     if(matrix_a->rows != matrix_b->cols || matrix_a->cols != matrix_b->rows) {
         SMOPS_CTX_fill_err_msg(ctx, "input matrices for multiplication do not have the correct dimensions");
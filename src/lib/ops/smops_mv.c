@@ -0,0 +1,1605 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <immintrin.h>
+
+#include "../smops.h"
+
+#define OP MATRIX_VECTOR_MULT
+#define MV_ROW_CHUNK 64 //a multiple of SELL_C so threads get whole SELL chunks
+
+/** Multiplies the rows p to q of a float CSR matrix with the dense vector x
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in CSR format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+void float_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSR_DATA *csr = matrix->csr_data;
+    MATRIX_DATA *nnz = csr->nnz;
+    SMOPS_INDEX end;
+    int *ja = csr->ja;
+    double sum;
+    for(int r = p; r < q; r++) {
+        sum = 0;
+        end = CSR_ROW(csr, r+1);
+        for(SMOPS_INDEX i = CSR_ROW(csr, r); i < end; i++) {
+            sum += nnz[i].f*x[ja[i]].f;
+        }
+        y[r].f = sum;
+    }
+}
+
+/** Multiplies the rows p to q of an int CSR matrix with the dense vector x
+*
+*   parameters: see float_spmv_rows
+*/
+void int_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSR_DATA *csr = matrix->csr_data;
+    MATRIX_DATA *nnz = csr->nnz;
+    SMOPS_INDEX end;
+    int *ja = csr->ja;
+    int sum;
+    for(int r = p; r < q; r++) {
+        sum = 0;
+        end = CSR_ROW(csr, r+1);
+        for(SMOPS_INDEX i = CSR_ROW(csr, r); i < end; i++) {
+            sum += nnz[i].i*x[ja[i]].i;
+        }
+        y[r].i = sum;
+    }
+}
+
+/** AVX2 version of float_spmv_rows, gathers 8 elements of x per iteration
+*   into two independent accumulators. MATRIX_DATA is 8 bytes wide so the
+*   nnz array can be loaded directly as doubles.
+*
+*   parameters: see float_spmv_rows
+*/
+__attribute__((target("avx2,fma")))
+void float_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSR_DATA *csr = matrix->csr_data;
+    MATRIX_DATA *nnz = csr->nnz;
+    int *ja = csr->ja;
+    double *xd = (double *)x;
+    double sum;
+    SMOPS_INDEX i, end;
+    __m256d acc0, acc1;
+    __m128d lo;
+    for(int r = p; r < q; r++) {
+        i = CSR_ROW(csr, r);
+        end = CSR_ROW(csr, r+1);
+        acc0 = _mm256_setzero_pd();
+        acc1 = _mm256_setzero_pd();
+        for(; i + 8 <= end; i += 8) {
+            __m128i idx0 = _mm_loadu_si128((__m128i *)(ja + i));
+            __m128i idx1 = _mm_loadu_si128((__m128i *)(ja + i + 4));
+            __m256d x0 = _mm256_i32gather_pd(xd, idx0, 8);
+            __m256d x1 = _mm256_i32gather_pd(xd, idx1, 8);
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd((double *)(nnz + i)), x0, acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd((double *)(nnz + i + 4)), x1, acc1);
+        }
+        acc0 = _mm256_add_pd(acc0, acc1);
+        lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+        sum = _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        for(; i < end; i++) {
+            sum += nnz[i].f*x[ja[i]].f;
+        }
+        y[r].f = sum;
+    }
+}
+
+/** AVX2 version of int_spmv_rows, gathers 8 elements of x per iteration.
+*   The int member sits in the low 4 bytes of each 8 byte MATRIX_DATA,
+*   so both the values and x are gathered with a scale of 8.
+*
+*   parameters: see float_spmv_rows
+*/
+__attribute__((target("avx2")))
+void int_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSR_DATA *csr = matrix->csr_data;
+    MATRIX_DATA *nnz = csr->nnz;
+    int *ja = csr->ja;
+    int *xi = (int *)x;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int sum;
+    SMOPS_INDEX i, end;
+    __m256i acc;
+    __m128i lo;
+    for(int r = p; r < q; r++) {
+        i = CSR_ROW(csr, r);
+        end = CSR_ROW(csr, r+1);
+        acc = _mm256_setzero_si256();
+        for(; i + 8 <= end; i += 8) {
+            __m256i idx = _mm256_loadu_si256((__m256i *)(ja + i));
+            __m256i xv = _mm256_i32gather_epi32(xi, idx, 8);
+            __m256i av = _mm256_i32gather_epi32((int *)(nnz + i), lanes, 8);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(av, xv));
+        }
+        lo = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E));
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1));
+        sum = _mm_cvtsi128_si32(lo);
+        for(; i < end; i++) {
+            sum += nnz[i].i*x[ja[i]].i;
+        }
+        y[r].i = sum;
+    }
+}
+
+/** Defines a kernel multiplying the rows p to q of a CSR matrix with the dense
+*   vector x for a width of the column indices and a coding of the values. The
+*   columns are read from JA as IDX_T and the values from VALS as VAL_T, VALUE
+*   decodes the value i.
+*
+*   kernel parameters: see float_spmv_rows
+*/
+#define DEFINE_CSR_SPMV_KERNEL(NAME, FIELD, ACC_T, IDX_T, JA, VAL_T, VALS, VALUE) \
+void NAME(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q) \
+{ \
+    CSR_DATA *csr = matrix->csr_data; \
+    const IDX_T *ja = (const IDX_T *)csr->JA; \
+    const VAL_T *v = (const VAL_T *)csr->VALS; \
+    MATRIX_DATA *dict = csr->packed.dict; \
+    SMOPS_INDEX end; \
+    ACC_T sum; \
+    (void)dict; \
+    for(int r = p; r < q; r++) { \
+        sum = 0; \
+        end = CSR_ROW(csr, r+1); \
+        for(SMOPS_INDEX i = CSR_ROW(csr, r); i < end; i++) { \
+            sum += (VALUE)*x[ja[i]].FIELD; \
+        } \
+        y[r].FIELD = sum; \
+    } \
+}
+
+DEFINE_CSR_SPMV_KERNEL(int_int8_spmv_rows, i, int, int, ja, int8_t, packed.data, v[i])
+DEFINE_CSR_SPMV_KERNEL(int_int16_spmv_rows, i, int, int, ja, int16_t, packed.data, v[i])
+DEFINE_CSR_SPMV_KERNEL(int_dict_spmv_rows, i, int, int, ja, uint8_t, packed.data, dict[v[i]].i)
+DEFINE_CSR_SPMV_KERNEL(float_dict_spmv_rows, f, double, int, ja, uint8_t, packed.data, dict[v[i]].f)
+DEFINE_CSR_SPMV_KERNEL(int_spmv_rows_ja16, i, int, uint16_t, ja16, MATRIX_DATA, nnz, v[i].i)
+DEFINE_CSR_SPMV_KERNEL(int_int8_spmv_rows_ja16, i, int, uint16_t, ja16, int8_t, packed.data, v[i])
+DEFINE_CSR_SPMV_KERNEL(int_int16_spmv_rows_ja16, i, int, uint16_t, ja16, int16_t, packed.data, v[i])
+DEFINE_CSR_SPMV_KERNEL(int_dict_spmv_rows_ja16, i, int, uint16_t, ja16, uint8_t, packed.data, dict[v[i]].i)
+DEFINE_CSR_SPMV_KERNEL(float_spmv_rows_ja16, f, double, uint16_t, ja16, MATRIX_DATA, nnz, v[i].f)
+DEFINE_CSR_SPMV_KERNEL(float_dict_spmv_rows_ja16, f, double, uint16_t, ja16, uint8_t, packed.data, dict[v[i]].f)
+
+#define JA32_LOAD8(i) _mm256_loadu_si256((const __m256i *)(ja + (i)))
+#define JA16_LOAD8(i) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(ja + (i))))
+#define JA32_LOAD4(i) _mm_loadu_si128((const __m128i *)(ja + (i)))
+#define JA16_LOAD4(i) _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(ja + (i))))
+
+/** Defines the AVX2 version of an int CSR kernel, LOAD_JA widens the 8 columns
+*   at ja + i and LOAD the 8 values at v + i to 8 int lanes
+*
+*   kernel parameters: see float_spmv_rows
+*/
+#define DEFINE_INT_CSR_SPMV_KERNEL_AVX2(NAME, IDX_T, JA, LOAD_JA, VAL_T, VALS, LOAD, VALUE) \
+__attribute__((target("avx2"))) \
+void NAME(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q) \
+{ \
+    CSR_DATA *csr = matrix->csr_data; \
+    const IDX_T *ja = (const IDX_T *)csr->JA; \
+    const VAL_T *v = (const VAL_T *)csr->VALS; \
+    MATRIX_DATA *dict = csr->packed.dict; \
+    int *xi = (int *)x; \
+    int sum; \
+    SMOPS_INDEX i, end; \
+    __m256i acc; \
+    __m128i lo; \
+    (void)dict; \
+    for(int r = p; r < q; r++) { \
+        i = CSR_ROW(csr, r); \
+        end = CSR_ROW(csr, r+1); \
+        acc = _mm256_setzero_si256(); \
+        for(; i + 8 <= end; i += 8) { \
+            __m256i xv = _mm256_i32gather_epi32(xi, LOAD_JA(i), 8); \
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(LOAD, xv)); \
+        } \
+        lo = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)); \
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E)); \
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1)); \
+        sum = _mm_cvtsi128_si32(lo); \
+        for(; i < end; i++) { \
+            sum += (VALUE)*x[ja[i]].i; \
+        } \
+        y[r].i = sum; \
+    } \
+}
+
+#define INT_FULL_LOAD _mm256_i32gather_epi32((const int *)(v + i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), 8)
+#define INT_INT8_LOAD _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(v + i)))
+#define INT_INT16_LOAD _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(v + i)))
+#define INT_DICT_LOAD _mm256_i32gather_epi32((const int *)dict, \
+                            _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(v + i))), 8)
+
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_int8_spmv_rows_avx2, int, ja, JA32_LOAD8, int8_t, packed.data,
+    INT_INT8_LOAD, v[i])
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_int16_spmv_rows_avx2, int, ja, JA32_LOAD8, int16_t, packed.data,
+    INT_INT16_LOAD, v[i])
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_dict_spmv_rows_avx2, int, ja, JA32_LOAD8, uint8_t, packed.data,
+    INT_DICT_LOAD, dict[v[i]].i)
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD8, MATRIX_DATA, nnz,
+    INT_FULL_LOAD, v[i].i)
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_int8_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD8, int8_t, packed.data,
+    INT_INT8_LOAD, v[i])
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_int16_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD8, int16_t, packed.data,
+    INT_INT16_LOAD, v[i])
+DEFINE_INT_CSR_SPMV_KERNEL_AVX2(int_dict_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD8, uint8_t, packed.data,
+    INT_DICT_LOAD, dict[v[i]].i)
+
+/** Defines the AVX2 version of a float CSR kernel with two accumulators of 4
+*   lanes. LOAD_JA widens the 4 columns at ja + i to 32 bits, LOAD sets a0 and
+*   a1 to the 8 values at v + i. Dictionary values are gathered from the
+*   dictionary, which stays in L1 cache.
+*
+*   kernel parameters: see float_spmv_rows
+*/
+#define DEFINE_FLOAT_CSR_SPMV_KERNEL_AVX2(NAME, IDX_T, JA, LOAD_JA, VAL_T, VALS, LOAD, VALUE) \
+__attribute__((target("avx2,fma"))) \
+void NAME(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q) \
+{ \
+    CSR_DATA *csr = matrix->csr_data; \
+    const IDX_T *ja = (const IDX_T *)csr->JA; \
+    const VAL_T *v = (const VAL_T *)csr->VALS; \
+    MATRIX_DATA *dict = csr->packed.dict; \
+    const double *dd = (const double *)dict; \
+    double *xd = (double *)x; \
+    double sum; \
+    SMOPS_INDEX i, end; \
+    __m256d acc0, acc1, a0, a1; \
+    __m256i vi; \
+    __m128d lo; \
+    (void)dd; \
+    (void)vi; \
+    for(int r = p; r < q; r++) { \
+        i = CSR_ROW(csr, r); \
+        end = CSR_ROW(csr, r+1); \
+        acc0 = _mm256_setzero_pd(); \
+        acc1 = _mm256_setzero_pd(); \
+        for(; i + 8 <= end; i += 8) { \
+            LOAD; \
+            acc0 = _mm256_fmadd_pd(a0, _mm256_i32gather_pd(xd, LOAD_JA(i), 8), acc0); \
+            acc1 = _mm256_fmadd_pd(a1, _mm256_i32gather_pd(xd, LOAD_JA(i + 4), 8), acc1); \
+        } \
+        acc0 = _mm256_add_pd(acc0, acc1); \
+        lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1)); \
+        sum = _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo))); \
+        for(; i < end; i++) { \
+            sum += (VALUE)*x[ja[i]].f; \
+        } \
+        y[r].f = sum; \
+    } \
+}
+
+#define FLOAT_FULL_LOAD a0 = _mm256_loadu_pd((const double *)(v + i)); \
+                        a1 = _mm256_loadu_pd((const double *)(v + i + 4))
+#define FLOAT_DICT_LOAD vi = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(v + i))); \
+                        a0 = _mm256_i32gather_pd(dd, _mm256_castsi256_si128(vi), 8); \
+                        a1 = _mm256_i32gather_pd(dd, _mm256_extracti128_si256(vi, 1), 8)
+
+DEFINE_FLOAT_CSR_SPMV_KERNEL_AVX2(float_dict_spmv_rows_avx2, int, ja, JA32_LOAD4, uint8_t, packed.data,
+    FLOAT_DICT_LOAD, dict[v[i]].f)
+DEFINE_FLOAT_CSR_SPMV_KERNEL_AVX2(float_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD4, MATRIX_DATA, nnz,
+    FLOAT_FULL_LOAD, v[i].f)
+DEFINE_FLOAT_CSR_SPMV_KERNEL_AVX2(float_dict_spmv_rows_ja16_avx2, uint16_t, ja16, JA16_LOAD4, uint8_t, packed.data,
+    FLOAT_DICT_LOAD, dict[v[i]].f)
+
+/** Multiplies the rows p to q of a float ELL matrix with the dense vector x.
+*   The slots are stored slot major so the inner loop runs over consecutive rows,
+*   padding slots hold 0 at column 0 and need no check.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in ELL format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+void float_ell_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    ELL_DATA *ell = matrix->ell_data;
+    size_t rows = matrix->rows;
+    MATRIX_DATA *nnz;
+    int *ja;
+    int r;
+    for(r = p; r < q; r++) {
+        y[r].f = 0;
+    }
+    for(int s = 0; s < ell->width; s++) {
+        nnz = ell->nnz + s*rows;
+        ja = ell->ja + s*rows;
+        for(r = p; r < q; r++) {
+            y[r].f += nnz[r].f*x[ja[r]].f;
+        }
+    }
+}
+
+/** Multiplies the rows p to q of an int ELL matrix with the dense vector x
+*
+*   parameters: see float_ell_spmv_rows
+*/
+void int_ell_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    ELL_DATA *ell = matrix->ell_data;
+    size_t rows = matrix->rows;
+    MATRIX_DATA *nnz;
+    int *ja;
+    int r;
+    for(r = p; r < q; r++) {
+        y[r].i = 0;
+    }
+    for(int s = 0; s < ell->width; s++) {
+        nnz = ell->nnz + s*rows;
+        ja = ell->ja + s*rows;
+        for(r = p; r < q; r++) {
+            y[r].i += nnz[r].i*x[ja[r]].i;
+        }
+    }
+}
+
+/** AVX2 version of float_ell_spmv_rows, keeps 4 rows in one register for
+*   the whole row so y is written once, the values are contiguous loads.
+*
+*   parameters: see float_ell_spmv_rows
+*/
+__attribute__((target("avx2,fma")))
+void float_ell_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    ELL_DATA *ell = matrix->ell_data;
+    size_t rows = matrix->rows;
+    double *xd = (double *)x;
+    size_t pos;
+    int r = p;
+    __m256d acc;
+    for(; r + 4 <= q; r += 4) {
+        acc = _mm256_setzero_pd();
+        for(int s = 0; s < ell->width; s++) {
+            pos = s*rows + r;
+            __m128i idx = _mm_loadu_si128((__m128i *)(ell->ja + pos));
+            __m256d xv = _mm256_i32gather_pd(xd, idx, 8);
+            acc = _mm256_fmadd_pd(_mm256_loadu_pd((double *)(ell->nnz + pos)), xv, acc);
+        }
+        _mm256_storeu_pd((double *)(y + r), acc);
+    }
+    if(r < q) {
+        float_ell_spmv_rows(y, matrix, x, r, q);
+    }
+}
+
+/** AVX2 version of int_ell_spmv_rows, keeps 8 rows in one register, the int
+*   values are gathered out of the 8 byte MATRIX_DATA with a scale of 8.
+*
+*   parameters: see float_ell_spmv_rows
+*/
+__attribute__((target("avx2")))
+void int_ell_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    ELL_DATA *ell = matrix->ell_data;
+    size_t rows = matrix->rows;
+    int *xi = (int *)x;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int res[8];
+    size_t pos;
+    int r = p;
+    __m256i acc;
+    for(; r + 8 <= q; r += 8) {
+        acc = _mm256_setzero_si256();
+        for(int s = 0; s < ell->width; s++) {
+            pos = s*rows + r;
+            __m256i idx = _mm256_loadu_si256((__m256i *)(ell->ja + pos));
+            __m256i xv = _mm256_i32gather_epi32(xi, idx, 8);
+            __m256i av = _mm256_i32gather_epi32((int *)(ell->nnz + pos), lanes, 8);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(av, xv));
+        }
+        _mm256_storeu_si256((__m256i *)res, acc);
+        for(int l = 0; l < 8; l++) {
+            y[r + l].i = res[l];
+        }
+    }
+    if(r < q) {
+        int_ell_spmv_rows(y, matrix, x, r, q);
+    }
+}
+
+/** Multiplies the lanes p to q of a float SELL matrix with the dense vector x.
+*   p and q are lanes of the sorted rows and are rounded out to whole chunks,
+*   the SELL_C lanes of a chunk are summed together and scattered to their rows.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in SELL format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first lane to multiply
+*       int q: the lane after the last lane to multiply
+*/
+void float_sell_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    double acc[SELL_C];
+    MATRIX_DATA *nnz;
+    int *ja, *perm;
+    int l;
+    for(int k = p/SELL_C; k < (q + SELL_C - 1)/SELL_C; k++) {
+        for(l = 0; l < SELL_C; l++) {
+            acc[l] = 0;
+        }
+        for(int s = 0; s < sell->cl[k]; s++) {
+            nnz = sell->nnz + sell->cs[k] + s*SELL_C;
+            ja = sell->ja + sell->cs[k] + s*SELL_C;
+            #pragma omp simd
+            for(l = 0; l < SELL_C; l++) {
+                acc[l] += nnz[l].f*x[ja[l]].f;
+            }
+        }
+        perm = sell->perm + k*SELL_C;
+        for(l = 0; l < SELL_C && perm[l] >= 0; l++) {
+            y[perm[l]].f = acc[l];
+        }
+    }
+}
+
+/** Multiplies the lanes p to q of an int SELL matrix with the dense vector x
+*
+*   parameters: see float_sell_spmv_rows
+*/
+void int_sell_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    int acc[SELL_C];
+    MATRIX_DATA *nnz;
+    int *ja, *perm;
+    int l;
+    for(int k = p/SELL_C; k < (q + SELL_C - 1)/SELL_C; k++) {
+        for(l = 0; l < SELL_C; l++) {
+            acc[l] = 0;
+        }
+        for(int s = 0; s < sell->cl[k]; s++) {
+            nnz = sell->nnz + sell->cs[k] + s*SELL_C;
+            ja = sell->ja + sell->cs[k] + s*SELL_C;
+            #pragma omp simd
+            for(l = 0; l < SELL_C; l++) {
+                acc[l] += nnz[l].i*x[ja[l]].i;
+            }
+        }
+        perm = sell->perm + k*SELL_C;
+        for(l = 0; l < SELL_C && perm[l] >= 0; l++) {
+            y[perm[l]].i = acc[l];
+        }
+    }
+}
+
+/** AVX2 version of float_sell_spmv_rows, a slot of a chunk is two contiguous
+*   loads of the values and two gathers of x, one per 4 lanes.
+*
+*   parameters: see float_sell_spmv_rows
+*/
+__attribute__((target("avx2,fma")))
+void float_sell_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    double *xd = (double *)x;
+    double acc[SELL_C];
+    int *perm;
+    SMOPS_INDEX pos;
+    int l;
+    __m256d acc0, acc1;
+    for(int k = p/SELL_C; k < (q + SELL_C - 1)/SELL_C; k++) {
+        acc0 = _mm256_setzero_pd();
+        acc1 = _mm256_setzero_pd();
+        for(int s = 0; s < sell->cl[k]; s++) {
+            pos = sell->cs[k] + s*SELL_C;
+            __m128i idx0 = _mm_loadu_si128((__m128i *)(sell->ja + pos));
+            __m128i idx1 = _mm_loadu_si128((__m128i *)(sell->ja + pos + 4));
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd((double *)(sell->nnz + pos)),
+                                    _mm256_i32gather_pd(xd, idx0, 8), acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd((double *)(sell->nnz + pos + 4)),
+                                    _mm256_i32gather_pd(xd, idx1, 8), acc1);
+        }
+        _mm256_storeu_pd(acc, acc0);
+        _mm256_storeu_pd(acc + 4, acc1);
+        perm = sell->perm + k*SELL_C;
+        for(l = 0; l < SELL_C && perm[l] >= 0; l++) {
+            y[perm[l]].f = acc[l];
+        }
+    }
+}
+
+/** AVX2 version of int_sell_spmv_rows, the SELL_C lanes of a slot fill one
+*   register, the int values are gathered with a scale of 8.
+*
+*   parameters: see float_sell_spmv_rows
+*/
+__attribute__((target("avx2")))
+void int_sell_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    int *xi = (int *)x;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int acc[SELL_C];
+    int *perm;
+    SMOPS_INDEX pos;
+    int l;
+    __m256i accv;
+    for(int k = p/SELL_C; k < (q + SELL_C - 1)/SELL_C; k++) {
+        accv = _mm256_setzero_si256();
+        for(int s = 0; s < sell->cl[k]; s++) {
+            pos = sell->cs[k] + s*SELL_C;
+            __m256i idx = _mm256_loadu_si256((__m256i *)(sell->ja + pos));
+            __m256i xv = _mm256_i32gather_epi32(xi, idx, 8);
+            __m256i av = _mm256_i32gather_epi32((int *)(sell->nnz + pos), lanes, 8);
+            accv = _mm256_add_epi32(accv, _mm256_mullo_epi32(av, xv));
+        }
+        _mm256_storeu_si256((__m256i *)acc, accv);
+        perm = sell->perm + k*SELL_C;
+        for(l = 0; l < SELL_C && perm[l] >= 0; l++) {
+            y[perm[l]].i = acc[l];
+        }
+    }
+}
+
+/** Defines a kernel multiplying the block rows starting in the rows p to q of a
+*   BCSR matrix with a block size of B with the dense vector x. B is a constant
+*   so every block multiply is fully unrolled, x and y must be padded to whole
+*   blocks.
+*
+*   kernel parameters:
+*       MATRIX_DATA *y: the dense result vector, padded to block rows*B
+*       MATRIX *matrix: the matrix in BCSR format
+*       MATRIX_DATA *x: the dense vector, padded to block columns*B
+*       int p: the first row
+*       int q: the row after the last row
+*/
+#define DEFINE_BCSR_SPMV_KERNEL(NAME, FIELD, ACC_T, B) \
+void NAME(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q) \
+{ \
+    BCSR_DATA *bcsr = matrix->bcsr_data; \
+    ACC_T acc[B]; \
+    MATRIX_DATA *blk, *xb; \
+    int i, j; \
+    for(int b_row = (p + B - 1)/B; b_row < (q + B - 1)/B; b_row++) { \
+        for(i = 0; i < B; i++) { \
+            acc[i] = 0; \
+        } \
+        for(int n = bcsr->ia[b_row]; n < bcsr->ia[b_row+1]; n++) { \
+            blk = bcsr->nnz + (size_t)n*B*B; \
+            xb = x + bcsr->ja[n]*B; \
+            for(i = 0; i < B; i++) { \
+                for(j = 0; j < B; j++) { \
+                    acc[i] += blk[i*B + j].FIELD*xb[j].FIELD; \
+                } \
+            } \
+        } \
+        for(i = 0; i < B; i++) { \
+            y[b_row*B + i].FIELD = acc[i]; \
+        } \
+    } \
+}
+
+DEFINE_BCSR_SPMV_KERNEL(float_bcsr_spmv_b2, f, double, 2)
+DEFINE_BCSR_SPMV_KERNEL(float_bcsr_spmv_b3, f, double, 3)
+DEFINE_BCSR_SPMV_KERNEL(float_bcsr_spmv_b4, f, double, 4)
+
+DEFINE_BCSR_SPMV_KERNEL(int_bcsr_spmv_b2, i, int, 2)
+DEFINE_BCSR_SPMV_KERNEL(int_bcsr_spmv_b3, i, int, 3)
+DEFINE_BCSR_SPMV_KERNEL(int_bcsr_spmv_b4, i, int, 4)
+
+/** Multiplies the rows p to q of a float DIA matrix with the dense vector x.
+*   Every diagonal is a contiguous run of values multiplied with a contiguous
+*   run of x, so the loop over the rows needs no column index.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in DIA format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+void float_dia_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    DIA_DATA *dia = matrix->dia_data;
+    MATRIX_DATA *values;
+    int k, first, lo, hi, r;
+    for(r = p; r < q; r++) {
+        y[r].f = 0;
+    }
+    for(int d = 0; d < dia->diagonals; d++) {
+        k = dia->offsets[d];
+        first = k < 0 ? -k : 0;
+        lo = first > p ? first : p;
+        hi = matrix->cols - k < q ? matrix->cols - k : q;
+        values = dia->values + dia->start[d];
+        #pragma omp simd
+        for(r = lo; r < hi; r++) {
+            y[r].f += values[r - first].f*x[r + k].f;
+        }
+    }
+}
+
+/** Multiplies the rows p to q of an int DIA matrix with the dense vector x
+*
+*   parameters: see float_dia_spmv_rows
+*/
+void int_dia_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    DIA_DATA *dia = matrix->dia_data;
+    MATRIX_DATA *values;
+    int k, first, lo, hi, r;
+    for(r = p; r < q; r++) {
+        y[r].i = 0;
+    }
+    for(int d = 0; d < dia->diagonals; d++) {
+        k = dia->offsets[d];
+        first = k < 0 ? -k : 0;
+        lo = first > p ? first : p;
+        hi = matrix->cols - k < q ? matrix->cols - k : q;
+        values = dia->values + dia->start[d];
+        #pragma omp simd
+        for(r = lo; r < hi; r++) {
+            y[r].i += values[r - first].i*x[r + k].i;
+        }
+    }
+}
+
+/** Multiplies the stored rows p to q of a float DCSR matrix with the dense vector x.
+*   Only the rows with a non zero element are visited, y has to be zeroed for the
+*   empty rows.
+*
+*   parameters:
+*       MATRIX_DATA *y: the zeroed dense result vector
+*       MATRIX *matrix: the matrix in DCSR format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first stored row to multiply
+*       int q: the stored row after the last stored row to multiply
+*/
+void float_dcsr_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    DCSR_DATA *dcsr = matrix->dcsr_data;
+    MATRIX_DATA *nnz = dcsr->nnz;
+    int *ja = dcsr->ja;
+    double sum;
+    SMOPS_INDEX i;
+    for(int n = p; n < q; n++) {
+        sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for(i = dcsr->ia[n]; i < dcsr->ia[n+1]; i++) {
+            sum += nnz[i].f*x[ja[i]].f;
+        }
+        y[dcsr->row_ids[n]].f = sum;
+    }
+}
+
+/** Multiplies the stored rows p to q of an int DCSR matrix with the dense vector x
+*
+*   parameters: see float_dcsr_spmv_rows
+*/
+void int_dcsr_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    DCSR_DATA *dcsr = matrix->dcsr_data;
+    MATRIX_DATA *nnz = dcsr->nnz;
+    int *ja = dcsr->ja;
+    int sum;
+    SMOPS_INDEX i;
+    for(int n = p; n < q; n++) {
+        sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for(i = dcsr->ia[n]; i < dcsr->ia[n+1]; i++) {
+            sum += nnz[i].i*x[ja[i]].i;
+        }
+        y[dcsr->row_ids[n]].i = sum;
+    }
+}
+
+/** Multiplies the block rows p to q of a float CSB matrix with the dense vector x.
+*   A block row only writes its beta rows of y, the blocks along it read one
+*   beta long piece of x each.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in CSB format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first block row to multiply
+*       int q: the block row after the last block row to multiply
+*/
+void float_csb_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSB_DATA *csb = matrix->csb_data;
+    int beta = csb->beta;
+    MATRIX_DATA *yb, *xb;
+    SMOPS_INDEX *blk_ptr;
+    SMOPS_INDEX i;
+    int r, end;
+    for(int b_row = p; b_row < q; b_row++) {
+        yb = y + (size_t)b_row*beta;
+        end = matrix->rows - b_row*beta < beta ? matrix->rows - b_row*beta : beta;
+        for(r = 0; r < end; r++) {
+            yb[r].f = 0;
+        }
+        blk_ptr = csb->blk_ptr + (size_t)b_row*csb->block_cols;
+        for(int b_col = 0; b_col < csb->block_cols; b_col++) {
+            xb = x + (size_t)b_col*beta;
+            for(i = blk_ptr[b_col]; i < blk_ptr[b_col+1]; i++) {
+                yb[csb->lo_i[i]].f += csb->values[i].f*xb[csb->lo_j[i]].f;
+            }
+        }
+    }
+}
+
+/** Multiplies the block rows p to q of an int CSB matrix with the dense vector x
+*
+*   parameters: see float_csb_spmv_rows
+*/
+void int_csb_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSB_DATA *csb = matrix->csb_data;
+    int beta = csb->beta;
+    MATRIX_DATA *yb, *xb;
+    SMOPS_INDEX *blk_ptr;
+    SMOPS_INDEX i;
+    int r, end;
+    for(int b_row = p; b_row < q; b_row++) {
+        yb = y + (size_t)b_row*beta;
+        end = matrix->rows - b_row*beta < beta ? matrix->rows - b_row*beta : beta;
+        for(r = 0; r < end; r++) {
+            yb[r].i = 0;
+        }
+        blk_ptr = csb->blk_ptr + (size_t)b_row*csb->block_cols;
+        for(int b_col = 0; b_col < csb->block_cols; b_col++) {
+            xb = x + (size_t)b_col*beta;
+            for(i = blk_ptr[b_col]; i < blk_ptr[b_col+1]; i++) {
+                yb[csb->lo_i[i]].i += csb->values[i].i*xb[csb->lo_j[i]].i;
+            }
+        }
+    }
+}
+
+/** Multiplies the tile rows starting in the rows p to q of a float bitmap tile
+*   matrix with the dense vector x. The set bits of a mask are walked in order,
+*   which is the order its values are packed in, so the values are read straight
+*   through. y must be padded to whole tiles.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector, padded to tile rows*BITMAP_TILE
+*       MATRIX *matrix: the matrix in BITMAP format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row
+*       int q: the row after the last row
+*/
+void float_bitmap_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    BITMAP_DATA *bitmap = matrix->bitmap_data;
+    double acc[BITMAP_TILE];
+    MATRIX_DATA *v, *xb;
+    uint64_t mask;
+    int i, bit;
+    for(int t_row = (p + BITMAP_TILE - 1)/BITMAP_TILE; t_row < (q + BITMAP_TILE - 1)/BITMAP_TILE; t_row++) {
+        for(i = 0; i < BITMAP_TILE; i++) {
+            acc[i] = 0;
+        }
+        for(int n = bitmap->ia[t_row]; n < bitmap->ia[t_row+1]; n++) {
+            mask = bitmap->masks[n];
+            v = bitmap->values + bitmap->val_ptr[n];
+            xb = x + bitmap->ja[n]*BITMAP_TILE;
+            while(mask != 0) {
+                bit = __builtin_ctzll(mask);
+                acc[bit/BITMAP_TILE] += (v++)->f*xb[bit % BITMAP_TILE].f;
+                mask &= mask - 1;
+            }
+        }
+        for(i = 0; i < BITMAP_TILE; i++) {
+            y[t_row*BITMAP_TILE + i].f = acc[i];
+        }
+    }
+}
+
+/** Multiplies the tile rows starting in the rows p to q of an int bitmap tile
+*   matrix with the dense vector x
+*
+*   parameters: see float_bitmap_spmv_rows
+*/
+void int_bitmap_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    BITMAP_DATA *bitmap = matrix->bitmap_data;
+    int acc[BITMAP_TILE];
+    MATRIX_DATA *v, *xb;
+    uint64_t mask;
+    int i, bit;
+    for(int t_row = (p + BITMAP_TILE - 1)/BITMAP_TILE; t_row < (q + BITMAP_TILE - 1)/BITMAP_TILE; t_row++) {
+        for(i = 0; i < BITMAP_TILE; i++) {
+            acc[i] = 0;
+        }
+        for(int n = bitmap->ia[t_row]; n < bitmap->ia[t_row+1]; n++) {
+            mask = bitmap->masks[n];
+            v = bitmap->values + bitmap->val_ptr[n];
+            xb = x + bitmap->ja[n]*BITMAP_TILE;
+            while(mask != 0) {
+                bit = __builtin_ctzll(mask);
+                acc[bit/BITMAP_TILE] += (v++)->i*xb[bit % BITMAP_TILE].i;
+                mask &= mask - 1;
+            }
+        }
+        for(i = 0; i < BITMAP_TILE; i++) {
+            y[t_row*BITMAP_TILE + i].i = acc[i];
+        }
+    }
+}
+
+/** Gets the expand indices of one tile row for the simd bitmap kernels. pdep
+*   spreads the 8 bit row mask to a byte mask (0xFF for every set column) and
+*   deposits the ranks 0, 1, 2, ... into the set bytes in order, so byte j holds
+*   the position of column j in the packed values of the row.
+*
+*   parameters:
+*       unsigned row: the 8 bit occupancy of the tile row
+*       __m256i *sel: set to -1 in the lanes of the set columns, 0 otherwise
+*
+*   return:
+*       the position in the packed values of every set column (32 bit lanes)
+*/
+__attribute__((target("avx2,bmi2")))
+static inline __m256i bitmap_expand_row(unsigned row, __m256i *sel)
+{
+    uint64_t spread = _pdep_u64(row, 0x0101010101010101ULL)*0xFF;
+    uint64_t rank = _pdep_u64(0x0706050403020100ULL, spread);
+    *sel = _mm256_cvtepi8_epi32(_mm_cvtsi64_si128((long long)spread));
+    return _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)rank));
+}
+
+/** AVX2 version of float_bitmap_spmv_rows. Every row of a tile is expanded from
+*   its packed values to 8 lanes with a masked gather at the pdep ranks and
+*   multiplied with the 8 contiguous elements of x under the tile, so x must be
+*   padded to whole tiles.
+*
+*   parameters: see float_bitmap_spmv_rows
+*/
+__attribute__((target("avx2,fma,bmi2")))
+void float_bitmap_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    BITMAP_DATA *bitmap = matrix->bitmap_data;
+    const __m256d zero = _mm256_setzero_pd();
+    __m256d acc0, acc1, a0, a1;
+    __m256i idx, sel;
+    __m128d lo;
+    uint64_t mask;
+    unsigned row;
+    double *v, *xb;
+    int n, end;
+    for(int t_row = (p + BITMAP_TILE - 1)/BITMAP_TILE; t_row < (q + BITMAP_TILE - 1)/BITMAP_TILE; t_row++) {
+        end = bitmap->ia[t_row+1];
+        for(int i = 0; i < BITMAP_TILE; i++) {
+            acc0 = _mm256_setzero_pd();
+            acc1 = _mm256_setzero_pd();
+            for(n = bitmap->ia[t_row]; n < end; n++) {
+                mask = bitmap->masks[n];
+                row = (mask >> (i*BITMAP_TILE)) & 0xFF;
+                if(row == 0) {continue;}
+                v = (double *)(bitmap->values + bitmap->val_ptr[n]
+                        + __builtin_popcountll(mask & (((uint64_t)1 << (i*BITMAP_TILE)) - 1)));
+                xb = (double *)(x + bitmap->ja[n]*BITMAP_TILE);
+                idx = bitmap_expand_row(row, &sel);
+                a0 = _mm256_mask_i32gather_pd(zero, v, _mm256_castsi256_si128(idx),
+                        _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(sel))), 8);
+                a1 = _mm256_mask_i32gather_pd(zero, v, _mm256_extracti128_si256(idx, 1),
+                        _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(sel, 1))), 8);
+                acc0 = _mm256_fmadd_pd(a0, _mm256_loadu_pd(xb), acc0);
+                acc1 = _mm256_fmadd_pd(a1, _mm256_loadu_pd(xb + 4), acc1);
+            }
+            acc0 = _mm256_add_pd(acc0, acc1);
+            lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+            y[t_row*BITMAP_TILE + i].f = _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        }
+    }
+}
+
+/** AVX2 version of int_bitmap_spmv_rows, the int member sits in the low 4 bytes
+*   of each 8 byte MATRIX_DATA so the values and x are gathered with a scale of 8
+*
+*   parameters: see float_bitmap_spmv_rows
+*/
+__attribute__((target("avx2,bmi2")))
+void int_bitmap_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    BITMAP_DATA *bitmap = matrix->bitmap_data;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc, av, xv, idx, sel;
+    __m128i lo;
+    uint64_t mask;
+    unsigned row;
+    int *v;
+    int n, end;
+    for(int t_row = (p + BITMAP_TILE - 1)/BITMAP_TILE; t_row < (q + BITMAP_TILE - 1)/BITMAP_TILE; t_row++) {
+        end = bitmap->ia[t_row+1];
+        for(int i = 0; i < BITMAP_TILE; i++) {
+            acc = _mm256_setzero_si256();
+            for(n = bitmap->ia[t_row]; n < end; n++) {
+                mask = bitmap->masks[n];
+                row = (mask >> (i*BITMAP_TILE)) & 0xFF;
+                if(row == 0) {continue;}
+                v = (int *)(bitmap->values + bitmap->val_ptr[n]
+                        + __builtin_popcountll(mask & (((uint64_t)1 << (i*BITMAP_TILE)) - 1)));
+                idx = bitmap_expand_row(row, &sel);
+                av = _mm256_mask_i32gather_epi32(zero, v, idx, sel, 8);
+                xv = _mm256_i32gather_epi32((int *)(x + bitmap->ja[n]*BITMAP_TILE), lanes, 8);
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(av, xv));
+            }
+            lo = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E));
+            lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1));
+            y[t_row*BITMAP_TILE + i].i = _mm_cvtsi128_si32(lo);
+        }
+    }
+}
+
+/** Multiplies the rows p to q of a float CSR-DU matrix with the dense vector x.
+*   The columns of a row are decoded CSRDU_BATCH at a time into a buffer on the
+*   stack, so only the compressed stream is read from memory.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in CSRDU format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+void float_csrdu_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    MATRIX_DATA *nnz;
+    double sum;
+    SMOPS_INDEX i;
+    int k, j, col;
+    for(int r = p; r < q; r++) {
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        sum = 0;
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = CSRDU_decode(buf, ja, col, k);
+            col = buf[k - 1];
+            nnz = du->nnz + i;
+            for(j = 0; j < k; j++) {
+                sum += nnz[j].f*x[buf[j]].f;
+            }
+        }
+        y[r].f = sum;
+    }
+}
+
+/** Multiplies the rows p to q of an int CSR-DU matrix with the dense vector x
+*
+*   parameters: see float_csrdu_spmv_rows
+*/
+void int_csrdu_spmv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    MATRIX_DATA *nnz;
+    int sum, k, j, col;
+    SMOPS_INDEX i;
+    for(int r = p; r < q; r++) {
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        sum = 0;
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = CSRDU_decode(buf, ja, col, k);
+            col = buf[k - 1];
+            nnz = du->nnz + i;
+            for(j = 0; j < k; j++) {
+                sum += nnz[j].i*x[buf[j]].i;
+            }
+        }
+        y[r].i = sum;
+    }
+}
+
+/** AVX2 version of float_csrdu_spmv_rows, the columns are decoded with
+*   CSRDU_decode_avx2 and x is gathered 8 elements at a time like float_spmv_rows_avx2
+*
+*   parameters: see float_csrdu_spmv_rows
+*/
+__attribute__((target("avx2,fma")))
+void float_csrdu_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    double *xd = (double *)x;
+    double *nnz;
+    double sum;
+    SMOPS_INDEX i;
+    int k, j, col;
+    __m256d acc0, acc1;
+    __m128d lo;
+    for(int r = p; r < q; r++) {
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        sum = 0;
+        acc0 = _mm256_setzero_pd();
+        acc1 = _mm256_setzero_pd();
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = CSRDU_decode_avx2(buf, ja, col, k);
+            col = buf[k - 1];
+            nnz = (double *)(du->nnz + i);
+            for(j = 0; j + 8 <= k; j += 8) {
+                __m256d x0 = _mm256_i32gather_pd(xd, _mm_loadu_si128((__m128i *)(buf + j)), 8);
+                __m256d x1 = _mm256_i32gather_pd(xd, _mm_loadu_si128((__m128i *)(buf + j + 4)), 8);
+                acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(nnz + j), x0, acc0);
+                acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(nnz + j + 4), x1, acc1);
+            }
+            for(; j < k; j++) {
+                sum += nnz[j]*xd[buf[j]];
+            }
+        }
+        acc0 = _mm256_add_pd(acc0, acc1);
+        lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+        y[r].f = sum + _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+    }
+}
+
+/** AVX2 version of int_csrdu_spmv_rows, the int member sits in the low 4 bytes of
+*   each 8 byte MATRIX_DATA so the values and x are gathered with a scale of 8
+*
+*   parameters: see float_csrdu_spmv_rows
+*/
+__attribute__((target("avx2")))
+void int_csrdu_spmv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    int *xi = (int *)x;
+    MATRIX_DATA *nnz;
+    int sum, k, j, col;
+    SMOPS_INDEX i;
+    __m256i acc;
+    __m128i lo;
+    for(int r = p; r < q; r++) {
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        sum = 0;
+        acc = _mm256_setzero_si256();
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = CSRDU_decode_avx2(buf, ja, col, k);
+            col = buf[k - 1];
+            nnz = du->nnz + i;
+            for(j = 0; j + 8 <= k; j += 8) {
+                __m256i xv = _mm256_i32gather_epi32(xi, _mm256_loadu_si256((__m256i *)(buf + j)), 8);
+                __m256i av = _mm256_i32gather_epi32((int *)(nnz + j), lanes, 8);
+                acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(av, xv));
+            }
+            for(; j < k; j++) {
+                sum += nnz[j].i*x[buf[j]].i;
+            }
+        }
+        lo = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E));
+        lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1));
+        y[r].i = sum + _mm_cvtsi128_si32(lo);
+    }
+}
+
+/** Multiplies the rows p to q of a float DENSE matrix with the dense vector x
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in DENSE format
+*       MATRIX_DATA *x: the dense vector multiplied with the matrix
+*       int p: the first row to multiply
+*       int q: the row after the last row to multiply
+*/
+void float_dense_gemv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    int cols = matrix->cols;
+    MATRIX_DATA *a;
+    double sum;
+    int c;
+    for(int r = p; r < q; r++) {
+        a = matrix->dense_data->values + (size_t)r*cols;
+        sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for(c = 0; c < cols; c++) {
+            sum += a[c].f*x[c].f;
+        }
+        y[r].f = sum;
+    }
+}
+
+/** Multiplies the rows p to q of an int DENSE matrix with the dense vector x
+*
+*   parameters: see float_dense_gemv_rows
+*/
+void int_dense_gemv_rows(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    int cols = matrix->cols;
+    MATRIX_DATA *a;
+    int sum, c;
+    for(int r = p; r < q; r++) {
+        a = matrix->dense_data->values + (size_t)r*cols;
+        sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for(c = 0; c < cols; c++) {
+            sum += a[c].i*x[c].i;
+        }
+        y[r].i = sum;
+    }
+}
+
+/** AVX2 version of float_dense_gemv_rows with two independent accumulators
+*
+*   parameters: see float_dense_gemv_rows
+*/
+__attribute__((target("avx2,fma")))
+void float_dense_gemv_rows_avx2(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    int cols = matrix->cols;
+    double *xd = (double *)x;
+    double *a;
+    double sum;
+    int c;
+    __m256d acc0, acc1;
+    __m128d lo;
+    for(int r = p; r < q; r++) {
+        a = (double *)(matrix->dense_data->values + (size_t)r*cols);
+        acc0 = _mm256_setzero_pd();
+        acc1 = _mm256_setzero_pd();
+        for(c = 0; c + 8 <= cols; c += 8) {
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + c), _mm256_loadu_pd(xd + c), acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + c + 4), _mm256_loadu_pd(xd + c + 4), acc1);
+        }
+        acc0 = _mm256_add_pd(acc0, acc1);
+        lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+        sum = _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        for(; c < cols; c++) {
+            sum += a[c]*xd[c];
+        }
+        y[r].f = sum;
+    }
+}
+
+typedef void (*SPMV_KERNEL)(MATRIX_DATA *, MATRIX *, MATRIX_DATA *, int, int);
+
+/** Selects the row kernel for a CSR matrix from the width of its columns and
+*   the coding of its values
+*
+*   parameters:
+*       MATRIX *matrix: the matrix in CSR format
+*       int simd: 1 if the simd kernels are used, 0 otherwise
+*
+*   return:
+*       the row kernel to use, NULL if no kernel reads the coding
+*/
+SPMV_KERNEL spmv_select_csr_kernel(MATRIX *matrix, int simd)
+{
+    SPMV_KERNEL int_kernels[2][4] = {
+        { int_spmv_rows, int_int8_spmv_rows, int_int16_spmv_rows, int_dict_spmv_rows },
+        { int_spmv_rows_ja16, int_int8_spmv_rows_ja16, int_int16_spmv_rows_ja16, int_dict_spmv_rows_ja16 } };
+    SPMV_KERNEL int_simd_kernels[2][4] = {
+        { int_spmv_rows_avx2, int_int8_spmv_rows_avx2, int_int16_spmv_rows_avx2, int_dict_spmv_rows_avx2 },
+        { int_spmv_rows_ja16_avx2, int_int8_spmv_rows_ja16_avx2, int_int16_spmv_rows_ja16_avx2,
+            int_dict_spmv_rows_ja16_avx2 } };
+    SPMV_KERNEL float_kernels[2][4] = {
+        { float_spmv_rows, NULL, NULL, float_dict_spmv_rows },
+        { float_spmv_rows_ja16, NULL, NULL, float_dict_spmv_rows_ja16 } };
+    SPMV_KERNEL float_simd_kernels[2][4] = {
+        { float_spmv_rows_avx2, NULL, NULL, float_dict_spmv_rows_avx2 },
+        { float_spmv_rows_ja16_avx2, NULL, NULL, float_dict_spmv_rows_ja16_avx2 } };
+    int ja16 = matrix->csr_data->ja16 != NULL;
+    VALUE_CODING coding = matrix->csr_data->packed.coding;
+    if(matrix->type == INT) {
+        return simd ? int_simd_kernels[ja16][coding] : int_kernels[ja16][coding];
+    }
+    return simd ? float_simd_kernels[ja16][coding] : float_kernels[ja16][coding];
+}
+
+/** Selects the row kernel for the format, type and kernel variant chosen by the planner
+*
+*   parameters:
+*       MATRIX *matrix: the matrix in CSR, DCSR, CSRDU, ELL, SELL, BCSR, DIA, CSB, BITMAP or DENSE
+*                       format
+*
+*   return:
+*       the row kernel to use, NULL if the type is UNDEFINED
+*/
+SPMV_KERNEL spmv_select_kernel(MATRIX *matrix)
+{
+    SPMV_KERNEL float_bcsr_kernels[] = { float_bcsr_spmv_b2, float_bcsr_spmv_b3, float_bcsr_spmv_b4 };
+    SPMV_KERNEL int_bcsr_kernels[] = { int_bcsr_spmv_b2, int_bcsr_spmv_b3, int_bcsr_spmv_b4 };
+    int simd = matrix->kernel == KERNEL_SIMD;
+    switch(matrix->type) {
+        case INT:
+            switch(matrix->format) {
+                case ELL:
+                    return simd ? int_ell_spmv_rows_avx2 : int_ell_spmv_rows;
+                case SELL:
+                    return simd ? int_sell_spmv_rows_avx2 : int_sell_spmv_rows;
+                case BCSR:
+                    return int_bcsr_kernels[matrix->bcsr_data->block - BCSR_MIN_BLOCK];
+                case DIA:
+                    return int_dia_spmv_rows;
+                case DCSR:
+                    return int_dcsr_spmv_rows;
+                case CSB:
+                    return int_csb_spmv_rows;
+                case BITMAP:
+                    return simd ? int_bitmap_spmv_rows_avx2 : int_bitmap_spmv_rows;
+                case CSRDU:
+                    return simd ? int_csrdu_spmv_rows_avx2 : int_csrdu_spmv_rows;
+                case DENSE:
+                    return int_dense_gemv_rows;
+                case CSR:
+                    return spmv_select_csr_kernel(matrix, simd);
+                default:
+                    return simd ? int_spmv_rows_avx2 : int_spmv_rows;
+            }
+        case FLOAT:
+            switch(matrix->format) {
+                case ELL:
+                    return simd ? float_ell_spmv_rows_avx2 : float_ell_spmv_rows;
+                case SELL:
+                    return simd ? float_sell_spmv_rows_avx2 : float_sell_spmv_rows;
+                case BCSR:
+                    return float_bcsr_kernels[matrix->bcsr_data->block - BCSR_MIN_BLOCK];
+                case DIA:
+                    return float_dia_spmv_rows;
+                case DCSR:
+                    return float_dcsr_spmv_rows;
+                case CSB:
+                    return float_csb_spmv_rows;
+                case BITMAP:
+                    return simd ? float_bitmap_spmv_rows_avx2 : float_bitmap_spmv_rows;
+                case CSRDU:
+                    return simd ? float_csrdu_spmv_rows_avx2 : float_csrdu_spmv_rows;
+                case DENSE:
+                    return simd ? float_dense_gemv_rows_avx2 : float_dense_gemv_rows;
+                case CSR:
+                    return spmv_select_csr_kernel(matrix, simd);
+                default:
+                    return simd ? float_spmv_rows_avx2 : float_spmv_rows;
+            }
+        default:
+            return NULL;
+    }
+}
+
+/** Arguments of spmv_task */
+struct spmv_args {
+    MATRIX_DATA *y;
+    MATRIX *matrix;
+    MATRIX_DATA *x;
+    SPMV_KERNEL kernel;
+};
+
+/** Runs the row kernel over the rows p to q
+*
+*   parameters:
+*       void *arg: the struct spmv_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void spmv_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct spmv_args *args = (struct spmv_args *)arg;
+    args->kernel(args->y, args->matrix, args->x, (int)p, (int)q);
+}
+
+/** Multiplies the non zero elements p to q of a row of a CSR matrix with x by
+*   running the row kernel on a copy of the matrix whose only row is them
+*
+*   parameters:
+*       MATRIX *matrix: the matrix in CSR format
+*       MATRIX_DATA *x: the dense vector
+*       SPMV_KERNEL kernel: the row kernel of the matrix
+*       SMOPS_INDEX p: the first non zero element
+*       SMOPS_INDEX q: the non zero element after the last one
+*
+*   return:
+*       the dot product of the elements with x
+*/
+MATRIX_DATA spmv_csr_segment(MATRIX *matrix, MATRIX_DATA *x, SPMV_KERNEL kernel, SMOPS_INDEX p, SMOPS_INDEX q)
+{
+    MATRIX segment = *matrix;
+    CSR_DATA csr = *matrix->csr_data;
+    SMOPS_INDEX ia[2] = { p, q };
+    MATRIX_DATA y;
+    csr.ia = ia;
+    csr.ia32 = NULL;
+    segment.csr_data = &csr;
+    kernel(&y, &segment, x, 0, 1);
+    return y;
+}
+
+/** Arguments of spmv_csr_task
+*   splits: the merge path splits of the matrix
+*   carry: the sum of the unfinished row at the end of every part
+*/
+struct spmv_csr_args {
+    MATRIX_DATA *y;
+    MATRIX *matrix;
+    MATRIX_DATA *x;
+    SPMV_KERNEL kernel;
+    CSR_SPLIT *splits;
+    MATRIX_DATA *carry;
+};
+
+/** Multiplies the merge path parts p to q of a CSR matrix with x. A row begun
+*   by an earlier part is finished with its own elements only, the rows inside
+*   the part go to the row kernel and the elements of the row the part ends in
+*   are summed into the carry of the part.
+*
+*   parameters:
+*       void *arg: the struct spmv_csr_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void spmv_csr_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct spmv_csr_args *args = (struct spmv_csr_args *)arg;
+    CSR_DATA *csr = args->matrix->csr_data;
+    CSR_SPLIT start, end;
+    int first;
+    for(SMOPS_INDEX k = p; k < q; k++) {
+        start = args->splits[k];
+        end = args->splits[k+1];
+        first = start.row;
+        if(first < end.row && CSR_ROW(csr, first) < start.nz) {
+            args->y[first] = spmv_csr_segment(args->matrix, args->x, args->kernel, start.nz, CSR_ROW(csr, first+1));
+            first++;
+        }
+        if(first < end.row) {
+            args->kernel(args->y, args->matrix, args->x, first, end.row);
+        }
+        if(end.row < args->matrix->rows) {
+            args->carry[k] = spmv_csr_segment(args->matrix, args->x, args->kernel,
+                                CSR_ROW(csr, end.row) > start.nz ? CSR_ROW(csr, end.row) : start.nz, end.nz);
+        }
+    }
+}
+
+/** Performs y = matrix*vector for a CSR matrix with the merge path split into
+*   parts of equal rows plus non zero elements, so a few long rows are shared
+*   between threads. The carries of rows split between parts are added after.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads and error handling
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix in CSR format
+*       MATRIX_DATA *x: the dense vector
+*       SPMV_KERNEL kernel: the row kernel to use
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int spmv_csr(SMOPS_CTX *ctx, MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, SPMV_KERNEL kernel)
+{
+    CSR_SPLIT *splits;
+    int parts = POOL_merge_path(ctx, matrix->csr_data, matrix->rows, &splits);
+    if(parts == 0) {return 0;}
+    MATRIX_DATA *carry = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*parts);
+    if(carry == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for spmv carries");
+        free(splits);
+        return 0;
+    }
+
+    struct spmv_csr_args args = { y, matrix, x, kernel, splits, carry };
+    POOL_parallel_for(ctx, parts, 1, spmv_csr_task, &args);
+    for(int k = 0; k < parts; k++) {
+        if(splits[k+1].row == matrix->rows) {continue;}
+        if(matrix->type == FLOAT) {
+            y[splits[k+1].row].f += carry[k].f;
+        } else {
+            y[splits[k+1].row].i += carry[k].i;
+        }
+    }
+    free(carry);
+    free(splits);
+    return 1;
+}
+
+/** Performs y = matrix*vector, splitting the rows between threads. The rows of
+*   a DCSR matrix are its stored rows, a CSB matrix is split by block rows and
+*   a CSR matrix by its merge path.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads and error handling
+*       MATRIX_DATA *y: the dense result vector
+*       MATRIX *matrix: the matrix
+*       MATRIX_DATA *x: the dense vector
+*       SPMV_KERNEL kernel: the row kernel to use
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int spmv(SMOPS_CTX *ctx, MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, SPMV_KERNEL kernel)
+{
+    int rows = matrix->rows;
+    int chunk = MV_ROW_CHUNK;
+    switch(matrix->format) {
+        case CSR:
+            return spmv_csr(ctx, y, matrix, x, kernel);
+        case DCSR:
+            rows = matrix->dcsr_data->nzr;
+            break;
+        case CSB:
+            rows = matrix->csb_data->block_rows;
+            chunk = 1;
+            break;
+        default:
+            break;
+    }
+    struct spmv_args args = { y, matrix, x, kernel };
+    POOL_parallel_for(ctx, rows, chunk, spmv_task, &args);
+    return 1;
+}
+
+/** Gets the bytes a CSR matrix with packed values or 16 bit columns saves over
+*   full values and int columns
+*
+*   parameters:
+*       MATRIX *matrix: the matrix
+*
+*   return:
+*       the bytes not read from the values and columns less the dictionary, 0 if
+*       the matrix is not in CSR format
+*/
+double spmv_csr_saving(MATRIX *matrix)
+{
+    if(matrix->format != CSR) {return 0;}
+    PACKED_VALUES *packed = &matrix->csr_data->packed;
+    double saving = 0;
+    if(matrix->csr_data->ja16 != NULL) {
+        saving = (double)matrix->non_zero_size*(sizeof(int) - sizeof(uint16_t));
+    }
+    switch(packed->coding) {
+        case VALUES_INT8:
+            return saving + (double)matrix->non_zero_size*(sizeof(MATRIX_DATA) - sizeof(int8_t));
+        case VALUES_INT16:
+            return saving + (double)matrix->non_zero_size*(sizeof(MATRIX_DATA) - sizeof(int16_t));
+        case VALUES_DICT:
+            return saving + (double)matrix->non_zero_size*(sizeof(MATRIX_DATA) - sizeof(uint8_t))
+                    - (double)packed->dict_size*sizeof(MATRIX_DATA);
+        default:
+            return saving;
+    }
+}
+
+/** Gets the number of bytes of the matrix read by one spmv
+*
+*   parameters:
+*       MATRIX *matrix: the matrix in CSR, DCSR, CSRDU, ELL, SELL, BCSR, DIA, CSB, BITMAP or DENSE
+*                       format
+*
+*   return:
+*       the bytes read from the values and indices of the matrix
+*/
+double spmv_matrix_bytes(MATRIX *matrix)
+{
+    double entry = sizeof(MATRIX_DATA) + sizeof(int);
+    switch(matrix->format) {
+        case ELL:
+            return (double)matrix->ell_data->width*matrix->rows*entry;
+        case SELL:
+            return (double)matrix->sell_data->cs[matrix->sell_data->chunks]*entry
+                    + matrix->sell_data->chunks*(SELL_C + 2.0)*sizeof(int);
+        case BCSR:
+            return (double)matrix->bcsr_data->blocks*(matrix->bcsr_data->block*matrix->bcsr_data->block
+                    *sizeof(MATRIX_DATA) + sizeof(int)) + (matrix->bcsr_data->block_rows + 1.0)*sizeof(int);
+        case DENSE:
+            return (double)matrix->size*sizeof(MATRIX_DATA);
+        case DIA:
+            return (double)matrix->dia_data->start[matrix->dia_data->diagonals]*sizeof(MATRIX_DATA)
+                    + matrix->dia_data->diagonals*sizeof(int) + (matrix->dia_data->diagonals + 1.0)*sizeof(SMOPS_INDEX);
+        case DCSR:
+            return (double)matrix->non_zero_size*entry + matrix->dcsr_data->nzr*sizeof(int)
+                    + (matrix->dcsr_data->nzr + 1.0)*sizeof(SMOPS_INDEX);
+        case CSB:
+            return (double)matrix->non_zero_size*(sizeof(MATRIX_DATA) + 2*sizeof(uint16_t))
+                    + ((double)matrix->csb_data->block_rows*matrix->csb_data->block_cols + 1)*sizeof(SMOPS_INDEX);
+        case BITMAP:
+            return (double)matrix->non_zero_size*sizeof(MATRIX_DATA)
+                    + (double)matrix->bitmap_data->tiles*(sizeof(uint64_t) + 2*sizeof(int))
+                    + (matrix->bitmap_data->tile_rows + 1.0)*sizeof(int);
+        case CSRDU:
+            return (double)matrix->non_zero_size*sizeof(MATRIX_DATA) + matrix->csrdu_data->ja_ptr[matrix->rows]
+                    + 2*(matrix->rows + 1.0)*sizeof(SMOPS_INDEX);
+        default:
+            return (double)matrix->non_zero_size*entry + (matrix->rows + 1.0)*sizeof(SMOPS_INDEX)
+                    - spmv_csr_saving(matrix);
+    }
+}
+
+/** Performs the matrix vector multiplication result = matrix*vector
+*   The result is stored as a dense rows x 1 matrix.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix in CSR, DCSR, CSRDU, ELL, SELL, BCSR, DIA, CSB, BITMAP or DENSE
+*                       format
+*       MATRIX *vector: the vector, a matrix with one column in DENSE format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int MATRIX_OP_spmv(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX *vector)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, vector, OP, DENSE) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, vector, OP, DENSE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, vector);
+
+    if(vector->cols != 1 || matrix->cols != vector->rows) {
+        SMOPS_CTX_fill_err_msg(ctx, "input vector does not have the correct dimensions for spmv");
+        return 0;
+    }
+    if(matrix->type != vector->type || matrix->type == UNDEFINED) {
+        SMOPS_CTX_fill_err_msg(ctx, "type not properly set for matrices used in spmv");
+        return 0;
+    }
+
+    int rows = matrix->rows;
+    int y_size = rows;
+    MATRIX_DATA *x = vector->dense_data->values;
+    SPMV_KERNEL kernel = spmv_select_kernel(matrix);
+
+    //BCSR and BITMAP read and write whole blocks so x and y are padded to whole blocks
+    int block = matrix->format == BCSR ? matrix->bcsr_data->block : matrix->format == BITMAP ? BITMAP_TILE : 0;
+    if(block > 0) {
+        y_size = (rows + block - 1)/block*block;
+        if(matrix->cols % block != 0) {
+            x = (MATRIX_DATA *)calloc((size_t)(matrix->cols + block - 1)/block*block, sizeof(MATRIX_DATA));
+            if(x == NULL) {
+                SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for padded spmv vector");
+                return 0;
+            }
+            memcpy(x, vector->dense_data->values, sizeof(MATRIX_DATA)*matrix->cols);
+        }
+    }
+    //DCSR only writes the rows it stores
+    MATRIX_DATA *y = matrix->format == DCSR
+                        ? (MATRIX_DATA *)calloc(y_size > 0 ? y_size : 1, sizeof(MATRIX_DATA))
+                        : (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(y_size > 0 ? y_size : 1));
+    if(y == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for spmv result");
+        if(x != vector->dense_data->values) free(x);
+        return 0;
+    }
+
+    int done = spmv(ctx, y, matrix, x, kernel);
+    if(x != vector->dense_data->values) free(x);
+    if(done == 0) {
+        free(y);
+        return 0;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    ctx->flop_count = 2.0*matrix->non_zero_size;
+    ctx->byte_count = spmv_matrix_bytes(matrix)
+                        + (double)(vector->rows + rows)*sizeof(MATRIX_DATA);
+    SMOPS_RESULT_save_matrix_result(ctx, y, matrix->type, rows, 1);
+    return 1;
+}
@@ -2,10 +2,21 @@
 
 #include "../smops.h"
 
+/** Checks the format of the matrix is supported by the operation
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to check
+*       OPERATION op: the operation the matrix is used in
+*       MATRIX_FORMAT override: another format allowed for this matrix
+*
+*   return:
+*       1 if the format is supported, 0 otherwise filling the error message
+*/
 int OPS_check_format(SMOPS_CTX *ctx, MATRIX *matrix, OPERATION op, MATRIX_FORMAT override)
 {
-    MATRIX_FORMAT OPERATION_FORMATS[] = OP_MAP_FORMAT;
-    if(matrix->format != OPERATION_FORMATS[op] && matrix->format != override) {
+    int OPERATION_FORMATS[] = OP_MAP_FORMATS;
+    if((OPERATION_FORMATS[op] & FORMAT_BIT(matrix->format)) == 0 && matrix->format != override) {
         SMOPS_CTX_fill_err_msg(ctx, "incorrect format set for matrix operation");
         return 0;
     }
@@ -15,3 +26,67 @@ int OPS_check_format(SMOPS_CTX *ctx, MATRIX *matrix, OPERATION op, MATRIX_FORMAT
     }
     return 1;
 }
+
+/** Gives a view the format the operation plans for it when its own format is
+*   not supported, such as a view of a matrix loaded for mv used in a trace. The
+*   view is converted from its own copy of the elements, see MATRIX_plan, so
+*   calls running other operations on the same matrix are not affected.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the threads and error handling
+*       MATRIX *matrix: the matrix, left as it is if it is not a view
+*       OPERATION op: the operation the matrix is used in
+*       MATRIX_FORMAT requested: the format the operation needs for this matrix, NONE if any
+*
+*   return:
+*       1 if the matrix can be used in the operation, 0 otherwise filling the error message
+*/
+int OPS_plan_view(SMOPS_CTX *ctx, MATRIX *matrix, OPERATION op, MATRIX_FORMAT requested)
+{
+    int OPERATION_FORMATS[] = OP_MAP_FORMATS;
+    if(matrix->store == NULL || (OPERATION_FORMATS[op] & FORMAT_BIT(matrix->format)) != 0
+        || (requested != NONE && matrix->format == requested)) {return 1;}
+    return MATRIX_plan(ctx, matrix, op, requested);
+}
+
+/** Starts the phase of an operation with an estimate of its element updates,
+*   see SMOPS_CTX_plan_phase
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the threads
+*       OPERATION op: the operation
+*       MATRIX *matrix_a: the (left) matrix of the operation
+*       MATRIX *matrix_b: the right matrix, block or vector, NULL if there is none
+*/
+void OPS_plan_phase(SMOPS_CTX *ctx, OPERATION op, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    double nnz_a = matrix_a->non_zero_size;
+    double nnz_b = matrix_b != NULL ? matrix_b->non_zero_size : 0;
+    double work;
+    switch(op) {
+        case ADD:
+            //the dense result is cleared and written as well
+            work = (double)matrix_a->rows*matrix_a->cols + nnz_a + nnz_b;
+            break;
+        case MATRIX_MULT:
+            //every element of a meets the average row of b, on top of the dense result
+            work = (double)matrix_a->rows*matrix_b->cols
+                + nnz_a*nnz_b/(matrix_b->rows > 0 ? matrix_b->rows : 1);
+            break;
+        case MATRIX_BLOCK_MULT:
+            work = nnz_a*matrix_b->cols;
+            break;
+        case TRACE_PRODUCT:
+        case INNER_PRODUCT:
+            work = nnz_a + nnz_b;
+            break;
+        case MATRIX_VECTOR_MULT:
+        case TRANSPOSE_VECTOR_MULT:
+            work = nnz_a + matrix_a->rows + matrix_a->cols;
+            break;
+        default:
+            work = nnz_a;
+            break;
+    }
+    SMOPS_CTX_plan_phase(ctx, PHASE_OP, op, work);
+}
@@ -0,0 +1,473 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../smops.h"
+
+
+/** Finds the dot product of two sparse vectors of data type float that have their
+*   indices sorted in ascending order, by merging the two index lists together
+*
+*   parameters:
+*       CSR_DATA *a: the CSR_DATA holding the first vector
+*       SMOPS_INDEX p_a: start of the first vector in a
+*       SMOPS_INDEX q_a: end of the first vector in a
+*       CSR_DATA *b: the CSR_DATA or CSC_DATA holding the second vector
+*       SMOPS_INDEX p_b: start of the second vector in b
+*       SMOPS_INDEX q_b: end of the second vector in b
+*
+*   return:
+*       the dot product of the two vectors
+*/
+double float_sparse_dot(CSR_DATA *a, SMOPS_INDEX p_a, SMOPS_INDEX q_a,
+                        CSR_DATA *b, SMOPS_INDEX p_b, SMOPS_INDEX q_b)
+{
+    double dot = 0;
+    int col_a, col_b;
+    while(p_a < q_a && p_b < q_b) {
+        col_a = CSR_COL(a, p_a);
+        col_b = CSR_COL(b, p_b);
+        if(col_a == col_b) {
+            dot += a->nnz[p_a].f*b->nnz[p_b].f;
+            p_a++;
+            p_b++;
+        } else if(col_a < col_b) {
+            p_a++;
+        } else {
+            p_b++;
+        }
+    }
+    return dot;
+}
+
+/** Finds the dot product of two sparse vectors of data type int that have their
+*   indices sorted in ascending order, by merging the two index lists together
+*
+*   parameters: see float_sparse_dot
+*
+*   return:
+*       the dot product of the two vectors
+*/
+int int_sparse_dot(CSR_DATA *a, SMOPS_INDEX p_a, SMOPS_INDEX q_a,
+                    CSR_DATA *b, SMOPS_INDEX p_b, SMOPS_INDEX q_b)
+{
+    int dot = 0;
+    int col_a, col_b;
+    while(p_a < q_a && p_b < q_b) {
+        col_a = CSR_COL(a, p_a);
+        col_b = CSR_COL(b, p_b);
+        if(col_a == col_b) {
+            dot += a->nnz[p_a].i*b->nnz[p_b].i;
+            p_a++;
+            p_b++;
+        } else if(col_a < col_b) {
+            p_a++;
+        } else {
+            p_b++;
+        }
+    }
+    return dot;
+}
+
+/** Binary searches for the position of a column index within a row of CSR_DATA
+*
+*   parameters:
+*       CSR_DATA *csr: the CSR_DATA
+*       SMOPS_INDEX p: start of the row
+*       SMOPS_INDEX q: end of the row
+*       int col: the column index to find
+*
+*   return:
+*       the position of col in the CSR_DATA, -1 if the row has no element in col
+*/
+SMOPS_INDEX csr_find_col(CSR_DATA *csr, SMOPS_INDEX p, SMOPS_INDEX q, int col)
+{
+    SMOPS_INDEX mid;
+    int c;
+    while(p < q) {
+        mid = p + (q - p)/2;
+        c = CSR_COL(csr, mid);
+        if(c == col) {
+            return mid;
+        } else if(c < col) {
+            p = mid + 1;
+        } else {
+            q = mid;
+        }
+    }
+    return -1;
+}
+
+/** Arguments of the reduction tasks
+*   a: the CSR_DATA of the first matrix
+*   b: the CSR_DATA or CSC_DATA of the second matrix
+*   values: the values summed by the element sum tasks
+*   splits: the merge path splits of the matrix whose rows are walked
+*   rows: the number of rows of the matrix whose rows are walked
+*   sums: the partial sums of POOL_parallel_sum, one for every worker or block
+*/
+struct reduction_args {
+    CSR_DATA *a;
+    CSR_DATA *b;
+    MATRIX_DATA *values;
+    CSR_SPLIT *splits;
+    int rows;
+    POOL_SUM *sums;
+};
+
+/** Adds the dot products of the merge path parts p to q of a with the matching
+*   rows (CSR) or columns (CSC) of b to the partial sum of the worker. A row of a
+*   split between parts is merged with the whole row of b in every part.
+*
+*   parameters:
+*       void *arg: the struct reduction_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: the worker whose partial sum is added to
+*/
+void float_paired_dot_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    CSR_DATA *a = args->a;
+    CSR_DATA *b = args->b;
+    CSR_SPLIT start, end;
+    SMOPS_INDEX first, last;
+    double sum = 0;
+    for(SMOPS_INDEX k = p; k < q; k++) {
+        start = args->splits[k];
+        end = args->splits[k+1];
+        for(int r = start.row; r <= end.row && r < args->rows; r++) {
+            first = CSR_ROW(a, r) > start.nz ? CSR_ROW(a, r) : start.nz;
+            last = CSR_ROW(a, r+1) < end.nz ? CSR_ROW(a, r+1) : end.nz;
+            sum += float_sparse_dot(a, first, last, b, CSR_ROW(b, r), CSR_ROW(b, r+1));
+        }
+    }
+    args->sums[worker].f += sum;
+}
+
+/** Adds the dot products of the merge path parts p to q of a with the matching
+*   rows (CSR) or columns (CSC) of b to the partial sum of the worker
+*
+*   parameters: see float_paired_dot_task
+*/
+void int_paired_dot_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    CSR_DATA *a = args->a;
+    CSR_DATA *b = args->b;
+    CSR_SPLIT start, end;
+    SMOPS_INDEX first, last;
+    int sum = 0;
+    for(SMOPS_INDEX k = p; k < q; k++) {
+        start = args->splits[k];
+        end = args->splits[k+1];
+        for(int r = start.row; r <= end.row && r < args->rows; r++) {
+            first = CSR_ROW(a, r) > start.nz ? CSR_ROW(a, r) : start.nz;
+            last = CSR_ROW(a, r+1) < end.nz ? CSR_ROW(a, r+1) : end.nz;
+            sum += int_sparse_dot(a, first, last, b, CSR_ROW(b, r), CSR_ROW(b, r+1));
+        }
+    }
+    args->sums[worker].i += sum;
+}
+
+/** Sums the dot products of each row of a with the matching row (CSR) or column (CSC) of b.
+*   With b in CSR format this is the Frobenius inner product <a, b>,
+*   with b in CSC format this is the trace of a*b.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads and error handling
+*       MATRIX_DATA *result: where the sum of the dot products is stored
+*       TYPE type: the type of the matrices
+*       CSR_DATA *a: the CSR_DATA of the first matrix
+*       CSR_DATA *b: the CSR_DATA or CSC_DATA of the second matrix
+*       int n: the number of rows of a to sum over
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int paired_dot_sum(SMOPS_CTX *ctx, MATRIX_DATA *result, TYPE type, CSR_DATA *a, CSR_DATA *b, int n)
+{
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct reduction_args args = { a, b, NULL, NULL, n, sums };
+    int parts = POOL_merge_path(ctx, a, n, &args.splits);
+    if(parts == 0) {return 0;}
+    POOL_SUM total = POOL_parallel_sum(ctx, parts, 1, type == FLOAT ? float_paired_dot_task : int_paired_dot_task, &args, sums);
+    free(args.splits);
+    if(type == FLOAT) {
+        result[0].f = total.f;
+    } else {
+        result[0].i = total.i;
+    }
+    return 1;
+}
+
+/** Adds the products of the elements in the merge path parts p to q of b with
+*   the matching elements of a to the partial sum of the worker. Every element
+*   b[k][i] is matched with a[i][k] by binary searching row i of a.
+*
+*   parameters:
+*       void *arg: the struct reduction_args
+*       SMOPS_INDEX p: the first part of b
+*       SMOPS_INDEX q: the part after the last part of b
+*       int worker: the worker whose partial sum is added to
+*/
+void float_csr_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    CSR_DATA *a = args->a;
+    CSR_DATA *b = args->b;
+    CSR_SPLIT start, end;
+    SMOPS_INDEX first, last, pos;
+    double sum = 0;
+    int i;
+    for(SMOPS_INDEX n = p; n < q; n++) {
+        start = args->splits[n];
+        end = args->splits[n+1];
+        for(int k = start.row; k <= end.row && k < args->rows; k++) {
+            first = CSR_ROW(b, k) > start.nz ? CSR_ROW(b, k) : start.nz;
+            last = CSR_ROW(b, k+1) < end.nz ? CSR_ROW(b, k+1) : end.nz;
+            for(SMOPS_INDEX j = first; j < last; j++) {
+                i = CSR_COL(b, j);
+                pos = csr_find_col(a, CSR_ROW(a, i), CSR_ROW(a, i+1), k);
+                if(pos != -1) {
+                    sum += a->nnz[pos].f*b->nnz[j].f;
+                }
+            }
+        }
+    }
+    args->sums[worker].f += sum;
+}
+
+/** Adds the products of the elements in the merge path parts p to q of b with
+*   the matching elements of a to the partial sum of the worker
+*
+*   parameters: see float_csr_trace_task
+*/
+void int_csr_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    CSR_DATA *a = args->a;
+    CSR_DATA *b = args->b;
+    CSR_SPLIT start, end;
+    SMOPS_INDEX first, last, pos;
+    int sum = 0;
+    int i;
+    for(SMOPS_INDEX n = p; n < q; n++) {
+        start = args->splits[n];
+        end = args->splits[n+1];
+        for(int k = start.row; k <= end.row && k < args->rows; k++) {
+            first = CSR_ROW(b, k) > start.nz ? CSR_ROW(b, k) : start.nz;
+            last = CSR_ROW(b, k+1) < end.nz ? CSR_ROW(b, k+1) : end.nz;
+            for(SMOPS_INDEX j = first; j < last; j++) {
+                i = CSR_COL(b, j);
+                pos = csr_find_col(a, CSR_ROW(a, i), CSR_ROW(a, i+1), k);
+                if(pos != -1) {
+                    sum += a->nnz[pos].i*b->nnz[j].i;
+                }
+            }
+        }
+    }
+    args->sums[worker].i += sum;
+}
+
+/** Finds the trace of a*b when both a and b are in CSR format.
+*   Every element b[k][i] is matched with a[i][k] by binary searching row i of a.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the number of threads and error handling
+*       MATRIX_DATA *result: where the trace of a*b is stored
+*       TYPE type: the type of the matrices
+*       CSR_DATA *a: the CSR_DATA of matrix a
+*       CSR_DATA *b: the CSR_DATA of matrix b
+*       int rows_b: the number of rows in b
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int csr_trace_product(SMOPS_CTX *ctx, MATRIX_DATA *result, TYPE type, CSR_DATA *a, CSR_DATA *b, int rows_b)
+{
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct reduction_args args = { a, b, NULL, NULL, rows_b, sums };
+    int parts = POOL_merge_path(ctx, b, rows_b, &args.splits);
+    if(parts == 0) {return 0;}
+    POOL_SUM total = POOL_parallel_sum(ctx, parts, 1, type == FLOAT ? float_csr_trace_task : int_csr_trace_task, &args, sums);
+    free(args.splits);
+    if(type == FLOAT) {
+        result[0].f = total.f;
+    } else {
+        result[0].i = total.i;
+    }
+    return 1;
+}
+
+/** Checks that both matrices used in a reduction have the same, defined, type
+*
+*   return:
+*       1 if the types are valid, 0 otherwise filling the error message
+*/
+int reduction_check_type(SMOPS_CTX *ctx, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    if(matrix_a->type != matrix_b->type || matrix_a->type == UNDEFINED) {
+        SMOPS_CTX_fill_err_msg(ctx, "type not properly set for matrices used in reduction");
+        return 0;
+    }
+    return 1;
+}
+
+/** Finds the trace of matrix_a*matrix_b without forming the product.
+*   matrix_a must be in CSR format, matrix_b in either CSC or CSR format.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix_a: the left matrix of the product
+*       MATRIX *matrix_b: the right matrix of the product
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int MATRIX_OP_trace_product(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix_a, TRACE_PRODUCT, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_b, TRACE_PRODUCT, CSC) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix_a, TRACE_PRODUCT, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix_b, TRACE_PRODUCT, CSC) == 0) {return 0;}
+    OPS_plan_phase(ctx, TRACE_PRODUCT, matrix_a, matrix_b);
+
+    if(matrix_a->cols != matrix_b->rows || matrix_a->rows != matrix_b->cols) {
+        SMOPS_CTX_fill_err_msg(ctx, "input matrices for trace product do not form a square product");
+        return 0;
+    }
+    if(reduction_check_type(ctx, matrix_a, matrix_b) == 0) {return 0;}
+
+    if(matrix_b->format == CSC) {
+        if(paired_dot_sum(ctx, result, matrix_a->type, matrix_a->csr_data, matrix_b->csc_data, matrix_a->rows) == 0) {return 0;}
+    } else {
+        if(csr_trace_product(ctx, result, matrix_a->type, matrix_a->csr_data, matrix_b->csr_data, matrix_b->rows) == 0) {return 0;}
+    }
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    SMOPS_RESULT_save_trace_result(ctx, result[0], matrix_a->type);
+    return 1;
+}
+
+/** Finds the Frobenius inner product <matrix_a, matrix_b> (sum of a[i][j]*b[i][j])
+*   directly from the CSR format of both matrices
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix_a: the first matrix
+*       MATRIX *matrix_b: the second matrix
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int MATRIX_OP_inner_product(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix_a, INNER_PRODUCT, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, matrix_b, INNER_PRODUCT, NONE) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix_a, INNER_PRODUCT, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix_b, INNER_PRODUCT, NONE) == 0) {return 0;}
+    OPS_plan_phase(ctx, INNER_PRODUCT, matrix_a, matrix_b);
+
+    if(matrix_a->rows != matrix_b->rows || matrix_a->cols != matrix_b->cols) {
+        SMOPS_CTX_fill_err_msg(ctx, "input matrices for inner product do not have same dimensions");
+        return 0;
+    }
+    if(reduction_check_type(ctx, matrix_a, matrix_b) == 0) {return 0;}
+
+    if(paired_dot_sum(ctx, result, matrix_a->type, matrix_a->csr_data, matrix_b->csr_data, matrix_a->rows) == 0) {return 0;}
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    SMOPS_RESULT_save_trace_result(ctx, result[0], matrix_a->type);
+    return 1;
+}
+
+/** Adds the values p to q to the partial sum of the worker
+*
+*   parameters:
+*       void *arg: the struct reduction_args
+*       SMOPS_INDEX p: the first value
+*       SMOPS_INDEX q: the value after the last value
+*       int worker: the worker whose partial sum is added to
+*/
+void float_element_sum_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    double sum = 0;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        sum += args->values[i].f;
+    }
+    args->sums[worker].f += sum;
+}
+
+/** Adds the values p to q to the partial sum of the worker
+*
+*   parameters: see float_element_sum_task
+*/
+void int_element_sum_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct reduction_args *args = (struct reduction_args *)arg;
+    int sum = 0;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        sum += args->values[i].i;
+    }
+    args->sums[worker].i += sum;
+}
+
+/** Finds the sum of all elements in the matrix from its non zero values
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix: the matrix to sum
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int MATRIX_OP_sum(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix, ELEMENT_SUM, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix, ELEMENT_SUM, NONE) == 0) {return 0;}
+    OPS_plan_phase(ctx, ELEMENT_SUM, matrix, NULL);
+    if(matrix->coo_data == NULL || matrix->coo_data->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "COO DATA improperly set for sum");
+        return 0;
+    }
+
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct reduction_args args = { NULL, NULL, matrix->coo_data->values, NULL, 0, sums };
+    switch(matrix->type) {
+        case INT:
+            result[0].i = POOL_parallel_sum(ctx, matrix->non_zero_size, 0, int_element_sum_task, &args, sums).i;
+            break;
+        case FLOAT:
+            result[0].f = POOL_parallel_sum(ctx, matrix->non_zero_size, 0, float_element_sum_task, &args, sums).f;
+            break;
+        default:
+            SMOPS_CTX_fill_err_msg(ctx, "matrix data type is not properly set");
+            return 0;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    SMOPS_RESULT_save_trace_result(ctx, result[0], matrix->type);
+    return 1;
+}
@@ -1,24 +1,147 @@
 #include <stdlib.h>
-#include <omp.h>
 #include <time.h>
 
 #include "../smops.h"
 
 #define OP SCALAR_MULT
 
+/** Multiplies the chunks p to q of a SELL matrix by sm into the dense result.
+*   Every slot scales SELL_C lanes at once, the lanes of a chunk are distinct rows
+*   so chunks can be split between threads. Padding and lanes past the last row
+*   hold 0 and add nothing to the result.
+*
+*   parameters:
+*       MATRIX_DATA *dense: the zeroed dense result (rows x cols)
+*       SELL_DATA *sell: the SELL_DATA of the matrix
+*       int cols: the number of columns in the matrix
+*       double sm: the scalar
+*       int p: the first chunk
+*       int q: the chunk after the last chunk
+*/
+void sell_scalar_chunks(MATRIX_DATA *dense, SELL_DATA *sell, int cols, double sm, int p, int q)
+{
+    size_t offset[SELL_C];
+    double scaled[SELL_C];
+    MATRIX_DATA *nnz;
+    int *perm, *ja;
+    int l;
+    for(int k = p; k < q; k++) {
+        perm = sell->perm + k*SELL_C;
+        for(l = 0; l < SELL_C; l++) {
+            offset[l] = perm[l] < 0 ? 0 : (size_t)perm[l]*cols;
+        }
+        for(int s = 0; s < sell->cl[k]; s++) {
+            nnz = sell->nnz + sell->cs[k] + s*SELL_C;
+            ja = sell->ja + sell->cs[k] + s*SELL_C;
+            #pragma omp simd
+            for(l = 0; l < SELL_C; l++) {
+                scaled[l] = nnz[l].f*sm;
+            }
+            for(l = 0; l < SELL_C; l++) {
+                dense[offset[l] + ja[l]].f += scaled[l];
+            }
+        }
+    }
+}
+
+/** Arguments of sell_scalar_task */
+struct sell_scalar_args {
+    MATRIX_DATA *dense;
+    SELL_DATA *sell;
+    int cols;
+    double sm;
+};
+
+/** Scales the chunks p to q of the SELL matrix into the dense result
+*
+*   parameters:
+*       void *arg: the struct sell_scalar_args
+*       SMOPS_INDEX p: the first chunk
+*       SMOPS_INDEX q: the chunk after the last chunk
+*       int worker: unused
+*/
+void sell_scalar_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct sell_scalar_args *args = (struct sell_scalar_args *)arg;
+    sell_scalar_chunks(args->dense, args->sell, args->cols, args->sm, (int)p, (int)q);
+}
+
+/** Performs the scalar multiplication on a matrix in SELL format, the result
+*   is written straight into a dense matrix
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix in SELL format
+*       double sm: the scalar
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int sell_scalar_multiplication(SMOPS_CTX *ctx, MATRIX *matrix, double sm)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    int chunks = sell->chunks;
+    int cols = matrix->cols;
+    MATRIX_DATA *dense = (MATRIX_DATA *)calloc(matrix->size > 0 ? matrix->size : 1, sizeof(MATRIX_DATA));
+    if(dense == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for scalar multiplication result");
+        return 0;
+    }
+
+    struct sell_scalar_args args = { dense, sell, cols, sm };
+    POOL_parallel_for(ctx, chunks, SELL_SIGMA/SELL_C, sell_scalar_task, &args);
+    return SMOPS_RESULT_save_matrix_result(ctx, dense, matrix->type, matrix->rows, cols);
+}
+
+/** Arguments of coo_scalar_task */
+struct coo_scalar_args {
+    COO_DATA *result;
+    COO_DATA *matrix;
+    double sm;
+};
+
+/** Copies the elements p to q of the COO matrix into the result scaled by sm
+*
+*   parameters:
+*       void *arg: the struct coo_scalar_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: unused
+*/
+void coo_scalar_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct coo_scalar_args *args = (struct coo_scalar_args *)arg;
+    COO_DATA *r = args->result;
+    COO_DATA *m = args->matrix;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        r->coords_i[i] = m->coords_i[i];
+        r->coords_j[i] = m->coords_j[i];
+        r->values[i].f = m->values[i].f*args->sm;
+    }
+}
+
 int MATRIX_OP_scalar_multiplication(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix, double sm)
 {
     struct timespec start, end;
     clock_gettime(CLOCK_REALTIME, &start);
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
     if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, NULL);
     if(matrix->type != FLOAT) {
         SMOPS_CTX_fill_err_msg(ctx, "input matrix does not have type float for scalar multiplication");
         return 0;
     }
+    if(matrix->format == SELL) {
+        if(sell_scalar_multiplication(ctx, matrix, sm) == 0) {return 0;}
+        clock_gettime(CLOCK_REALTIME, &end);
+        ctx->time_op = (end.tv_sec - start.tv_sec) +
+                            (end.tv_nsec - start.tv_nsec)/ BILLION;
+        return 1;
+    }
     if(MATRIX_set_properties(ctx, result, matrix->format, matrix->type,
         matrix->rows, matrix->cols, matrix->non_zero_size) == 0) {return 0;}
 
-    int non_zero_size = result->non_zero_size;
+    SMOPS_INDEX non_zero_size = result->non_zero_size;
     result->coo_data->coords_i = (int *)calloc(non_zero_size, sizeof(int));
     if(result->coo_data->coords_i == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for COO_DATA");
@@ -35,35 +158,8 @@ int MATRIX_OP_scalar_multiplication(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matr
         return 0;
     }
 
-    MATRIX_DATA *r_values = result->coo_data->values;
-    int *r_coords_i = result->coo_data->coords_i;
-    int *r_coords_j = result->coo_data->coords_j;
-
-    MATRIX_DATA *m_values = matrix->coo_data->values;
-    int *m_coords_i = matrix->coo_data->coords_i;
-    int *m_coords_j = matrix->coo_data->coords_j;
-
-    switch(ctx->thread_num) {
-        case 1:
-            for(int i = 0; i < non_zero_size; i++) {
-                r_coords_i[i] = m_coords_i[i];
-                r_coords_j[i] = m_coords_j[i];
-                r_values[i].f = m_values[i].f*sm;
-            }
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num)
-            {
-                int i;
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    r_coords_i[i] = m_coords_i[i];
-                    r_coords_j[i] = m_coords_j[i];
-                    r_values[i].f = m_values[i].f*sm;
-                }
-            }
-            break;
-    }
+    struct coo_scalar_args args = { result->coo_data, matrix->coo_data, sm };
+    POOL_parallel_for(ctx, non_zero_size, 0, coo_scalar_task, &args);
 
     clock_gettime(CLOCK_REALTIME, &end);
     ctx->time_op = (end.tv_sec - start.tv_sec) +
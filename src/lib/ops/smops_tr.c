@@ -1,11 +1,62 @@
 #include <stdlib.h>
-#include <omp.h>
+#include <string.h>
 #include <time.h>
+#include <immintrin.h>
 
 #include "../smops.h"
 
 #define OP TRACE
 
+/** Arguments of the trace tasks
+*   matrix: the matrix to calculate the trace from
+*   first: the first element of a DIA matrix on the diagonal
+*   decode: the decoder of the column stream of a CSRDU matrix
+*   sums: the partial sums of POOL_parallel_sum, one for every worker or block
+*/
+struct trace_args {
+    MATRIX *matrix;
+    SMOPS_INDEX first;
+    CSRDU_DECODER decode;
+    POOL_SUM *sums;
+};
+
+/** Adds the elements p to q of a COO matrix on the diagonal to the partial sum
+*   of the worker
+*
+*   parameters:
+*       void *arg: the struct trace_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: the worker whose partial sum is added to
+*/
+void coo_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct trace_args *args = (struct trace_args *)arg;
+    COO_DATA *coo = args->matrix->coo_data;
+    double float_trace = 0;
+    int int_trace = 0;
+    switch(args->matrix->type) {
+        case FLOAT:
+            for(SMOPS_INDEX i = p; i < q; i++) {
+                if(coo->coords_i[i] == coo->coords_j[i]) {
+                    float_trace += coo->values[i].f;
+                }
+            }
+            break;
+        case INT:
+            for(SMOPS_INDEX i = p; i < q; i++) {
+                if(coo->coords_i[i] == coo->coords_j[i]) {
+                    int_trace += coo->values[i].i;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    args->sums[worker].f += float_trace;
+    args->sums[worker].i += int_trace;
+}
+
 /** Finds the trace of the matrix of data type float
 *
 *   parameters:
@@ -18,8 +69,7 @@
 */
 int float_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
 {
-    double trace = 0;
-    int non_zero_size = matrix->non_zero_size;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
     if(matrix->coo_data ==  NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "COO DATA not set for matrix and cannot find trace");
         return 0;
@@ -39,28 +89,9 @@ int float_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
         SMOPS_CTX_fill_err_msg(ctx, "COO DATA improperly set for trace");
         return 0;
     }
-    switch(ctx->thread_num) {
-        case 1:
-            for(int i = 0; i < non_zero_size; i++) {
-                if(coords_i[i] == coords_j[i]) {
-                    trace += values[i].f;
-                }
-            }
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num) reduction(+ : trace)
-            {
-                int i;
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    if(coords_i[i] == coords_j[i]) {
-                        trace += values[i].f;
-                    }
-                }
-            }
-            break;
-    }
-    result[0].f = trace;
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct trace_args args = { matrix, 0, NULL, sums };
+    result[0].f = POOL_parallel_sum(ctx, non_zero_size, 0, coo_trace_task, &args, sums).f;
     return 1;
 }
 
@@ -76,8 +107,7 @@ int float_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
 */
 int int_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
 {
-    int trace = 0;
-    int non_zero_size = matrix->non_zero_size;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
     if(matrix->coo_data ==  NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "COO DATA not set for matrix and cannot find trace");
         return 0;
@@ -97,32 +127,226 @@ int int_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
         SMOPS_CTX_fill_err_msg(ctx, "COO DATA improperly set for trace");
         return 0;
     }
-    switch(ctx->thread_num) {
-        case 1:
-            for(int i = 0; i < non_zero_size; i++) {
-                if(coords_i[i] == coords_j[i]) {
-                    trace += values[i].i;
-                }
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct trace_args args = { matrix, 0, NULL, sums };
+    result[0].i = POOL_parallel_sum(ctx, non_zero_size, 0, coo_trace_task, &args, sums).i;
+    return 1;
+}
+
+/** Sums the diagonal of the chunks p to q of a float SELL matrix. Every slot
+*   of a chunk compares the columns of its SELL_C lanes with the rows of the lanes.
+*
+*   parameters:
+*       SELL_DATA *sell: the SELL_DATA of the matrix
+*       int p: the first chunk
+*       int q: the chunk after the last chunk
+*
+*   return:
+*       the sum of the diagonal elements in the chunks
+*/
+double float_sell_trace_chunks(SELL_DATA *sell, int p, int q)
+{
+    double trace = 0;
+    int *perm, *ja;
+    MATRIX_DATA *nnz;
+    int l;
+    for(int k = p; k < q; k++) {
+        perm = sell->perm + k*SELL_C;
+        for(int s = 0; s < sell->cl[k]; s++) {
+            ja = sell->ja + sell->cs[k] + s*SELL_C;
+            nnz = sell->nnz + sell->cs[k] + s*SELL_C;
+            #pragma omp simd reduction(+:trace)
+            for(l = 0; l < SELL_C; l++) {
+                trace += ja[l] == perm[l] ? nnz[l].f : 0;
             }
+        }
+    }
+    return trace;
+}
+
+/** Sums the diagonal of the chunks p to q of an int SELL matrix
+*
+*   parameters: see float_sell_trace_chunks
+*/
+int int_sell_trace_chunks(SELL_DATA *sell, int p, int q)
+{
+    int trace = 0;
+    int *perm, *ja;
+    MATRIX_DATA *nnz;
+    int l;
+    for(int k = p; k < q; k++) {
+        perm = sell->perm + k*SELL_C;
+        for(int s = 0; s < sell->cl[k]; s++) {
+            ja = sell->ja + sell->cs[k] + s*SELL_C;
+            nnz = sell->nnz + sell->cs[k] + s*SELL_C;
+            #pragma omp simd reduction(+:trace)
+            for(l = 0; l < SELL_C; l++) {
+                trace += ja[l] == perm[l] ? nnz[l].i : 0;
+            }
+        }
+    }
+    return trace;
+}
+
+/** AVX2 version of float_sell_trace_chunks, one compare masks the diagonal
+*   of all SELL_C lanes of a slot, the mask is widened to the 8 byte values.
+*
+*   parameters: see float_sell_trace_chunks
+*/
+__attribute__((target("avx2")))
+double float_sell_trace_chunks_avx2(SELL_DATA *sell, int p, int q)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256i rows, mask;
+    __m128d lo;
+    SMOPS_INDEX pos;
+    for(int k = p; k < q; k++) {
+        rows = _mm256_loadu_si256((__m256i *)(sell->perm + k*SELL_C));
+        for(int s = 0; s < sell->cl[k]; s++) {
+            pos = sell->cs[k] + s*SELL_C;
+            mask = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i *)(sell->ja + pos)), rows);
+            acc0 = _mm256_add_pd(acc0, _mm256_and_pd(
+                    _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(mask))),
+                    _mm256_loadu_pd((double *)(sell->nnz + pos))));
+            acc1 = _mm256_add_pd(acc1, _mm256_and_pd(
+                    _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(mask, 1))),
+                    _mm256_loadu_pd((double *)(sell->nnz + pos + 4))));
+        }
+    }
+    acc0 = _mm256_add_pd(acc0, acc1);
+    lo = _mm_add_pd(_mm256_castpd256_pd128(acc0), _mm256_extractf128_pd(acc0, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+/** AVX2 version of int_sell_trace_chunks, the int values are gathered out of
+*   the 8 byte MATRIX_DATA with a scale of 8.
+*
+*   parameters: see float_sell_trace_chunks
+*/
+__attribute__((target("avx2")))
+int int_sell_trace_chunks_avx2(SELL_DATA *sell, int p, int q)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i acc = _mm256_setzero_si256();
+    __m256i rows, mask, values;
+    __m128i lo;
+    SMOPS_INDEX pos;
+    for(int k = p; k < q; k++) {
+        rows = _mm256_loadu_si256((__m256i *)(sell->perm + k*SELL_C));
+        for(int s = 0; s < sell->cl[k]; s++) {
+            pos = sell->cs[k] + s*SELL_C;
+            mask = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i *)(sell->ja + pos)), rows);
+            values = _mm256_i32gather_epi32((int *)(sell->nnz + pos), lanes, 8);
+            acc = _mm256_add_epi32(acc, _mm256_and_si256(mask, values));
+        }
+    }
+    lo = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0x4E));
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, 0xB1));
+    return _mm_cvtsi128_si32(lo);
+}
+
+/** Adds the diagonal of the chunks p to q of a SELL matrix to the partial sum
+*   of the worker
+*
+*   parameters:
+*       void *arg: the struct trace_args
+*       SMOPS_INDEX p: the first chunk
+*       SMOPS_INDEX q: the chunk after the last chunk
+*       int worker: the worker whose partial sum is added to
+*/
+void sell_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct trace_args *args = (struct trace_args *)arg;
+    SELL_DATA *sell = args->matrix->sell_data;
+    int simd = args->matrix->kernel == KERNEL_SIMD;
+    switch(args->matrix->type) {
+        case FLOAT:
+            args->sums[worker].f += simd ? float_sell_trace_chunks_avx2(sell, (int)p, (int)q)
+                                        : float_sell_trace_chunks(sell, (int)p, (int)q);
+            break;
+        case INT:
+            args->sums[worker].i += simd ? int_sell_trace_chunks_avx2(sell, (int)p, (int)q)
+                                        : int_sell_trace_chunks(sell, (int)p, (int)q);
             break;
         default:
-            #pragma omp parallel num_threads(ctx->thread_num) reduction(+ : trace)
-            {
-                int i;
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    if(coords_i[i] == coords_j[i]) {
-                        trace += values[i].i;
-                    }
-                }
-            }
             break;
     }
-    result[0].i = trace;
+}
+
+/** Finds the trace of a matrix in SELL format, splitting the chunks between threads
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix: the matrix to calculate the trace from
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int sell_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
+{
+    SELL_DATA *sell = matrix->sell_data;
+    if(sell == NULL || sell->perm == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "SELL DATA not set for matrix and cannot find trace");
+        return 0;
+    }
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct trace_args args = { matrix, 0, NULL, sums };
+
+    switch(matrix->type) {
+        case FLOAT:
+            result[0].f = POOL_parallel_sum(ctx, sell->chunks, SELL_SIGMA/SELL_C, sell_trace_task, &args, sums).f;
+            break;
+        case INT:
+            result[0].i = POOL_parallel_sum(ctx, sell->chunks, SELL_SIGMA/SELL_C, sell_trace_task, &args, sums).i;
+            break;
+        default:
+            SMOPS_CTX_fill_err_msg(ctx, "matrix data type is not properly set");
+            return 0;
+    }
     return 1;
 }
 
-/** Finds the trace of the matrix
+/** Adds the elements p to q of the main diagonal of a DIA matrix to the
+*   partial sum of the worker, the elements are counted from the first one
+*
+*   parameters:
+*       void *arg: the struct trace_args
+*       SMOPS_INDEX p: the first element of the diagonal
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: the worker whose partial sum is added to
+*/
+void dia_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct trace_args *args = (struct trace_args *)arg;
+    MATRIX_DATA *values = args->matrix->dia_data->values + args->first;
+    double float_trace = 0;
+    int int_trace = 0;
+    SMOPS_INDEX i;
+    switch(args->matrix->type) {
+        case FLOAT:
+            #pragma omp simd reduction(+ : float_trace)
+            for(i = p; i < q; i++) {
+                float_trace += values[i].f;
+            }
+            break;
+        case INT:
+            #pragma omp simd reduction(+ : int_trace)
+            for(i = p; i < q; i++) {
+                int_trace += values[i].i;
+            }
+            break;
+        default:
+            break;
+    }
+    args->sums[worker].f += float_trace;
+    args->sums[worker].i += int_trace;
+}
+
+/** Finds the trace of a matrix in DIA format, the trace is the sum of the
+*   diagonal with offset 0 which is found by a binary search of the offsets
 *
 *   parameters:
 *       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
@@ -132,26 +356,184 @@ int int_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
 *   return:
 *       1 if executed successfully, 0 otherwise filling the error message
 */
-int MATRIX_OP_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
+int dia_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
 {
-    struct timespec start, end;
-    clock_gettime(CLOCK_REALTIME, &start);
-    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
-    if(matrix->rows != matrix->cols) {
-        SMOPS_CTX_fill_err_msg(ctx, "cannot find a trace of a non-square matrix");
+    DIA_DATA *dia = matrix->dia_data;
+    if(dia == NULL || dia->start == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "DIA DATA not set for matrix and cannot find trace");
         return 0;
     }
+    int lo = 0;
+    int hi = dia->diagonals;
+    int mid;
+    while(lo < hi) {
+        mid = (lo + hi)/2;
+        if(dia->offsets[mid] < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    SMOPS_INDEX p = 0;
+    SMOPS_INDEX q = 0;
+    if(lo < dia->diagonals && dia->offsets[lo] == 0) {
+        p = dia->start[lo];
+        q = dia->start[lo + 1];
+    }
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct trace_args args = { matrix, p, NULL, sums };
+
     switch(matrix->type) {
+        case FLOAT:
+            result[0].f = POOL_parallel_sum(ctx, q - p, 0, dia_trace_task, &args, sums).f;
+            break;
         case INT:
-            if(int_trace(ctx, result, matrix) == 0) {return 0;}
+            result[0].i = POOL_parallel_sum(ctx, q - p, 0, dia_trace_task, &args, sums).i;
             break;
+        default:
+            SMOPS_CTX_fill_err_msg(ctx, "matrix data type is not properly set");
+            return 0;
+    }
+    return 1;
+}
+
+/** Finds the element on the diagonal of a row of a CSR-DU matrix, decoding the
+*   columns of the row until one reaches the diagonal
+*
+*   parameters:
+*       CSRDU_DATA *du: the CSRDU_DATA of the matrix
+*       CSRDU_DECODER decode: the decoder of the column stream
+*       int r: the row
+*
+*   return:
+*       the position of the element in nnz, -1 if the row has no diagonal element
+*/
+SMOPS_INDEX csrdu_diagonal(CSRDU_DATA *du, CSRDU_DECODER decode, int r)
+{
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja = du->ja + du->ja_ptr[r];
+    int k, j, col = 0;
+    for(SMOPS_INDEX i = du->ia[r]; i < du->ia[r+1]; i += k) {
+        k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+        ja = decode(buf, ja, col, k);
+        col = buf[k - 1];
+        for(j = 0; j < k; j++) {
+            if(buf[j] >= r) {
+                return buf[j] == r ? i + j : -1;
+            }
+        }
+    }
+    return -1;
+}
+
+/** Adds the diagonal elements of the rows p to q of a CSRDU matrix to the
+*   partial sum of the worker
+*
+*   parameters:
+*       void *arg: the struct trace_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: the worker whose partial sum is added to
+*/
+void csrdu_trace_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct trace_args *args = (struct trace_args *)arg;
+    CSRDU_DATA *du = args->matrix->csrdu_data;
+    double float_trace = 0;
+    int int_trace = 0;
+    SMOPS_INDEX n;
+    for(SMOPS_INDEX r = p; r < q; r++) {
+        n = csrdu_diagonal(du, args->decode, (int)r);
+        if(n < 0) {continue;}
+        switch(args->matrix->type) {
+            case FLOAT:
+                float_trace += du->nnz[n].f;
+                break;
+            case INT:
+                int_trace += du->nnz[n].i;
+                break;
+            default:
+                break;
+        }
+    }
+    args->sums[worker].f += float_trace;
+    args->sums[worker].i += int_trace;
+}
+
+/** Finds the trace of a matrix in CSRDU format, splitting the rows between threads
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix: the matrix to calculate the trace from
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int csrdu_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    if(du == NULL || du->ja_ptr == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "CSRDU DATA not set for matrix and cannot find trace");
+        return 0;
+    }
+    POOL_SUM sums[POOL_sum_slots(ctx)];
+    struct trace_args args = { matrix, 0, CSRDU_decoder(matrix->kernel), sums };
+
+    switch(matrix->type) {
         case FLOAT:
-            if(float_trace(ctx, result, matrix) == 0) {return 0;}
+            result[0].f = POOL_parallel_sum(ctx, matrix->rows, 0, csrdu_trace_task, &args, sums).f;
+            break;
+        case INT:
+            result[0].i = POOL_parallel_sum(ctx, matrix->rows, 0, csrdu_trace_task, &args, sums).i;
             break;
         default:
             SMOPS_CTX_fill_err_msg(ctx, "matrix data type is not properly set");
             return 0;
     }
+    return 1;
+}
+
+/** Finds the trace of the matrix
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX_DATA *result: where the result is stored
+*       MATRIX *matrix: the matrix to calculate the trace from
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int MATRIX_OP_trace(SMOPS_CTX *ctx, MATRIX_DATA *result, MATRIX *matrix)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, NULL);
+    if(matrix->rows != matrix->cols) {
+        SMOPS_CTX_fill_err_msg(ctx, "cannot find a trace of a non-square matrix");
+        return 0;
+    }
+    if(matrix->format == SELL) {
+        if(sell_trace(ctx, result, matrix) == 0) {return 0;}
+    } else if(matrix->format == DIA) {
+        if(dia_trace(ctx, result, matrix) == 0) {return 0;}
+    } else if(matrix->format == CSRDU) {
+        if(csrdu_trace(ctx, result, matrix) == 0) {return 0;}
+    } else {
+        switch(matrix->type) {
+            case INT:
+                if(int_trace(ctx, result, matrix) == 0) {return 0;}
+                break;
+            case FLOAT:
+                if(float_trace(ctx, result, matrix) == 0) {return 0;}
+                break;
+            default:
+                SMOPS_CTX_fill_err_msg(ctx, "matrix data type is not properly set");
+                return 0;
+        }
+    }
     clock_gettime(CLOCK_REALTIME, &end);
     ctx->time_op = (end.tv_sec - start.tv_sec) +
                         (end.tv_nsec - start.tv_nsec)/ BILLION;
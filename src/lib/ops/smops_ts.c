@@ -1,20 +1,51 @@
 #include <stdlib.h>
-#include <omp.h>
+#include <string.h>
 #include <time.h>
 
 #include "../smops.h"
 
 #define OP TRANSPOSE
 
-int MATRIX_OP_transpose(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix)
+/** Arguments of coo_transpose_task */
+struct coo_transpose_args {
+    COO_DATA *result;
+    COO_DATA *matrix;
+};
+
+/** Copies the elements p to q of the COO matrix into the result with the
+*   coordinates swapped
+*
+*   parameters:
+*       void *arg: the struct coo_transpose_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: unused
+*/
+void coo_transpose_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
 {
-    struct timespec start, end;
-    clock_gettime(CLOCK_REALTIME, &start);
-    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
-    if(MATRIX_set_properties(ctx, result, matrix->format, matrix->type,
-        matrix->cols, matrix->rows, matrix->non_zero_size) == 0) {return 0;}
+    struct coo_transpose_args *args = (struct coo_transpose_args *)arg;
+    COO_DATA *r = args->result;
+    COO_DATA *m = args->matrix;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        r->coords_i[i] = m->coords_j[i];
+        r->coords_j[i] = m->coords_i[i];
+        r->values[i] = m->values[i];
+    }
+}
 
-    int non_zero_size = result->non_zero_size;
+/** Transposes a matrix in COO format by swapping the coordinates of every element
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling and the number of threads
+*       MATRIX *result: the transposed matrix in COO format, its properties are set
+*       MATRIX *matrix: the matrix to transpose
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int coo_transpose(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix)
+{
+    SMOPS_INDEX non_zero_size = result->non_zero_size;
     result->coo_data->coords_i = (int *)calloc(non_zero_size, sizeof(int));
     if(result->coo_data->coords_i == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for COO_DATA");
@@ -31,38 +62,110 @@ int MATRIX_OP_transpose(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix)
         return 0;
     }
 
-    MATRIX_DATA *r_values = result->coo_data->values;
-    int *r_coords_i = result->coo_data->coords_i;
-    int *r_coords_j = result->coo_data->coords_j;
+    struct coo_transpose_args args = { result->coo_data, matrix->coo_data };
+    POOL_parallel_for(ctx, non_zero_size, 0, coo_transpose_task, &args);
+    return 1;
+}
+
+/** Arguments of dia_transpose_task */
+struct dia_transpose_args {
+    DIA_DATA *result;
+    DIA_DATA *matrix;
+};
+
+/** Copies the diagonals p to q of the transposed DIA matrix, diagonal d of the
+*   result is diagonal diagonals - 1 - d of the matrix
+*
+*   parameters:
+*       void *arg: the struct dia_transpose_args
+*       SMOPS_INDEX p: the first diagonal of the result
+*       SMOPS_INDEX q: the diagonal after the last diagonal
+*       int worker: unused
+*/
+void dia_transpose_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dia_transpose_args *args = (struct dia_transpose_args *)arg;
+    DIA_DATA *r = args->result;
+    DIA_DATA *m = args->matrix;
+    for(SMOPS_INDEX d = p; d < q; d++) {
+        memcpy(r->values + r->start[d], m->values + m->start[m->diagonals - 1 - d],
+                sizeof(MATRIX_DATA)*(r->start[d+1] - r->start[d]));
+    }
+}
+
+/** Transposes a matrix in DIA format. Element (r, r + k) moves to (r + k, r) so
+*   diagonal k becomes diagonal -k with its elements in the same order, only the
+*   offsets are negated and the diagonals are copied whole in reverse order.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling and the number of threads
+*       MATRIX *result: the transposed matrix in DIA format, its properties are set
+*       MATRIX *matrix: the matrix to transpose
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int dia_transpose(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix)
+{
+    DIA_DATA *m_dia = matrix->dia_data;
+    DIA_DATA *r_dia = result->dia_data;
+    int diagonals = m_dia->diagonals;
+    size_t stored = m_dia->start[diagonals];
+
+    r_dia->diagonals = diagonals;
+    r_dia->offsets = (int *)malloc(sizeof(int)*(diagonals > 0 ? diagonals : 1));
+    r_dia->start = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(diagonals + 1));
+    r_dia->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(stored > 0 ? stored : 1));
+    if(r_dia->offsets == NULL || r_dia->start == NULL || r_dia->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for DIA_DATA");
+        return 0;
+    }
+
+    int d;
+    r_dia->start[0] = 0;
+    for(d = 0; d < diagonals; d++) {
+        r_dia->offsets[d] = -m_dia->offsets[diagonals - 1 - d];
+        r_dia->start[d+1] = r_dia->start[d] + m_dia->start[diagonals - d] - m_dia->start[diagonals - 1 - d];
+    }
+    struct dia_transpose_args args = { r_dia, m_dia };
+    POOL_parallel_for(ctx, diagonals, 1, dia_transpose_task, &args);
+    result->stats.dia_diagonals = diagonals;
+    result->stats.dia_fill = matrix->stats.dia_fill;
+    return 1;
+}
 
-    MATRIX_DATA *m_values = matrix->coo_data->values;
-    int *m_coords_i = matrix->coo_data->coords_i;
-    int *m_coords_j = matrix->coo_data->coords_j;
+/** Transposes the matrix, the result is kept in the format of the matrix
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *result: where the transposed matrix is stored
+*       MATRIX *matrix: the matrix to transpose
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling the error message
+*/
+int MATRIX_OP_transpose(SMOPS_CTX *ctx, MATRIX *result, MATRIX *matrix)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, NULL);
+    if(MATRIX_set_properties(ctx, result, matrix->format, matrix->type,
+        matrix->cols, matrix->rows, matrix->non_zero_size) == 0) {return 0;}
 
-    switch(ctx->thread_num) {
-        case 1:
-            for(int i = 0; i < non_zero_size; i++) {
-                r_coords_i[i] = m_coords_j[i];
-                r_coords_j[i] = m_coords_i[i];
-                r_values[i] = m_values[i];
-            }
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num)
-            {
-                int i;
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    r_coords_i[i] = m_coords_j[i];
-                    r_coords_j[i] = m_coords_i[i];
-                    r_values[i] = m_values[i];
-                }
-            }
-            break;
+    if(matrix->format == DIA) {
+        if(dia_transpose(ctx, result, matrix) == 0) {return 0;}
+    } else {
+        if(coo_transpose(ctx, result, matrix) == 0) {return 0;}
     }
     clock_gettime(CLOCK_REALTIME, &end);
     ctx->time_op = (end.tv_sec - start.tv_sec) +
                         (end.tv_nsec - start.tv_nsec)/ BILLION;
-    SMOPS_RESULT_save_coo_matrix_result(ctx, result);
+    if(matrix->format == DIA) {
+        SMOPS_RESULT_save_dia_matrix_result(ctx, result);
+    } else {
+        SMOPS_RESULT_save_coo_matrix_result(ctx, result);
+    }
     return 1;
 }
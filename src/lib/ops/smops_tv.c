@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "../smops.h"
+
+#define OP TRANSPOSE_VECTOR_MULT
+
+/** Multiplies the block columns p to q of the transpose of a float CSB matrix
+*   with the dense vector x. A block column only writes its beta entries of y,
+*   so threads given different block columns never write to the same entry.
+*
+*   parameters:
+*       MATRIX_DATA *y: the dense result vector (cols of the matrix)
+*       MATRIX *matrix: the matrix in CSB format
+*       MATRIX_DATA *x: the dense vector (rows of the matrix)
+*       int p: the first block column to multiply
+*       int q: the block column after the last block column to multiply
+*/
+void float_csb_spmv_t_cols(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSB_DATA *csb = matrix->csb_data;
+    int beta = csb->beta;
+    MATRIX_DATA *yb, *xb;
+    SMOPS_INDEX *blk_ptr;
+    SMOPS_INDEX i;
+    int c, end;
+    for(int b_col = p; b_col < q; b_col++) {
+        yb = y + (size_t)b_col*beta;
+        end = matrix->cols - b_col*beta < beta ? matrix->cols - b_col*beta : beta;
+        for(c = 0; c < end; c++) {
+            yb[c].f = 0;
+        }
+        for(int b_row = 0; b_row < csb->block_rows; b_row++) {
+            blk_ptr = csb->blk_ptr + (size_t)b_row*csb->block_cols + b_col;
+            xb = x + (size_t)b_row*beta;
+            for(i = blk_ptr[0]; i < blk_ptr[1]; i++) {
+                yb[csb->lo_j[i]].f += csb->values[i].f*xb[csb->lo_i[i]].f;
+            }
+        }
+    }
+}
+
+/** Multiplies the block columns p to q of the transpose of an int CSB matrix
+*   with the dense vector x
+*
+*   parameters: see float_csb_spmv_t_cols
+*/
+void int_csb_spmv_t_cols(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    CSB_DATA *csb = matrix->csb_data;
+    int beta = csb->beta;
+    MATRIX_DATA *yb, *xb;
+    SMOPS_INDEX *blk_ptr;
+    SMOPS_INDEX i;
+    int c, end;
+    for(int b_col = p; b_col < q; b_col++) {
+        yb = y + (size_t)b_col*beta;
+        end = matrix->cols - b_col*beta < beta ? matrix->cols - b_col*beta : beta;
+        for(c = 0; c < end; c++) {
+            yb[c].i = 0;
+        }
+        for(int b_row = 0; b_row < csb->block_rows; b_row++) {
+            blk_ptr = csb->blk_ptr + (size_t)b_row*csb->block_cols + b_col;
+            xb = x + (size_t)b_row*beta;
+            for(i = blk_ptr[0]; i < blk_ptr[1]; i++) {
+                yb[csb->lo_j[i]].i += csb->values[i].i*xb[csb->lo_i[i]].i;
+            }
+        }
+    }
+}
+
+/** Multiplies the block columns p to q of the transpose of the matrix with x
+*   arbitrary to type
+*
+*   parameters: see float_csb_spmv_t_cols
+*/
+void csb_spmv_t_cols(MATRIX_DATA *y, MATRIX *matrix, MATRIX_DATA *x, int p, int q)
+{
+    switch(matrix->type) {
+        case FLOAT:
+            float_csb_spmv_t_cols(y, matrix, x, p, q);
+            break;
+        case INT:
+            int_csb_spmv_t_cols(y, matrix, x, p, q);
+            break;
+        default:
+            break;
+    }
+}
+
+/** Arguments of csb_spmv_t_task */
+struct csb_spmv_t_args {
+    MATRIX_DATA *y;
+    MATRIX *matrix;
+    MATRIX_DATA *x;
+};
+
+/** Computes the block columns p to q of the transposed product
+*
+*   parameters:
+*       void *arg: the struct csb_spmv_t_args
+*       SMOPS_INDEX p: the first block column
+*       SMOPS_INDEX q: the block column after the last block column
+*       int worker: unused
+*/
+void csb_spmv_t_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct csb_spmv_t_args *args = (struct csb_spmv_t_args *)arg;
+    csb_spmv_t_cols(args->y, args->matrix, args->x, (int)p, (int)q);
+}
+
+/** Performs the transposed matrix vector multiplication result = transpose(matrix)*vector
+*   on the same CSB copy of the matrix used by mv. The block columns are split
+*   between threads, which needs no atomics and does the same work as mv.
+*   The result is stored as a dense cols x 1 matrix.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix in CSB format
+*       MATRIX *vector: the vector, a matrix with one column in DENSE format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int MATRIX_OP_transpose_spmv(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX *vector)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    if(OPS_plan_view(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_plan_view(ctx, vector, OP, DENSE) == 0) {return 0;}
+
+    if(OPS_check_format(ctx, matrix, OP, NONE) == 0) {return 0;}
+    if(OPS_check_format(ctx, vector, OP, DENSE) == 0) {return 0;}
+    OPS_plan_phase(ctx, OP, matrix, vector);
+
+    if(vector->cols != 1 || matrix->rows != vector->rows) {
+        SMOPS_CTX_fill_err_msg(ctx, "input vector does not have the correct dimensions for tv");
+        return 0;
+    }
+    if(matrix->type != vector->type || matrix->type == UNDEFINED) {
+        SMOPS_CTX_fill_err_msg(ctx, "type not properly set for matrices used in tv");
+        return 0;
+    }
+
+    int cols = matrix->cols;
+    int block_cols = matrix->csb_data->block_cols;
+    MATRIX_DATA *x = vector->dense_data->values;
+    MATRIX_DATA *y = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(cols > 0 ? cols : 1));
+    if(y == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for tv result");
+        return 0;
+    }
+
+    struct csb_spmv_t_args args = { y, matrix, x };
+    POOL_parallel_for(ctx, block_cols, 1, csb_spmv_t_task, &args);
+
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_op = (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    ctx->flop_count = 2.0*matrix->non_zero_size;
+    ctx->byte_count = (double)matrix->non_zero_size*(sizeof(MATRIX_DATA) + 2*sizeof(uint16_t))
+                        + ((double)matrix->csb_data->block_rows*block_cols + 1)*sizeof(SMOPS_INDEX)
+                        + (double)(vector->rows + cols)*sizeof(MATRIX_DATA);
+    SMOPS_RESULT_save_matrix_result(ctx, y, matrix->type, cols, 1);
+    return 1;
+}
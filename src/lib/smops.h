@@ -1,11 +1,44 @@
+#include <stddef.h>
+#include <stdint.h>
+
 #define LIBNAME "SMOPS"
 #define DEFAULT_THREAD_NUM 4
 #define DEFAULT_LOG 0
+#define DEFAULT_DENSE_THRESHOLD 0.05
 #define ERR_MSG_BUFFER 100
-#define OP_MAP_FORMAT { NONE, COO, COO, CSR, COO, CSR }
+#define PLAN_REPORT_BUFFER 1024
+#define FORMAT_BIT(f) (1 << (f))
+#define OP_MAP_FORMATS { 0, FORMAT_BIT(COO) | FORMAT_BIT(SELL),\
+    FORMAT_BIT(COO) | FORMAT_BIT(SELL) | FORMAT_BIT(DIA) | FORMAT_BIT(CSRDU),\
+    FORMAT_BIT(CSR) | FORMAT_BIT(DENSE) | FORMAT_BIT(BCSR) | FORMAT_BIT(DIA) | FORMAT_BIT(DCSR) | FORMAT_BIT(BITMAP)\
+    | FORMAT_BIT(CSRDU),\
+    FORMAT_BIT(COO) | FORMAT_BIT(DIA),\
+    FORMAT_BIT(CSR) | FORMAT_BIT(DENSE) | FORMAT_BIT(BCSR) | FORMAT_BIT(BITMAP), FORMAT_BIT(CSR), FORMAT_BIT(CSR),\
+    FORMAT_BIT(COO),\
+    FORMAT_BIT(CSR) | FORMAT_BIT(ELL) | FORMAT_BIT(SELL) | FORMAT_BIT(DENSE) | FORMAT_BIT(BCSR) | FORMAT_BIT(DIA)\
+    | FORMAT_BIT(DCSR) | FORMAT_BIT(CSB) | FORMAT_BIT(BITMAP) | FORMAT_BIT(CSRDU), FORMAT_BIT(CSR), FORMAT_BIT(CSB) }
+#define FORMAT_MAP_STRING { "none\0", "coo\0", "csr\0", "csc\0", "dense\0", "ell\0", "sell\0", "bcsr\0", "dia\0",\
+    "dcsr\0", "csb\0", "bitmap\0",\
+    "csrdu\0" }
+#define KERNEL_MAP_STRING { "scalar\0", "simd\0" }
 #define BILLION 1000000000.0
-#define OP_MAP_STRING { "noop\0", "sm\0", "tr\0", "ad\0", "ts\0", "mm\0" }
+#define SELL_C 8
+#define SELL_SIGMA 256
+#define BCSR_MIN_BLOCK 2
+#define BCSR_MAX_BLOCK 4
+#define CSB_MIN_BETA 16
+#define CSB_MAX_BETA 65536
+#define BITMAP_TILE 8
+#define CSRDU_BATCH 64
+#define VALUES_DICT_MAX 256
+#define VALUE_CODING_MAP_STRING { "full\0", "int8\0", "int16\0", "dict\0" }
+#define OP_MAP_STRING { "noop\0", "sm\0", "tr\0", "ad\0", "ts\0", "mm\0", "tp\0", "ip\0", "su\0", "mv\0", "mb\0", "tv\0" }
 #define TYPE_MAP_STRING { "int\0", "float\0", "undefined\0" }
+#define SCHEDULE_MAP_STRING { "steal\0", "static\0", "dynamic\0", "guided\0" }
+#define PHASE_MAP_STRING { "load\0", "convert\0", "op\0" }
+#define AFFINITY_MAP_STRING { "none\0", "compact\0", "scatter\0" }
+#define OP_COUNT 12
+#define PHASE_COUNT 3
 
 /** Operations Supported By SMOPS
 *
@@ -16,22 +49,80 @@ enum ops {
     TRACE=2,
     ADD=3,
     TRANSPOSE=4,
-    MATRIX_MULT=5
+    MATRIX_MULT=5,
+    TRACE_PRODUCT=6,
+    INNER_PRODUCT=7,
+    ELEMENT_SUM=8,
+    MATRIX_VECTOR_MULT=9,
+    MATRIX_BLOCK_MULT=10,
+    TRANSPOSE_VECTOR_MULT=11
 };
 typedef enum ops OPERATION;
 
+/** How POOL_parallel_for hands ranges of iterations to the workers
+*   SCHEDULE_STEAL: every worker starts with an equal share and idle workers steal halves
+*   SCHEDULE_STATIC: chunks of grain iterations are dealt round robin, a share per worker by default
+*   SCHEDULE_DYNAMIC: workers take the next chunk of grain iterations from a shared counter
+*   SCHEDULE_GUIDED: like dynamic with chunks shrinking from remaining/workers down to grain
+*/
+enum schedule { SCHEDULE_STEAL=0, SCHEDULE_STATIC=1, SCHEDULE_DYNAMIC=2, SCHEDULE_GUIDED=3 };
+typedef enum schedule SCHEDULE;
+
+/** The phases of a run, which pick their threads and count their tasks apart */
+enum phase_kind { PHASE_LOAD=0, PHASE_CONVERT=1, PHASE_OP=2 };
+typedef enum phase_kind PHASE_KIND;
+
+/** How the threads of the pool are pinned to CPUs
+*   AFFINITY_NONE: not pinned, the scheduler moves them
+*   AFFINITY_COMPACT: consecutive threads on neighbouring cores, filling one NUMA node first
+*   AFFINITY_SCATTER: consecutive threads on different NUMA nodes
+*/
+enum affinity { AFFINITY_NONE=0, AFFINITY_COMPACT=1, AFFINITY_SCATTER=2 };
+typedef enum affinity AFFINITY;
+
 enum mtype { INT=0, FLOAT=1, UNDEFINED=2 };
 typedef enum mtype TYPE;
 
-enum mf { NONE=0, COO=1, CSR=2, CSC=3};
+enum mf { NONE=0, COO=1, CSR=2, CSC=3, DENSE=4, ELL=5, SELL=6, BCSR=7, DIA=8, DCSR=9, CSB=10, BITMAP=11,
+    CSRDU=12 };
 typedef enum mf MATRIX_FORMAT;
 
+enum kernel { KERNEL_SCALAR=0, KERNEL_SIMD=1 };
+typedef enum kernel KERNEL;
+
+/** Type of the number of non zero elements and of the offsets into the arrays of
+*   non zero elements (ia and the like), 64 bit so a matrix with more than
+*   INT32_MAX non zero elements loads. The CSR and CSC offsets of a matrix whose
+*   non zero elements fit in 32 bits are stored in 32 bits, see CSR_ROW. Row and
+*   column indices are int.
+*/
+typedef int64_t SMOPS_INDEX;
+
 union md {
     int i;
     double f;
 };
 typedef union md MATRIX_DATA;
 
+enum value_coding { VALUES_FULL=0, VALUES_INT8=1, VALUES_INT16=2, VALUES_DICT=3 };
+typedef enum value_coding VALUE_CODING;
+
+/** Values of a matrix stored narrower than MATRIX_DATA, decoded by the kernels
+*   as they are read. Int values in the range of int8_t or int16_t are stored
+*   as such, matrices with at most VALUES_DICT_MAX distinct values store a
+*   uint8_t index into a dictionary of them.
+*   coding: how the values are stored, VALUES_FULL if they are not packed
+*   data: an int8_t, int16_t or uint8_t for every value
+*   dict: the distinct values for VALUES_DICT (dict_size entries)
+*/
+struct packed_values {
+    VALUE_CODING coding;
+    void *data;
+    MATRIX_DATA *dict;
+    int dict_size;
+};
+typedef struct packed_values PACKED_VALUES;
+
 struct coo {
     int *coords_i;
     int *coords_j;
@@ -41,18 +132,210 @@ typedef struct coo COO_DATA;
 
 struct csr {
     MATRIX_DATA *nnz;
-    int *ia;
+    SMOPS_INDEX *ia;
+    int32_t *ia32; //the offsets when the non zero elements fit in 32 bits, ia is NULL then
     int *ja;
+    uint16_t *ja16; //the columns when they fit in 16 bits, ja is NULL then
+    PACKED_VALUES packed; //when packed.coding is not VALUES_FULL nnz is NULL
 };
 typedef struct csr CSR_DATA;
 
+/** The column of element i of a CSR_DATA (its row in a CSC_DATA) in either width */
+#define CSR_COL(csr, i) ((csr)->ja16 != NULL ? (int)(csr)->ja16[i] : (csr)->ja[i])
+/** The offset of row r of a CSR_DATA (column r of a CSC_DATA) in either width */
+#define CSR_ROW(csr, r) ((csr)->ia32 != NULL ? (SMOPS_INDEX)(csr)->ia32[r] : (csr)->ia[r])
+
 struct csc {
     MATRIX_DATA *nnz;
-    int *ia;
+    SMOPS_INDEX *ia;
     int *ja;
 };
 typedef struct csr CSC_DATA;
 
+struct dense {
+    MATRIX_DATA *values;
+};
+typedef struct dense DENSE_DATA;
+
+/** ELLPACK format, every row is padded to width elements.
+*   Stored slot major (element s of row r is at s*rows + r) so consecutive rows
+*   are contiguous, padding has a value of 0 and column 0.
+*/
+struct ell {
+    MATRIX_DATA *nnz;
+    int *ja;
+    int width;
+};
+typedef struct ell ELL_DATA;
+
+/** SELL-C-sigma (sliced ELLPACK) format. The rows are sorted by length within
+*   windows of SELL_SIGMA rows and cut into chunks of SELL_C rows, every chunk is
+*   padded to its longest row. Element s of lane l in chunk k is at cs[k] + s*SELL_C + l
+*   so one slot of a chunk is SELL_C contiguous elements. Padding has a value of 0
+*   and column 0.
+*   cs: start of every chunk in nnz and ja (chunks + 1 entries)
+*   cl: the width of every chunk
+*   perm: the original row of every lane (chunks*SELL_C entries), -1 for lanes past the last row
+*/
+struct sell {
+    MATRIX_DATA *nnz;
+    int *ja;
+    SMOPS_INDEX *cs;
+    int *cl;
+    int *perm;
+    int chunks;
+};
+typedef struct sell SELL_DATA;
+
+/** Block CSR format, the matrix is cut into block x block tiles and every tile
+*   with a non zero element is stored whole (row major) with one column index.
+*   Tiles past the last row or column are padded with 0.
+*   ia: start of every block row in ja (block_rows + 1 entries)
+*   ja: the block column of every stored block
+*   nnz: the values of every stored block, block*block each
+*/
+struct bcsr {
+    MATRIX_DATA *nnz;
+    int *ia;
+    int *ja;
+    int block;
+    int block_rows;
+    int block_cols;
+    int blocks;
+};
+typedef struct bcsr BCSR_DATA;
+
+/** Diagonal format, every diagonal with a non zero element is stored whole.
+*   Diagonal d has the offset k = column - row and holds the elements of the rows
+*   max(0, -k) to min(rows, cols - k) in row order, starting at values[start[d]].
+*   offsets: the offset of every stored diagonal in ascending order
+*   start: start of every diagonal in values (diagonals + 1 entries)
+*/
+struct dia {
+    MATRIX_DATA *values;
+    int *offsets;
+    SMOPS_INDEX *start;
+    int diagonals;
+};
+typedef struct dia DIA_DATA;
+
+/** Doubly compressed CSR format for hypersparse matrices, only the rows with a
+*   non zero element are stored so nothing scales with the number of rows.
+*   row_ids: the row of every stored row in ascending order (nzr entries)
+*   ia: start of every stored row in nnz and ja (nzr + 1 entries)
+*   nzr: the number of rows with a non zero element
+*/
+struct dcsr {
+    MATRIX_DATA *nnz;
+    SMOPS_INDEX *ia;
+    int *ja;
+    int *row_ids;
+    int nzr;
+};
+typedef struct dcsr DCSR_DATA;
+
+/** Compressed Sparse Blocks format, the matrix is cut into beta x beta blocks
+*   (beta a power of 2) and the elements of every block are stored together with
+*   16 bit coordinates local to the block. The blocks are stored block row major,
+*   so a block row or a block column can be walked without touching the others.
+*   blk_ptr: start of every block in values (block_rows*block_cols + 1 entries)
+*   lo_i, lo_j: the row and column of every element within its block
+*/
+struct csb {
+    MATRIX_DATA *values;
+    uint16_t *lo_i;
+    uint16_t *lo_j;
+    SMOPS_INDEX *blk_ptr;
+    int beta;
+    int block_rows;
+    int block_cols;
+};
+typedef struct csb CSB_DATA;
+
+/** Bitmap tile format for semi-dense regions, the matrix is cut into BITMAP_TILE x
+*   BITMAP_TILE tiles and every tile with a non zero element is stored as a 64 bit
+*   occupancy mask and its non zero elements packed in row major order. Bit
+*   i*BITMAP_TILE + j of a mask is the element (i, j) of the tile, so byte i of a
+*   mask is row i of the tile. The tiles of a tile row are stored in column order.
+*   ia: start of every tile row in ja and masks (tile_rows + 1 entries)
+*   ja: the tile column of every stored tile
+*   val_ptr: start of every stored tile in values (tiles + 1 entries)
+*/
+struct bitmap {
+    MATRIX_DATA *values;
+    uint64_t *masks;
+    int *ia;
+    int *ja;
+    SMOPS_INDEX *val_ptr;
+    int tile_rows;
+    int tile_cols;
+    int tiles;
+};
+typedef struct bitmap BITMAP_DATA;
+
+/** CSR with delta and varint compressed column indices (CSR-DU). The columns of a
+*   row are stored as the differences to the previous column of the row (the first
+*   to column 0), every difference as a varint of 7 bits per byte with the high bit
+*   set on all bytes but the last. Columns closer than 128 take one byte.
+*   ia: start of every row in nnz (rows + 1 entries)
+*   ja_ptr: start of every row in ja (rows + 1 entries)
+*   ja: the varint stream of the column differences, ja_ptr[rows] bytes
+*/
+struct csrdu {
+    MATRIX_DATA *nnz;
+    uint8_t *ja;
+    SMOPS_INDEX *ia;
+    SMOPS_INDEX *ja_ptr;
+};
+typedef struct csrdu CSRDU_DATA;
+
+typedef const uint8_t *(*CSRDU_DECODER)(int *, const uint8_t *, int, int);
+
+/** Structure of a matrix measured by a scan of its COO_DATA while loading
+*   density: non zero elements/size
+*   row_nnz_mean: mean number of non zero elements per row
+*   row_nnz_var: variance of the number of non zero elements per row
+*   row_nnz_max: the most non zero elements in a row
+*   empty_rows: number of rows without a non zero element
+*   bandwidth: the greatest distance |i - j| of a non zero element from the diagonal
+*   sell_padding: stored elements/non zero elements of the SELL format
+*   bcsr_block: the block size for the BCSR format, 0 if no block size has low fill
+*   bcsr_fill: stored elements/non zero elements of the BCSR format with bcsr_block
+*   dia_diagonals: the number of diagonals with a non zero element
+*   dia_fill: stored elements/non zero elements of the DIA format
+*   csb_beta: the block size for the CSB format, 0 if not chosen yet
+*   bitmap_tiles: the number of BITMAP_TILE x BITMAP_TILE tiles with a non zero element
+*   csrdu_ratio: bytes of the CSR column indices/bytes of the CSR-DU column stream,
+*                0 until the matrix is encoded
+*   csrdu_decode_rate: millions of columns decoded per second from the CSR-DU stream
+*   value_coding: how the CSR values are packed, only set for mv
+*   value_distinct: the number of distinct values, VALUES_DICT_MAX + 1 if there are more
+*   ja16: 1 if the CSR columns (CSC rows) are stored in 16 bits, set for ad, mm, tp, ip and mv
+*   ia32: 1 if the CSR (CSC) offsets are stored in 32 bits
+*/
+struct matrix_stats {
+    double density;
+    double row_nnz_mean;
+    double row_nnz_var;
+    int row_nnz_max;
+    int empty_rows;
+    int bandwidth;
+    double sell_padding;
+    int bcsr_block;
+    double bcsr_fill;
+    int dia_diagonals;
+    double dia_fill;
+    int csb_beta;
+    int bitmap_tiles;
+    double csrdu_ratio;
+    double csrdu_decode_rate;
+    VALUE_CODING value_coding;
+    int value_distinct;
+    int ja16;
+    int ia32;
+};
+typedef struct matrix_stats MATRIX_STATS;
+
 union result_data {
     MATRIX_DATA *matrix;
     MATRIX_DATA trace;
@@ -71,27 +354,117 @@ struct result {
 };
 typedef struct result RESULT;
 
+/** A task run by the thread pool on the iterations p to q of a parallel for,
+*   worker is the index of the thread running it (0 to thread_num - 1), or the
+*   slot of the partial sum of POOL_parallel_sum the task adds to
+*/
+typedef void (*POOL_TASK)(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker);
+
+/** The thread pool of a SMOPS_CTX, defined in lib/smops_pool.c */
+typedef struct pool POOL;
+
+/** A call queued on the thread pool, run once by a pool thread, see POOL_submit
+*   run: the work of the call
+*   arg: the argument given to run
+*   next: the call queued after it
+*/
+struct pool_call {
+    void (*run)(void *arg);
+    void *arg;
+    struct pool_call *next;
+};
+typedef struct pool_call POOL_CALL;
+
+/** A partial sum of one worker of the thread pool, on its own cache line so
+*   workers adding to their partial sums do not share lines
+*/
+struct pool_sum {
+    double f;
+    int i;
+} __attribute__((aligned(64)));
+typedef struct pool_sum POOL_SUM;
+
+/** A point on the merge path of a CSR matrix, where the path walks the row ends
+*   and the non zero elements together in the order they are reached
+*   row: the number of rows ended before the point, the row the point lies in
+*   nz: the number of non zero elements before the point
+*/
+struct csr_split {
+    int row;
+    SMOPS_INDEX nz;
+};
+typedef struct csr_split CSR_SPLIT;
+
+/** The phase the thread pool is running, see SMOPS_CTX_plan_phase
+*   kind: loading, converting or the operation
+*   threads: the workers taking part in its parallel loops
+*   grain: the grain of its parallel loops, 0 keeps the grain each loop asks for
+*/
+struct phase {
+    PHASE_KIND kind;
+    int threads;
+    SMOPS_INDEX grain;
+};
+typedef struct phase PHASE;
+
 /** Struct for data used by the library
 *   err_msg: error message if an error occurs while using library
 *   err: 1 if an error has occurred, 0 otherwise
 *   thread_num: number of threads to be used
-*               if set to 1 will execute sequentially without OpenMP
+*               if set to 1 will execute sequentially on the calling thread
+*   thread_auto: 1 if every phase picks its threads from its work, 0 if all use thread_num
+*   schedule: how the parallel loops hand out their iterations
+*   affinity: how the threads of the pool are pinned to CPUs
+*   reproducible: 1 if float reductions and merge path splits have a fixed shape, so
+*                 float results do not change with the number of threads
+*   grain: the grain of the parallel loops of every operation, NO_OP for loading and
+*          converting, 0 keeps the grain each loop asks for
+*   phase: the phase currently running
+*   phase_tasks: the tasks run by the parallel loops of every kind of phase
 *   log: 1 if results will be logged to file, anything else prints results
 *   operation: what sparse will be performed (required for loading matrices)
+*   flop_count: floating point operations done by the last operation, 0 if not counted
+*   byte_count: bytes of memory moved by the last operation, 0 if not counted
+*   dense_threshold: density (non zero elements/size) at or above which ad and mm
+*                    load matrices into the DENSE format and use the dense engine
+*   plan_report: the formats and kernels chosen by the planner for the loaded matrices
+*   pool: the thread pool running the parallel loops, has thread_num workers
+*   shared: the SMOPS_CTX whose pool a call borrows, NULL if the pool is its own
 */
 struct smops_ctx {
     char *log_prefix;
     char *err_msg;
     int err;
     int thread_num;
+    int thread_auto;
+    SCHEDULE schedule;
+    AFFINITY affinity;
+    int reproducible;
+    SMOPS_INDEX grain[OP_COUNT];
+    PHASE phase;
+    long phase_tasks[PHASE_COUNT];
     int log;
     double time_load;
     double time_op;
+    double flop_count;
+    double byte_count;
+    double dense_threshold;
+    char *plan_report;
     OPERATION operation;
     RESULT *result;
+    POOL *pool;
+    struct smops_ctx *shared;
 };
 typedef struct smops_ctx SMOPS_CTX;
 
+/** The work of an asynchronous call, run with the SMOPS_CTX of the call.
+*   Returns 1 if successfully executed, 0 otherwise filling the err_msg.
+*/
+typedef int (*SMOPS_JOB)(SMOPS_CTX *ctx, void *arg);
+
+/** A call run as a job on the thread pool, defined in lib/smops_async.c */
+typedef struct smops_future SMOPS_FUTURE;
+
 //TO DO! Create a union for storing result, either pointer to dense format or single result
 //For results you can either print to screen or temporarily change stdout to file
 
@@ -101,55 +474,168 @@ struct m {
     COO_DATA *coo_data;
     CSR_DATA *csr_data;
     CSC_DATA *csc_data;
+    DENSE_DATA *dense_data;
+    ELL_DATA *ell_data;
+    SELL_DATA *sell_data;
+    BCSR_DATA *bcsr_data;
+    DIA_DATA *dia_data;
+    DCSR_DATA *dcsr_data;
+    CSB_DATA *csb_data;
+    BITMAP_DATA *bitmap_data;
+    CSRDU_DATA *csrdu_data;
+    KERNEL kernel;
+    MATRIX_STATS stats;
     int rows;
     int cols;
-    int size;
-    int non_zero_size;
+    int64_t size;
+    SMOPS_INDEX non_zero_size;
+    struct m *store; //the matrix whose data a view shares, NULL if the data is its own
 };
 typedef struct m MATRIX;
 
 // SMOPS_CTX control routines defined in lib/smops_ctx.c
 extern SMOPS_CTX *SMOPS_CTX_new();
+extern SMOPS_CTX *SMOPS_CTX_new_call(SMOPS_CTX *);
 extern void SMOPS_CTX_free(SMOPS_CTX *);
+extern RESULT *SMOPS_CTX_take_result(SMOPS_CTX *);
 extern void SMOPS_CTX_fill_err_msg(SMOPS_CTX *, char *);
 extern void SMOPS_CTX_print_err(SMOPS_CTX *);
 extern int SMOPS_CTX_set_thread_num(SMOPS_CTX *, int);
 extern int SMOPS_CTX_get_thread_num(SMOPS_CTX *);
+extern int SMOPS_CTX_set_thread_auto(SMOPS_CTX *);
+extern int SMOPS_CTX_set_schedule(SMOPS_CTX *, SCHEDULE);
+extern int SMOPS_CTX_set_affinity(SMOPS_CTX *, AFFINITY);
+extern void SMOPS_CTX_set_reproducible(SMOPS_CTX *, int);
+extern int SMOPS_CTX_set_grain(SMOPS_CTX *, OPERATION, SMOPS_INDEX);
+extern long SMOPS_CTX_get_tasks(SMOPS_CTX *, PHASE_KIND);
+extern PHASE SMOPS_CTX_plan_phase(SMOPS_CTX *, PHASE_KIND, OPERATION, double);
 extern int SMOPS_CTX_set_log(SMOPS_CTX *, int);
 extern int SMOPS_CTX_get_log(SMOPS_CTX *);
 extern void SMOPS_CTX_set_operation(SMOPS_CTX *, OPERATION);
 extern OPERATION SMOPS_CTX_get_operation(SMOPS_CTX *);
 extern int SMOPS_CTX_set_log_name_prefix(SMOPS_CTX *, char *);
+extern int SMOPS_CTX_set_dense_threshold(SMOPS_CTX *, double);
+extern double SMOPS_CTX_get_dense_threshold(SMOPS_CTX *);
+extern void SMOPS_CTX_add_plan_report(SMOPS_CTX *, char *);
+extern void SMOPS_CTX_merge_call(SMOPS_CTX *, SMOPS_CTX *);
+
+// Asynchronous call routines defined in lib/smops_async.c
+extern SMOPS_FUTURE *SMOPS_async(SMOPS_CTX *, SMOPS_JOB, void *, size_t, SMOPS_FUTURE **, int);
+extern int SMOPS_FUTURE_wait(SMOPS_FUTURE *);
+extern int SMOPS_FUTURE_poll(SMOPS_FUTURE *);
+extern void SMOPS_FUTURE_free(SMOPS_FUTURE *);
+extern SMOPS_FUTURE *MATRIX_load_async(SMOPS_CTX *, MATRIX *, char *);
+extern SMOPS_FUTURE *MATRIX_OP_async(SMOPS_CTX *, OPERATION, MATRIX *, MATRIX_DATA *, MATRIX *, MATRIX *,
+    double, SMOPS_FUTURE **, int);
+
+// Thread pool routines defined in lib/smops_pool.c
+extern POOL *POOL_new(int);
+extern void POOL_free(POOL *);
+extern void POOL_parallel_for(SMOPS_CTX *, SMOPS_INDEX, SMOPS_INDEX, POOL_TASK, void *);
+extern POOL_SUM POOL_reduce(POOL_SUM *, int);
+extern int POOL_sum_slots(SMOPS_CTX *);
+extern POOL_SUM POOL_parallel_sum(SMOPS_CTX *, SMOPS_INDEX, SMOPS_INDEX, POOL_TASK, void *, POOL_SUM *);
+extern int POOL_merge_path(SMOPS_CTX *, CSR_DATA *, int, CSR_SPLIT **);
+extern int POOL_cpu_count();
+extern int POOL_pin(POOL *, AFFINITY);
+extern void POOL_placement(POOL *, char *, int);
+extern void *POOL_calloc(SMOPS_CTX *, size_t, size_t);
+extern void POOL_submit(POOL *, POOL_CALL *);
+extern int POOL_claim(POOL *, POOL_CALL *);
 
 extern int SMOPS_RESULT_save_trace_result(SMOPS_CTX *, MATRIX_DATA, TYPE);
 extern int SMOPS_RESULT_save_coo_matrix_result(SMOPS_CTX *, MATRIX *);
+extern int SMOPS_RESULT_save_dia_matrix_result(SMOPS_CTX *, MATRIX *);
 extern int SMOPS_RESULT_save_matrix_result(SMOPS_CTX *, MATRIX_DATA *, TYPE, int, int);
 extern void SMOPS_RESULT_free(RESULT *);
 extern int SMOPS_RESULT_present(SMOPS_CTX *, char *, char *);
 
 extern MATRIX *MATRIX_new(SMOPS_CTX *);
+extern MATRIX *MATRIX_view(SMOPS_CTX *, MATRIX *);
+extern int MATRIX_aliases(MATRIX *, MATRIX *);
 extern int MATRIX_change_format(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT);
 extern int MATRIX_set_format(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT);
+extern int MATRIX_switch_format(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT);
+extern int MATRIX_convert(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT);
+extern int MATRIX_plan(SMOPS_CTX *, MATRIX *, OPERATION, MATRIX_FORMAT);
 extern void MATRIX_free(MATRIX *);
 extern void MATRIX_free_data(MATRIX *);
 extern int MATRIX_preload_type(SMOPS_CTX *, MATRIX *, char *, MATRIX *, char *);
 extern int MATRIX_load(SMOPS_CTX *, MATRIX *, char *);
-extern int MATRIX_set_properties(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT, TYPE, int, int, int);
+extern int MATRIX_load_pair(SMOPS_CTX *, MATRIX *, char *, MATRIX *, char *);
+extern int MATRIX_set_properties(SMOPS_CTX *, MATRIX *, MATRIX_FORMAT, TYPE, int, int, SMOPS_INDEX);
 
 extern COO_DATA *COO_new(SMOPS_CTX *);
 extern CSR_DATA *CSR_new(SMOPS_CTX *);
 extern CSC_DATA *CSC_new(SMOPS_CTX *);
+extern DENSE_DATA *DENSE_new(SMOPS_CTX *);
+extern ELL_DATA *ELL_new(SMOPS_CTX *);
+extern SELL_DATA *SELL_new(SMOPS_CTX *);
+extern BCSR_DATA *BCSR_new(SMOPS_CTX *);
+extern DIA_DATA *DIA_new(SMOPS_CTX *);
+extern DCSR_DATA *DCSR_new(SMOPS_CTX *);
+extern CSB_DATA *CSB_new(SMOPS_CTX *);
+extern BITMAP_DATA *BITMAP_new(SMOPS_CTX *);
+extern CSRDU_DATA *CSRDU_new(SMOPS_CTX *);
 extern void COO_free(COO_DATA *);
+extern COO_DATA *COO_copy(SMOPS_CTX *, COO_DATA *, SMOPS_INDEX);
 extern void CSR_free(CSR_DATA *);
 extern void CSC_free(CSR_DATA *);
-extern void COO_sort_row_order(COO_DATA *, int);
-extern void COO_sort_col_order(COO_DATA *, int);
-extern MATRIX_DATA *COO_to_dense(SMOPS_CTX *, COO_DATA *, int, int, int);
+extern void DENSE_free(DENSE_DATA *);
+extern void ELL_free(ELL_DATA *);
+extern void SELL_free(SELL_DATA *);
+extern void BCSR_free(BCSR_DATA *);
+extern void DIA_free(DIA_DATA *);
+extern void DCSR_free(DCSR_DATA *);
+extern void CSB_free(CSB_DATA *);
+extern void BITMAP_free(BITMAP_DATA *);
+extern void CSRDU_free(CSRDU_DATA *);
+extern int VALUES_dictionary(MATRIX_DATA *, SMOPS_INDEX, TYPE, MATRIX_DATA *, uint8_t *);
+extern int VALUES_pack(SMOPS_CTX *, CSR_DATA *, SMOPS_INDEX, TYPE, VALUE_CODING);
+extern int CSR_narrow_columns(SMOPS_CTX *, CSR_DATA *, SMOPS_INDEX);
+extern int CSR_narrow_offsets(SMOPS_CTX *, CSR_DATA *, int);
+extern SMOPS_INDEX *COO_bucket(SMOPS_CTX *, int *, SMOPS_INDEX, int, SMOPS_INDEX *);
+extern int COO_sorted(SMOPS_CTX *, int *, int *, SMOPS_INDEX, int);
+extern int COO_sort_row_order(SMOPS_CTX *, COO_DATA *, SMOPS_INDEX, int, int);
+extern int COO_sort_col_order(SMOPS_CTX *, COO_DATA *, SMOPS_INDEX, int, int);
+extern MATRIX_DATA *COO_to_dense(SMOPS_CTX *, COO_DATA *, int, int, SMOPS_INDEX);
+extern MATRIX_DATA *DIA_to_dense(SMOPS_CTX *, DIA_DATA *, int, int);
+
+extern int PLAN_scan(SMOPS_CTX *, MATRIX *);
+extern int PLAN_select(SMOPS_CTX *, MATRIX *);
+extern KERNEL PLAN_kernel(SMOPS_CTX *, MATRIX_FORMAT);
+extern void PLAN_report(SMOPS_CTX *, MATRIX *, char *);
+extern int PLAN_csb_beta(MATRIX *);
 
 extern int OPS_check_format(SMOPS_CTX *, MATRIX *, OPERATION op, MATRIX_FORMAT);
+extern int OPS_plan_view(SMOPS_CTX *, MATRIX *, OPERATION, MATRIX_FORMAT);
+extern void OPS_plan_phase(SMOPS_CTX *, OPERATION, MATRIX *, MATRIX *);
+extern void DENSE_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern void DENSE_multiplication(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int BCSR_reconcile(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern void BCSR_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int BCSR_multiplication(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int DIA_reconcile(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern void DIA_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int DCSR_reconcile(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern void DCSR_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int BITMAP_reconcile(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern void BITMAP_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern void BITMAP_multiplication(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern const uint8_t *CSRDU_decode(int *, const uint8_t *, int, int);
+extern const uint8_t *CSRDU_decode_avx2(int *, const uint8_t *, int, int);
+extern CSRDU_DECODER CSRDU_decoder(KERNEL);
+extern int CSRDU_reconcile(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern void CSRDU_addition(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
 
 extern int MATRIX_OP_trace(SMOPS_CTX *, MATRIX_DATA *, MATRIX *);
 extern int MATRIX_OP_transpose(SMOPS_CTX *, MATRIX *, MATRIX *);
 extern int MATRIX_OP_scalar_multiplication(SMOPS_CTX *, MATRIX *, MATRIX *, double);
 extern int MATRIX_OP_addition(SMOPS_CTX *, MATRIX *, MATRIX *);
 extern int MATRIX_OP_multiplication(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern int MATRIX_OP_trace_product(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int MATRIX_OP_inner_product(SMOPS_CTX *, MATRIX_DATA *, MATRIX *, MATRIX *);
+extern int MATRIX_OP_sum(SMOPS_CTX *, MATRIX_DATA *, MATRIX *);
+extern int MATRIX_OP_spmv(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern int MATRIX_OP_spmm(SMOPS_CTX *, MATRIX *, MATRIX *);
+extern int MATRIX_OP_transpose_spmv(SMOPS_CTX *, MATRIX *, MATRIX *);
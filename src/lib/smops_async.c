@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "smops.h"
+
+/** A link from a call to one that waits for it
+*   future: the call waiting
+*   next: the next call waiting for the same call
+*/
+struct future_edge {
+    SMOPS_FUTURE *future;
+    struct future_edge *next;
+};
+
+/** A call run as a job on the thread pool of its SMOPS_CTX, see SMOPS_async
+*   ctx: the SMOPS_CTX the call was made on, the call is merged into it when waited for
+*   call: the SMOPS_CTX the job runs with, made by SMOPS_CTX_new_call
+*   job: the work of the call
+*   arg: a copy of the argument given to job
+*   after: the calls that must finish before job starts
+*   after_count: the number of calls in after
+*   edges: the links of the call into the dependents of every call in after
+*   dependents: the calls waiting for this call, released when it finishes
+*   pending: the calls in after not finished yet, plus one until SMOPS_async has
+*            linked them all, the call is queued on the pool when it drops to 0
+*   failed: 1 if a call in after failed
+*   status: what job returned, 0 as well if a call in after failed
+*   released: 1 once status is set and the dependents are taken to be released
+*   done: 1 once the dependents are released
+*   merged: 1 once the call has been merged into ctx
+*   node: the entry of the call in the queue of the pool
+*   lock, finished: guard dependents, status, released and done and signal the end of the call
+*/
+struct smops_future {
+    SMOPS_CTX *ctx;
+    SMOPS_CTX *call;
+    SMOPS_JOB job;
+    void *arg;
+    SMOPS_FUTURE **after;
+    int after_count;
+    struct future_edge *edges;
+    struct future_edge *dependents;
+    int pending;
+    int failed;
+    int status;
+    int released;
+    int done;
+    int merged;
+    POOL_CALL node;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+};
+
+/** Arguments of load_job */
+struct load_args {
+    MATRIX *matrix;
+    char *filename;
+};
+
+/** Arguments of op_job, see MATRIX_OP_async */
+struct op_args {
+    OPERATION op;
+    MATRIX *result;
+    MATRIX_DATA *result_num;
+    MATRIX *a;
+    MATRIX *b;
+    double scalar;
+};
+
+/** Counts off one call a call waits for, queueing the call on the pool when
+*   none are left
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the waiting call
+*       int status: what the call it waited for returned
+*/
+static void future_release(SMOPS_FUTURE *future, int status)
+{
+    if(status == 0) {
+        __atomic_store_n(&future->failed, 1, __ATOMIC_RELAXED);
+    }
+    if(__atomic_sub_fetch(&future->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+        POOL_submit(future->call->pool, &future->node);
+    }
+}
+
+/** Runs a call taken from the queue of the pool, or skips its job if a call it
+*   waits for failed. The calls waiting for it are released before it is marked
+*   done, so a thread waiting for one of them finds it queued.
+*
+*   parameters:
+*       void *arg: the SMOPS_FUTURE of the call
+*/
+static void future_run(void *arg)
+{
+    SMOPS_FUTURE *future = (SMOPS_FUTURE *)arg;
+    int status = 0;
+    if(__atomic_load_n(&future->failed, __ATOMIC_ACQUIRE)) {
+        SMOPS_CTX_fill_err_msg(future->call, "a call this call waits for failed");
+    } else {
+        status = future->job(future->call, future->arg);
+    }
+
+    pthread_mutex_lock(&future->lock);
+    future->status = status;
+    future->released = 1;
+    struct future_edge *edge = future->dependents, *next;
+    future->dependents = NULL;
+    pthread_mutex_unlock(&future->lock);
+    for(; edge != NULL; edge = next) {
+        next = edge->next;
+        future_release(edge->future, status);
+    }
+
+    pthread_mutex_lock(&future->lock);
+    future->done = 1;
+    pthread_cond_broadcast(&future->finished);
+    pthread_mutex_unlock(&future->lock);
+}
+
+/** Waits for a call to finish without merging it. A call no pool thread has
+*   taken yet is run on the waiting thread, after the calls it waits for, so
+*   waiting never depends on a free pool thread.
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the call
+*
+*   return:
+*       1 if the call succeeded, 0 otherwise
+*/
+static int future_finish(SMOPS_FUTURE *future)
+{
+    if(SMOPS_FUTURE_poll(future) == 0) {
+        for(int k = 0; k < future->after_count; k++) {
+            future_finish(future->after[k]);
+        }
+        if(POOL_claim(future->call->pool, &future->node)) {
+            future_run(future);
+        }
+    }
+    pthread_mutex_lock(&future->lock);
+    while(future->done == 0) {
+        pthread_cond_wait(&future->finished, &future->lock);
+    }
+    int status = future->status;
+    pthread_mutex_unlock(&future->lock);
+    return status;
+}
+
+/** Frees a call that has not been queued
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the call
+*/
+static void future_free(SMOPS_FUTURE *future)
+{
+    if(future->call != NULL) SMOPS_CTX_free(future->call);
+    free(future->arg);
+    free(future->after);
+    free(future->edges);
+    free(future);
+}
+
+/** Starts a call as a job on the thread pool of ctx, so independent work such
+*   as loading two matrices runs at the same time. The job runs with a SMOPS_CTX
+*   made by SMOPS_CTX_new_call on ctx. It is queued on the pool once every call
+*   in after has finished, so it never holds a thread while it waits, and is
+*   skipped if one of them failed. Its parallel loops share the threads of the
+*   pool of ctx with the loops of other calls. A pool with one worker has no
+*   threads, its calls run on the thread waiting for them. The calls in after
+*   must not be freed before this call is waited for.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX the call is made on
+*       SMOPS_JOB job: the work of the call
+*       void *arg: the argument given to job, copied into the call
+*       size_t arg_size: the size of arg in bytes
+*       SMOPS_FUTURE **after: the calls that must finish first, NULL if after_count is 0
+*       int after_count: the number of calls in after
+*
+*   return:
+*       the SMOPS_FUTURE of the call freed with SMOPS_FUTURE_free,
+*       NULL if it could not be started filling err_msg
+*/
+SMOPS_FUTURE *SMOPS_async(SMOPS_CTX *ctx, SMOPS_JOB job, void *arg, size_t arg_size,
+    SMOPS_FUTURE **after, int after_count)
+{
+    SMOPS_FUTURE *future = (SMOPS_FUTURE *)calloc(1, sizeof(SMOPS_FUTURE));
+    if(future == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for call");
+        return NULL;
+    }
+    future->ctx = ctx;
+    future->job = job;
+    future->after_count = after_count;
+    future->arg = malloc(arg_size);
+    future->after = (SMOPS_FUTURE **)malloc(sizeof(SMOPS_FUTURE *)*(after_count + 1));
+    future->edges = (struct future_edge *)malloc(sizeof(struct future_edge)*(after_count + 1));
+    if(future->arg == NULL || future->after == NULL || future->edges == NULL) {
+        future_free(future);
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for call");
+        return NULL;
+    }
+    memcpy(future->arg, arg, arg_size);
+    if(after_count > 0) {
+        memcpy(future->after, after, sizeof(SMOPS_FUTURE *)*after_count);
+    }
+    if((future->call = SMOPS_CTX_new_call(ctx)) == NULL) {
+        future_free(future);
+        return NULL;
+    }
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->finished, NULL);
+    future->node.run = future_run;
+    future->node.arg = future;
+
+    //The extra count keeps the call from being queued before every call in after is linked
+    future->pending = 1;
+    SMOPS_FUTURE *first;
+    for(int k = 0; k < after_count; k++) {
+        first = after[k];
+        pthread_mutex_lock(&first->lock);
+        if(first->released) {
+            if(first->status == 0) {future->failed = 1;}
+        } else {
+            future->edges[k].future = future;
+            future->edges[k].next = first->dependents;
+            first->dependents = &future->edges[k];
+            __atomic_add_fetch(&future->pending, 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&first->lock);
+    }
+    future_release(future, 1);
+    return future;
+}
+
+/** Waits for a call to finish and merges it into the SMOPS_CTX it was made on
+*   with SMOPS_CTX_merge_call, which happens once however often it is waited for.
+*   Calls on the same SMOPS_CTX should be waited for by one thread.
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the call
+*
+*   return:
+*       1 if the call succeeded, 0 otherwise with the err_msg of the call in its SMOPS_CTX
+*/
+int SMOPS_FUTURE_wait(SMOPS_FUTURE *future)
+{
+    int status = future_finish(future);
+    if(future->merged == 0) {
+        SMOPS_CTX_merge_call(future->ctx, future->call);
+        future->merged = 1;
+    }
+    return status;
+}
+
+/** Checks if a call has finished without waiting for it
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the call
+*
+*   return:
+*       1 if the call has finished, 0 if it is still queued, running or waiting
+*/
+int SMOPS_FUTURE_poll(SMOPS_FUTURE *future)
+{
+    pthread_mutex_lock(&future->lock);
+    int done = future->done;
+    pthread_mutex_unlock(&future->lock);
+    return done;
+}
+
+/** Frees a call, waiting for it first if it has not been waited for
+*
+*   parameters:
+*       SMOPS_FUTURE *future: the call
+*/
+void SMOPS_FUTURE_free(SMOPS_FUTURE *future)
+{
+    SMOPS_FUTURE_wait(future);
+    pthread_mutex_destroy(&future->lock);
+    pthread_cond_destroy(&future->finished);
+    future_free(future);
+}
+
+/** Loads a matrix for an asynchronous call
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX of the call
+*       void *arg: the struct load_args
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+static int load_job(SMOPS_CTX *ctx, void *arg)
+{
+    struct load_args *args = (struct load_args *)arg;
+    return MATRIX_load(ctx, args->matrix, args->filename);
+}
+
+/** Starts loading a matrix as a call on the thread pool, see MATRIX_load and
+*   SMOPS_async. The matrix and the filename must not be touched until the call
+*   is waited for.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: the matrix the file is loaded into
+*       char *filename: the file to load
+*
+*   return:
+*       the SMOPS_FUTURE of the load, NULL if it could not be started filling err_msg
+*/
+SMOPS_FUTURE *MATRIX_load_async(SMOPS_CTX *ctx, MATRIX *matrix, char *filename)
+{
+    struct load_args args = { matrix, filename };
+    return SMOPS_async(ctx, load_job, &args, sizeof(args), NULL, 0);
+}
+
+/** Runs an operation for an asynchronous call
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX of the call
+*       void *arg: the struct op_args
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+static int op_job(SMOPS_CTX *ctx, void *arg)
+{
+    struct op_args *args = (struct op_args *)arg;
+    SMOPS_CTX_set_operation(ctx, args->op);
+    switch(args->op) {
+        case SCALAR_MULT:
+            return MATRIX_OP_scalar_multiplication(ctx, args->result, args->a, args->scalar);
+        case TRACE:
+            return MATRIX_OP_trace(ctx, args->result_num, args->a);
+        case ADD:
+            return MATRIX_OP_addition(ctx, args->a, args->b);
+        case TRANSPOSE:
+            return MATRIX_OP_transpose(ctx, args->result, args->a);
+        case MATRIX_MULT:
+            return MATRIX_OP_multiplication(ctx, args->a, args->b);
+        case TRACE_PRODUCT:
+            return MATRIX_OP_trace_product(ctx, args->result_num, args->a, args->b);
+        case INNER_PRODUCT:
+            return MATRIX_OP_inner_product(ctx, args->result_num, args->a, args->b);
+        case ELEMENT_SUM:
+            return MATRIX_OP_sum(ctx, args->result_num, args->a);
+        case MATRIX_VECTOR_MULT:
+            return MATRIX_OP_spmv(ctx, args->a, args->b);
+        case MATRIX_BLOCK_MULT:
+            return MATRIX_OP_spmm(ctx, args->a, args->b);
+        case TRANSPOSE_VECTOR_MULT:
+            return MATRIX_OP_transpose_spmv(ctx, args->a, args->b);
+        default:
+            SMOPS_CTX_fill_err_msg(ctx, "no operation given to the call");
+            return 0;
+    }
+}
+
+/** Starts an operation as a call on the thread pool once the calls in after
+*   have finished, such as the loads of its matrices, see SMOPS_async. The
+*   matrices are read and the results written only by the call until it is
+*   waited for, and the RESULT of the operation is moved into ctx when it is.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       OPERATION op: the operation to perform
+*       MATRIX *result: the result matrix of scalar multiplication and transpose, NULL otherwise
+*       MATRIX_DATA *result_num: the result of trace, trace product, inner product
+*                                and sum, NULL otherwise
+*       MATRIX *matrix_a: the left (or only) matrix
+*       MATRIX *matrix_b: the right matrix or vector, NULL for one matrix operations
+*       double scalar: the scalar of scalar multiplication
+*       SMOPS_FUTURE **after: the calls that must finish first, NULL if after_count is 0
+*       int after_count: the number of calls in after
+*
+*   return:
+*       the SMOPS_FUTURE of the operation, NULL if it could not be started filling err_msg
+*/
+SMOPS_FUTURE *MATRIX_OP_async(SMOPS_CTX *ctx, OPERATION op, MATRIX *result, MATRIX_DATA *result_num,
+    MATRIX *matrix_a, MATRIX *matrix_b, double scalar, SMOPS_FUTURE **after, int after_count)
+{
+    struct op_args args = { op, result, result_num, matrix_a, matrix_b, scalar };
+    return SMOPS_async(ctx, op_job, &args, sizeof(args), after, after_count);
+}
@@ -4,6 +4,9 @@
 
 #include "smops.h"
 
+#define CTX_WORK_PER_THREAD 32768 //element updates that pay for waking one more worker
+#define CTX_LINE_SIZE 96
+
 /** Creates a new SMOPS_CTX for storing data for the library.
 *
 *   return:
@@ -23,18 +26,86 @@ SMOPS_CTX *SMOPS_CTX_new()
         exit(EXIT_FAILURE);
     }
 
+    ctx->plan_report = (char *)calloc(PLAN_REPORT_BUFFER, sizeof(char));
+    if(ctx->plan_report == NULL) {
+        fprintf(stderr, "%s: ERROR! failed to allocate memory for plan report\n", LIBNAME);
+        exit(EXIT_FAILURE);
+    }
+
     ctx->thread_num = DEFAULT_THREAD_NUM;
+    ctx->thread_auto = 0;
+    ctx->schedule = SCHEDULE_STEAL;
+    ctx->affinity = AFFINITY_NONE;
+    ctx->reproducible = 0;
+    memset(ctx->grain, 0, sizeof(ctx->grain));
+    ctx->phase.kind = PHASE_LOAD;
+    ctx->phase.threads = DEFAULT_THREAD_NUM;
+    ctx->phase.grain = 0;
+    memset(ctx->phase_tasks, 0, sizeof(ctx->phase_tasks));
     ctx->log = DEFAULT_LOG;
     ctx->err = 0;
     ctx->operation = NO_OP;
     ctx->log_prefix = NULL;
     ctx->time_load = 0;
     ctx->time_op = 0;
+    ctx->flop_count = 0;
+    ctx->byte_count = 0;
+    ctx->dense_threshold = DEFAULT_DENSE_THRESHOLD;
+    ctx->result = NULL;
+    ctx->shared = NULL;
+
+    ctx->pool = POOL_new(ctx->thread_num);
+    if(ctx->pool == NULL) {
+        fprintf(stderr, "%s: ERROR! failed to start the thread pool\n", LIBNAME);
+        exit(EXIT_FAILURE);
+    }
+    return ctx;
+}
+
+/** Creates the SMOPS_CTX of one call on a shared SMOPS_CTX, so several threads
+*   of a process can run operations at the same time. The call gets its own
+*   result, error message, timings, plan report and phase, and starts with the
+*   settings of the shared SMOPS_CTX. It runs its parallel loops on the pool of
+*   the shared SMOPS_CTX, which splits its threads between the loops of the calls
+*   running at the same time. The shared SMOPS_CTX must outlive its calls.
+*
+*   parameters:
+*       SMOPS_CTX *shared: the SMOPS_CTX whose pool and settings are used
+*
+*   return:
+*       a pointer to the SMOPS_CTX of the call, NULL if it could not be allocated
+*       filling the err_msg of the shared SMOPS_CTX
+*/
+SMOPS_CTX *SMOPS_CTX_new_call(SMOPS_CTX *shared)
+{
+    SMOPS_CTX *ctx = (SMOPS_CTX *)malloc(sizeof(SMOPS_CTX));
+    if(ctx == NULL) {
+        SMOPS_CTX_fill_err_msg(shared, "failed to allocate memory for call ctx");
+        return NULL;
+    }
+    *ctx = *shared;
+    ctx->shared = shared->shared != NULL ? shared->shared : shared;
+    ctx->err = 0;
+    ctx->log_prefix = NULL;
     ctx->result = NULL;
+    ctx->time_load = 0;
+    ctx->time_op = 0;
+    ctx->flop_count = 0;
+    ctx->byte_count = 0;
+    memset(ctx->phase_tasks, 0, sizeof(ctx->phase_tasks));
+    ctx->err_msg = (char *)malloc(sizeof(char)*ERR_MSG_BUFFER);
+    ctx->plan_report = (char *)calloc(PLAN_REPORT_BUFFER, sizeof(char));
+    if(ctx->err_msg == NULL || ctx->plan_report == NULL
+        || (shared->log_prefix != NULL && SMOPS_CTX_set_log_name_prefix(ctx, shared->log_prefix) == 0)) {
+        SMOPS_CTX_fill_err_msg(shared, "failed to allocate memory for call ctx");
+        SMOPS_CTX_free(ctx);
+        return NULL;
+    }
     return ctx;
 }
 
-/** Frees all data inside the SMOPS_CTX
+/** Frees all data inside the SMOPS_CTX, the pool of a call is left to its
+*   shared SMOPS_CTX
 *
 *   parameters:
 *       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX to be freed
@@ -43,11 +114,30 @@ void SMOPS_CTX_free(SMOPS_CTX *ctx)
 {
     if(ctx->err_msg != NULL) free(ctx->err_msg);
     if(ctx->log_prefix != NULL) free(ctx->log_prefix);
+    if(ctx->plan_report != NULL) free(ctx->plan_report);
     if(ctx->result != NULL) SMOPS_RESULT_free(ctx->result);
+    if(ctx->shared == NULL) POOL_free(ctx->pool);
     free(ctx);
 }
 
-/** Fills the err_msg in SMOPS_CTX with an error message
+/** Takes the result of the last operation out of the SMOPS_CTX, so it lives on
+*   after the SMOPS_CTX of its call is freed
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*
+*   return:
+*       the RESULT freed by the caller with SMOPS_RESULT_free, NULL if there is none
+*/
+RESULT *SMOPS_CTX_take_result(SMOPS_CTX *ctx)
+{
+    RESULT *result = ctx->result;
+    ctx->result = NULL;
+    return result;
+}
+
+/** Fills the err_msg in SMOPS_CTX with an error message, a message longer than
+*   the buffer is cut short
 *
 *   parameters:
 *       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
@@ -57,11 +147,10 @@ void SMOPS_CTX_fill_err_msg(SMOPS_CTX *ctx, char *err_msg)
 {
     int err_msg_len = strlen(err_msg);
     if(err_msg_len + 1 > ERR_MSG_BUFFER) {
-        fprintf(stderr, "%s: ERROR! error message is greater than %d chars long\n", LIBNAME, ERR_MSG_BUFFER);
-        exit(EXIT_FAILURE);
+        err_msg_len = ERR_MSG_BUFFER - 1;
     }
     ctx->err = 1;
-    strncpy(ctx->err_msg, err_msg, err_msg_len);
+    memcpy(ctx->err_msg, err_msg, err_msg_len);
     *(ctx->err_msg + err_msg_len) = '\0';
 }
 
@@ -78,7 +167,9 @@ void SMOPS_CTX_print_err(SMOPS_CTX *ctx)
     }
 }
 
-/** Sets the number of threads to be used for calculations.
+/** Sets the number of threads to be used for calculations. The thread pool
+*   is restarted with the new number of workers. A call keeps the pool of its
+*   shared SMOPS_CTX and uses at most as many threads as that pool has.
 *
 *   parameters:
 *       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
@@ -94,10 +185,195 @@ int SMOPS_CTX_set_thread_num(SMOPS_CTX *ctx, int thread_num)
         SMOPS_CTX_fill_err_msg(ctx, "thread_num is invalid (thread_num <= 0)");
         return 0;
     }
+    if(ctx->shared != NULL && thread_num > ctx->shared->thread_num) {
+        SMOPS_CTX_fill_err_msg(ctx, "thread_num is invalid (more than the shared ctx)");
+        return 0;
+    }
+    if(thread_num != ctx->thread_num && ctx->shared == NULL) {
+        POOL *pool = POOL_new(thread_num);
+        if(pool == NULL) {
+            SMOPS_CTX_fill_err_msg(ctx, "failed to start the thread pool");
+            return 0;
+        }
+        if(ctx->affinity != AFFINITY_NONE && POOL_pin(pool, ctx->affinity) == 0) {
+            POOL_free(pool);
+            SMOPS_CTX_fill_err_msg(ctx, "failed to pin the threads of the pool");
+            return 0;
+        }
+        POOL_free(ctx->pool);
+        ctx->pool = pool;
+    }
     ctx->thread_num = thread_num;
+    ctx->thread_auto = 0;
+    ctx->phase.threads = thread_num;
+    return 1;
+}
+
+/** Lets the library pick the number of threads. The pool gets one worker for
+*   every thread the machine can run (see POOL_cpu_count) and each phase, the
+*   loading, converting and the operation, then uses as many of them as its
+*   amount of work pays for (see SMOPS_CTX_plan_phase). A call is capped at
+*   the threads of its shared SMOPS_CTX.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling err_msg
+*/
+int SMOPS_CTX_set_thread_auto(SMOPS_CTX *ctx)
+{
+    int threads = POOL_cpu_count();
+    if(ctx->shared != NULL && threads > ctx->shared->thread_num) {
+        threads = ctx->shared->thread_num;
+    }
+    if(SMOPS_CTX_set_thread_num(ctx, threads) == 0) {return 0;}
+    ctx->thread_auto = 1;
+    return 1;
+}
+
+/** Sets how the parallel loops hand out their iterations to the threads
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       SCHEDULE schedule: the scheduling policy
+*
+*   return:
+*       1 if the schedule is valid, 0 otherwise and fills err_msg
+*/
+int SMOPS_CTX_set_schedule(SMOPS_CTX *ctx, SCHEDULE schedule)
+{
+    if(schedule < SCHEDULE_STEAL || schedule > SCHEDULE_GUIDED) {
+        SMOPS_CTX_fill_err_msg(ctx, "schedule is invalid");
+        return 0;
+    }
+    ctx->schedule = schedule;
+    return 1;
+}
+
+/** Pins the threads of the pool to CPUs, worker 0 being the calling thread.
+*   Compact placement keeps the threads on as few NUMA nodes as it can, scatter
+*   spreads them over all nodes for their memory bandwidth. Together with the
+*   first touch zeroing of POOL_calloc the pages of large arrays stay on the
+*   node of the thread working on them.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       AFFINITY affinity: the placement of the threads
+*
+*   return:
+*       1 if the threads were pinned, 0 otherwise and fills err_msg
+*/
+int SMOPS_CTX_set_affinity(SMOPS_CTX *ctx, AFFINITY affinity)
+{
+    if(affinity < AFFINITY_NONE || affinity > AFFINITY_SCATTER) {
+        SMOPS_CTX_fill_err_msg(ctx, "affinity is invalid");
+        return 0;
+    }
+    if(ctx->shared != NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "affinity of a call is set on its shared ctx");
+        return 0;
+    }
+    if(POOL_pin(ctx->pool, affinity) == 0) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to pin the threads of the pool");
+        return 0;
+    }
+    ctx->affinity = affinity;
+    return 1;
+}
+
+/** Sets if float results are reproducible. Float reductions are then summed in
+*   blocks whose bounds only depend on the length of the loop and the blocks are
+*   added in a fixed pairwise tree, and merge path splits get a fixed number of
+*   parts, so the result is bit for bit the same for any number of threads,
+*   schedule or grain.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       int reproducible: 1 for reproducible float results, 0 otherwise
+*/
+void SMOPS_CTX_set_reproducible(SMOPS_CTX *ctx, int reproducible)
+{
+    ctx->reproducible = reproducible != 0;
+}
+
+/** Sets the grain of the parallel loops of an operation, the number of
+*   iterations below which a range is run as one task
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       OPERATION op: the operation, NO_OP for loading and converting matrices
+*       SMOPS_INDEX grain: the grain, 0 keeps the grain each loop asks for
+*
+*   return:
+*       1 if the operation and grain are valid (grain >= 0), 0 otherwise and fills err_msg
+*/
+int SMOPS_CTX_set_grain(SMOPS_CTX *ctx, OPERATION op, SMOPS_INDEX grain)
+{
+    if(op < NO_OP || op >= OP_COUNT) {
+        SMOPS_CTX_fill_err_msg(ctx, "operation is invalid for setting the grain");
+        return 0;
+    }
+    if(grain < 0) {
+        SMOPS_CTX_fill_err_msg(ctx, "grain is invalid (grain < 0)");
+        return 0;
+    }
+    ctx->grain[op] = grain;
     return 1;
 }
 
+/** Gets the number of tasks the parallel loops of a kind of phase have run,
+*   a loop run on the calling thread alone counts as one task
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       PHASE_KIND kind: the kind of phase
+*
+*   return:
+*       the number of tasks
+*/
+long SMOPS_CTX_get_tasks(SMOPS_CTX *ctx, PHASE_KIND kind)
+{
+    return ctx->phase_tasks[kind];
+}
+
+/** Starts a phase. With automatic threads the phase gets one thread for every
+*   CTX_WORK_PER_THREAD element updates of its estimated work, up to the threads
+*   of the pool, so small inputs run on the calling thread alone, and the choice
+*   is added to the plan report. Otherwise every phase uses all threads. The
+*   grain set for the operation, or for NO_OP when loading or converting, is
+*   used by the loops of the phase.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       PHASE_KIND kind: the kind of phase
+*       OPERATION op: the operation run by a PHASE_OP phase
+*       double work: the number of element updates the phase does
+*
+*   return:
+*       the phase before, to restore after a nested phase
+*/
+PHASE SMOPS_CTX_plan_phase(SMOPS_CTX *ctx, PHASE_KIND kind, OPERATION op, double work)
+{
+    PHASE previous = ctx->phase;
+    ctx->phase.kind = kind;
+    ctx->phase.grain = ctx->grain[kind == PHASE_OP ? op : NO_OP];
+    if(ctx->thread_auto == 0) {
+        ctx->phase.threads = ctx->thread_num;
+        return previous;
+    }
+    double threads = work/CTX_WORK_PER_THREAD;
+    ctx->phase.threads = threads < 1 ? 1 : threads > ctx->thread_num ? ctx->thread_num : (int)threads;
+
+    char *phase_to_string[] = PHASE_MAP_STRING;
+    char *op_to_string[] = OP_MAP_STRING;
+    char line[CTX_LINE_SIZE];
+    snprintf(line, CTX_LINE_SIZE, "plan: %s on %d of %d threads (work %.0f)",
+        kind == PHASE_OP ? op_to_string[op] : phase_to_string[kind], ctx->phase.threads, ctx->thread_num, work);
+    SMOPS_CTX_add_plan_report(ctx, line);
+    return previous;
+}
+
 /** Gets the number of threads that should be used.
 *
 *   parameters:
@@ -184,7 +460,90 @@ int SMOPS_CTX_set_log_name_prefix(SMOPS_CTX *ctx, char *prefix)
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for log file name prefix");
         return 0;
     }
-    strncpy(ctx->log_prefix, prefix, prefix_len);
+    memcpy(ctx->log_prefix, prefix, prefix_len);
     ctx->log_prefix[prefix_len] = '\0';
     return 1;
 }
+
+/** Sets the density at or above which addition and multiplication use the dense engine
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       double threshold: the density threshold, anything above 1 disables the dense engine
+*
+*   return:
+*       1 if valid threshold has been set (threshold >= 0)
+*       0 otherwise and fills err_msg
+*/
+int SMOPS_CTX_set_dense_threshold(SMOPS_CTX *ctx, double threshold)
+{
+    if(threshold < 0) {
+        SMOPS_CTX_fill_err_msg(ctx, "dense threshold is invalid (threshold < 0)");
+        return 0;
+    }
+    ctx->dense_threshold = threshold;
+    return 1;
+}
+
+/** Gets the density at or above which addition and multiplication use the dense engine
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*
+*   returns:
+*       the density threshold
+*/
+double SMOPS_CTX_get_dense_threshold(SMOPS_CTX *ctx)
+{
+    return ctx->dense_threshold;
+}
+
+/** Adds a line to the plan report, lines past the end of the report buffer are dropped
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       char *line: the line to add to the plan report
+*/
+void SMOPS_CTX_add_plan_report(SMOPS_CTX *ctx, char *line)
+{
+    int report_len = strlen(ctx->plan_report);
+    int line_len = strlen(line);
+    if(report_len + line_len + 2 > PLAN_REPORT_BUFFER) {return;}
+    memcpy(ctx->plan_report + report_len, line, line_len);
+    ctx->plan_report[report_len + line_len] = '\n';
+    ctx->plan_report[report_len + line_len + 1] = '\0';
+}
+
+/** Merges a finished call into the SMOPS_CTX it was made on. Load times and
+*   tasks are added up, the plan report of the call is appended, and the timings,
+*   counts and result of an operation run by the call replace those of ctx. The
+*   first error of either SMOPS_CTX is kept.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX the call was made on
+*       SMOPS_CTX *call: a pointer to the SMOPS_CTX of the finished call
+*/
+void SMOPS_CTX_merge_call(SMOPS_CTX *ctx, SMOPS_CTX *call)
+{
+    int report_len = strlen(ctx->plan_report);
+    int call_len = strlen(call->plan_report);
+    if(report_len + call_len + 1 <= PLAN_REPORT_BUFFER) {
+        memcpy(ctx->plan_report + report_len, call->plan_report, call_len + 1);
+    }
+    ctx->time_load += call->time_load;
+    for(int k = 0; k < PHASE_COUNT; k++) {
+        ctx->phase_tasks[k] += call->phase_tasks[k];
+    }
+    if(call->time_op > 0 || call->result != NULL) {
+        ctx->time_op = call->time_op;
+        ctx->flop_count = call->flop_count;
+        ctx->byte_count = call->byte_count;
+    }
+    if(call->result != NULL) {
+        if(ctx->result != NULL) SMOPS_RESULT_free(ctx->result);
+        ctx->result = SMOPS_CTX_take_result(call);
+    }
+    if(call->err == 1 && ctx->err == 0) {
+        SMOPS_CTX_fill_err_msg(ctx, call->err_msg);
+    }
+}
@@ -1,39 +1,102 @@
 #include <stdlib.h>
-#include <omp.h>
+#include <string.h>
 
 #include "smops.h"
 
-MATRIX_DATA *COO_to_dense(SMOPS_CTX *ctx, COO_DATA *coo_data, int rows, int cols, int non_zero_size)
+#define VALUES_HASH_BITS 10 //4 slots per dictionary entry
+#define VALUES_HASH_MULT 0x9E3779B97F4A7C15ULL
+
+/** Arguments of the tasks converting to a dense matrix */
+struct to_dense_args {
+    MATRIX_DATA *dense;
+    COO_DATA *coo_data;
+    DIA_DATA *dia_data;
+    int cols;
+};
+
+/** Writes the elements p to q of COO_DATA into a dense matrix
+*
+*   parameters:
+*       void *arg: the struct to_dense_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: unused
+*/
+void coo_to_dense_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct to_dense_args *a = (struct to_dense_args *)arg;
+    COO_DATA *coo_data = a->coo_data;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        a->dense[(size_t)coo_data->coords_i[i]*a->cols + coo_data->coords_j[i]] = coo_data->values[i];
+    }
+}
+
+MATRIX_DATA *COO_to_dense(SMOPS_CTX *ctx, COO_DATA *coo_data, int rows, int cols, SMOPS_INDEX non_zero_size)
 {
     if(coo_data == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "tried to convert empty COO_DATA to a dense matrix");
         return NULL;
     }
-    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)calloc(rows*cols, sizeof(MATRIX_DATA));
+    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)POOL_calloc(ctx, (size_t)rows*cols, sizeof(MATRIX_DATA));
     if(dense_matrix == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dense matrix from COO_DATA");
         return NULL;
     }
 
-    int i, index;
-    switch(ctx->thread_num) {
-        case 1:
-            for(i = 0; i < non_zero_size; i++) {
-                index = coo_data->coords_i[i]*rows + coo_data->coords_j[i];
-                dense_matrix[index] = coo_data->values[i];
-            }
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num) private(i, index)
-            {
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    index = coo_data->coords_i[i]*rows + coo_data->coords_j[i];
-                    dense_matrix[index] = coo_data->values[i];
-                }
-            }
-            break;
+    struct to_dense_args args = { dense_matrix, coo_data, NULL, cols };
+    POOL_parallel_for(ctx, non_zero_size, 0, coo_to_dense_task, &args);
+    return dense_matrix;
+}
+
+/** Writes the diagonals p to q of DIA_DATA into a dense matrix
+*
+*   parameters:
+*       void *arg: the struct to_dense_args
+*       SMOPS_INDEX p: the first diagonal
+*       SMOPS_INDEX q: the diagonal after the last diagonal
+*       int worker: unused
+*/
+void dia_to_dense_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct to_dense_args *a = (struct to_dense_args *)arg;
+    DIA_DATA *dia_data = a->dia_data;
+    for(SMOPS_INDEX d = p; d < q; d++) {
+        int k = dia_data->offsets[d];
+        int first = k < 0 ? -k : 0;
+        MATRIX_DATA *values = dia_data->values + dia_data->start[d];
+        for(SMOPS_INDEX n = 0; n < dia_data->start[d+1] - dia_data->start[d]; n++) {
+            a->dense[(size_t)(first + n)*a->cols + first + n + k] = values[n];
+        }
     }
+}
+
+/** Converts DIA_DATA to a dense matrix, every diagonal is written by one thread
+*   and no two diagonals share an element
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling and the number of threads
+*       DIA_DATA *dia_data: the DIA_DATA to convert
+*       int rows: the number of rows in the matrix
+*       int cols: the number of columns in the matrix
+*
+*   return:
+*       the dense matrix, NULL if an error has occurred filling error message
+*/
+MATRIX_DATA *DIA_to_dense(SMOPS_CTX *ctx, DIA_DATA *dia_data, int rows, int cols)
+{
+    if(dia_data == NULL || dia_data->start == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "tried to convert empty DIA_DATA to a dense matrix");
+        return NULL;
+    }
+    MATRIX_DATA *dense_matrix = (MATRIX_DATA *)POOL_calloc(ctx, rows*cols > 0 ? (size_t)rows*cols : 1,
+                                                           sizeof(MATRIX_DATA));
+    if(dense_matrix == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dense matrix from DIA_DATA");
+        return NULL;
+    }
+
+    struct to_dense_args args = { dense_matrix, NULL, dia_data, cols };
+    POOL_parallel_for(ctx, dia_data->diagonals, 1, dia_to_dense_task, &args);
     return dense_matrix;
 }
 /** Initialises the memory for CSC_DATA
@@ -54,7 +117,229 @@ CSC_DATA *CSC_new(SMOPS_CTX *ctx)
     }
     data->nnz = NULL;
     data->ia = NULL;
+    data->ia32 = NULL;
+    data->ja = NULL;
+    data->ja16 = NULL;
+    data->packed.coding = VALUES_FULL;
+    data->packed.data = NULL;
+    data->packed.dict = NULL;
+    data->packed.dict_size = 0;
+    return data;
+}
+
+/** Initialises the memory for DENSE_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the DENSE_DATA
+*       returns NULL if an error has occurred
+*/
+DENSE_DATA *DENSE_new(SMOPS_CTX *ctx)
+{
+    DENSE_DATA *data = (DENSE_DATA *)malloc(sizeof(DENSE_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for DENSE_DATA for matrix");
+        return NULL;
+    }
+    data->values = NULL;
+    return data;
+}
+
+/** Initialises the memory for ELL_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the ELL_DATA
+*       returns NULL if an error has occurred
+*/
+ELL_DATA *ELL_new(SMOPS_CTX *ctx)
+{
+    ELL_DATA *data = (ELL_DATA *)malloc(sizeof(ELL_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for ELL_DATA for matrix");
+        return NULL;
+    }
+    data->nnz = NULL;
+    data->ja = NULL;
+    data->width = 0;
+    return data;
+}
+
+/** Initialises the memory for SELL_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the SELL_DATA
+*       returns NULL if an error has occurred
+*/
+SELL_DATA *SELL_new(SMOPS_CTX *ctx)
+{
+    SELL_DATA *data = (SELL_DATA *)malloc(sizeof(SELL_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for SELL_DATA for matrix");
+        return NULL;
+    }
+    data->nnz = NULL;
+    data->ja = NULL;
+    data->cs = NULL;
+    data->cl = NULL;
+    data->perm = NULL;
+    data->chunks = 0;
+    return data;
+}
+
+/** Initialises the memory for BCSR_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the BCSR_DATA
+*       returns NULL if an error has occurred
+*/
+BCSR_DATA *BCSR_new(SMOPS_CTX *ctx)
+{
+    BCSR_DATA *data = (BCSR_DATA *)malloc(sizeof(BCSR_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for BCSR_DATA for matrix");
+        return NULL;
+    }
+    data->nnz = NULL;
+    data->ia = NULL;
+    data->ja = NULL;
+    data->block = 0;
+    data->block_rows = 0;
+    data->block_cols = 0;
+    data->blocks = 0;
+    return data;
+}
+
+/** Initialises the memory for DIA_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the DIA_DATA
+*       returns NULL if an error has occurred
+*/
+DIA_DATA *DIA_new(SMOPS_CTX *ctx)
+{
+    DIA_DATA *data = (DIA_DATA *)malloc(sizeof(DIA_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for DIA_DATA for matrix");
+        return NULL;
+    }
+    data->values = NULL;
+    data->offsets = NULL;
+    data->start = NULL;
+    data->diagonals = 0;
+    return data;
+}
+
+/** Initialises the memory for DCSR_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the DCSR_DATA
+*       returns NULL if an error has occurred
+*/
+DCSR_DATA *DCSR_new(SMOPS_CTX *ctx)
+{
+    DCSR_DATA *data = (DCSR_DATA *)malloc(sizeof(DCSR_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for DCSR_DATA for matrix");
+        return NULL;
+    }
+    data->nnz = NULL;
+    data->ia = NULL;
+    data->ja = NULL;
+    data->row_ids = NULL;
+    data->nzr = 0;
+    return data;
+}
+
+/** Initialises the memory for CSB_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the CSB_DATA
+*       returns NULL if an error has occurred
+*/
+CSB_DATA *CSB_new(SMOPS_CTX *ctx)
+{
+    CSB_DATA *data = (CSB_DATA *)malloc(sizeof(CSB_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for CSB_DATA for matrix");
+        return NULL;
+    }
+    data->values = NULL;
+    data->lo_i = NULL;
+    data->lo_j = NULL;
+    data->blk_ptr = NULL;
+    data->beta = 0;
+    data->block_rows = 0;
+    data->block_cols = 0;
+    return data;
+}
+
+/** Initialises the memory for BITMAP_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the BITMAP_DATA
+*       returns NULL if an error has occurred
+*/
+BITMAP_DATA *BITMAP_new(SMOPS_CTX *ctx)
+{
+    BITMAP_DATA *data = (BITMAP_DATA *)malloc(sizeof(BITMAP_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for BITMAP_DATA for matrix");
+        return NULL;
+    }
+    data->values = NULL;
+    data->masks = NULL;
+    data->ia = NULL;
+    data->ja = NULL;
+    data->val_ptr = NULL;
+    data->tile_rows = 0;
+    data->tile_cols = 0;
+    data->tiles = 0;
+    return data;
+}
+
+/** Initialises the memory for CSRDU_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX for error handling
+*
+*   return:
+*       a pointer to the allocated memory for the CSRDU_DATA
+*       returns NULL if an error has occurred
+*/
+CSRDU_DATA *CSRDU_new(SMOPS_CTX *ctx)
+{
+    CSRDU_DATA *data = (CSRDU_DATA *)malloc(sizeof(CSRDU_DATA));
+    if(data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for CSRDU_DATA for matrix");
+        return NULL;
+    }
+    data->nnz = NULL;
     data->ja = NULL;
+    data->ia = NULL;
+    data->ja_ptr = NULL;
     return data;
 }
 
@@ -76,7 +361,13 @@ CSR_DATA *CSR_new(SMOPS_CTX *ctx)
     }
     data->nnz = NULL;
     data->ia = NULL;
+    data->ia32 = NULL;
     data->ja = NULL;
+    data->ja16 = NULL;
+    data->packed.coding = VALUES_FULL;
+    data->packed.data = NULL;
+    data->packed.dict = NULL;
+    data->packed.dict_size = 0;
     return data;
 }
 
@@ -115,6 +406,37 @@ void COO_free(COO_DATA *coo_data)
     free(coo_data);
 }
 
+/** Copies COO_DATA, so a view can sort its own elements when converting
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       COO_DATA *coo_data: the COO_DATA to copy
+*       SMOPS_INDEX non_zero_size: the number of non zero elements stored in coo_data
+*
+*   return:
+*       a pointer to the copy, NULL if an error has occurred and fills err_msg in SMOPS_CTX
+*/
+COO_DATA *COO_copy(SMOPS_CTX *ctx, COO_DATA *coo_data, SMOPS_INDEX non_zero_size)
+{
+    COO_DATA *copy = COO_new(ctx);
+    if(copy == NULL) {return NULL;}
+    size_t n = non_zero_size > 0 ? (size_t)non_zero_size : 1;
+    copy->coords_i = (int *)malloc(sizeof(int)*n);
+    copy->coords_j = (int *)malloc(sizeof(int)*n);
+    copy->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*n);
+    if(copy->coords_i == NULL || copy->coords_j == NULL || copy->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for COO_DATA copy");
+        COO_free(copy);
+        return NULL;
+    }
+    if(non_zero_size > 0) {
+        memcpy(copy->coords_i, coo_data->coords_i, sizeof(int)*non_zero_size);
+        memcpy(copy->coords_j, coo_data->coords_j, sizeof(int)*non_zero_size);
+        memcpy(copy->values, coo_data->values, sizeof(MATRIX_DATA)*non_zero_size);
+    }
+    return copy;
+}
+
 /** Frees the CSR_DATA associated with the matrix
 *
 *   parameters:
@@ -124,7 +446,11 @@ void CSR_free(CSR_DATA *csr_data)
 {
     if(csr_data->nnz != NULL) free(csr_data->nnz);
     if(csr_data->ia != NULL) free(csr_data->ia);
+    if(csr_data->ia32 != NULL) free(csr_data->ia32);
     if(csr_data->ja != NULL) free(csr_data->ja);
+    if(csr_data->ja16 != NULL) free(csr_data->ja16);
+    if(csr_data->packed.data != NULL) free(csr_data->packed.data);
+    if(csr_data->packed.dict != NULL) free(csr_data->packed.dict);
     free(csr_data);
 }
 
@@ -137,123 +463,566 @@ void CSC_free(CSC_DATA *csc_data)
 {
     if(csc_data->nnz != NULL) free(csc_data->nnz);
     if(csc_data->ia != NULL) free(csc_data->ia);
+    if(csc_data->ia32 != NULL) free(csc_data->ia32);
     if(csc_data->ja != NULL) free(csc_data->ja);
+    if(csc_data->ja16 != NULL) free(csc_data->ja16);
     free(csc_data);
 }
 
-/** Swaps the position of an element at index a with index b in the COO_DATA
+/** Frees the DENSE_DATA associated with the matrix
 *
 *   parameters:
-*       COO_DATA *coo_data: the COO_DATA where the elements are swapped around.
-*       int a: the index of the element to be swapped with the element at index b
-*       int b: the index of the element to be swapped with the element at index a
+*       DENSE_DATA *dense_data: a pointer to the DENSE_DATA to be freed
 */
-void coo_swap_data(COO_DATA *coo_data, int a, int b)
+void DENSE_free(DENSE_DATA *dense_data)
 {
-    int temp_ai, temp_aj;
-    MATRIX_DATA temp_av;
+    if(dense_data->values != NULL) free(dense_data->values);
+    free(dense_data);
+}
 
-    temp_ai = coo_data->coords_i[a];
-    temp_aj = coo_data->coords_j[a];
-    temp_av = coo_data->values[a];
+/** Frees the ELL_DATA associated with the matrix
+*
+*   parameters:
+*       ELL_DATA *ell_data: a pointer to the ELL_DATA to be freed
+*/
+void ELL_free(ELL_DATA *ell_data)
+{
+    if(ell_data->nnz != NULL) free(ell_data->nnz);
+    if(ell_data->ja != NULL) free(ell_data->ja);
+    free(ell_data);
+}
 
-    coo_data->coords_i[a] = coo_data->coords_i[b];
-    coo_data->coords_j[a] = coo_data->coords_j[b];
-    coo_data->values[a] = coo_data->values[b];
+/** Frees the SELL_DATA associated with the matrix
+*
+*   parameters:
+*       SELL_DATA *sell_data: a pointer to the SELL_DATA to be freed
+*/
+void SELL_free(SELL_DATA *sell_data)
+{
+    if(sell_data->nnz != NULL) free(sell_data->nnz);
+    if(sell_data->ja != NULL) free(sell_data->ja);
+    if(sell_data->cs != NULL) free(sell_data->cs);
+    if(sell_data->cl != NULL) free(sell_data->cl);
+    if(sell_data->perm != NULL) free(sell_data->perm);
+    free(sell_data);
+}
 
-    coo_data->coords_i[b] = temp_ai;
-    coo_data->coords_j[b] = temp_aj;
-    coo_data->values[b] = temp_av;
+/** Frees the BCSR_DATA associated with the matrix
+*
+*   parameters:
+*       BCSR_DATA *bcsr_data: a pointer to the BCSR_DATA to be freed
+*/
+void BCSR_free(BCSR_DATA *bcsr_data)
+{
+    if(bcsr_data->nnz != NULL) free(bcsr_data->nnz);
+    if(bcsr_data->ia != NULL) free(bcsr_data->ia);
+    if(bcsr_data->ja != NULL) free(bcsr_data->ja);
+    free(bcsr_data);
 }
 
-/** The partition routine used by coo_quicksort.
+/** Frees the DIA_DATA associated with the matrix
 *
 *   parameters:
-*       COO_DATA *coo_data: the COO_DATA to be sorted
-*       int *sort: the array to sort by
-*       int p: lower bound of the quicksort
-*       int q: upper bound of the quicksort
+*       DIA_DATA *dia_data: a pointer to the DIA_DATA to be freed
+*/
+void DIA_free(DIA_DATA *dia_data)
+{
+    if(dia_data->values != NULL) free(dia_data->values);
+    if(dia_data->offsets != NULL) free(dia_data->offsets);
+    if(dia_data->start != NULL) free(dia_data->start);
+    free(dia_data);
+}
+
+/** Frees the DCSR_DATA associated with the matrix
+*
+*   parameters:
+*       DCSR_DATA *dcsr_data: a pointer to the DCSR_DATA to be freed
+*/
+void DCSR_free(DCSR_DATA *dcsr_data)
+{
+    if(dcsr_data->nnz != NULL) free(dcsr_data->nnz);
+    if(dcsr_data->ia != NULL) free(dcsr_data->ia);
+    if(dcsr_data->ja != NULL) free(dcsr_data->ja);
+    if(dcsr_data->row_ids != NULL) free(dcsr_data->row_ids);
+    free(dcsr_data);
+}
+
+/** Frees the CSB_DATA associated with the matrix
+*
+*   parameters:
+*       CSB_DATA *csb_data: a pointer to the CSB_DATA to be freed
+*/
+void CSB_free(CSB_DATA *csb_data)
+{
+    if(csb_data->values != NULL) free(csb_data->values);
+    if(csb_data->lo_i != NULL) free(csb_data->lo_i);
+    if(csb_data->lo_j != NULL) free(csb_data->lo_j);
+    if(csb_data->blk_ptr != NULL) free(csb_data->blk_ptr);
+    free(csb_data);
+}
+
+/** Frees the BITMAP_DATA associated with the matrix
+*
+*   parameters:
+*       BITMAP_DATA *bitmap_data: a pointer to the BITMAP_DATA to be freed
+*/
+void BITMAP_free(BITMAP_DATA *bitmap_data)
+{
+    if(bitmap_data->values != NULL) free(bitmap_data->values);
+    if(bitmap_data->masks != NULL) free(bitmap_data->masks);
+    if(bitmap_data->ia != NULL) free(bitmap_data->ia);
+    if(bitmap_data->ja != NULL) free(bitmap_data->ja);
+    if(bitmap_data->val_ptr != NULL) free(bitmap_data->val_ptr);
+    free(bitmap_data);
+}
+
+/** Frees the CSRDU_DATA associated with the matrix
+*
+*   parameters:
+*       CSRDU_DATA *csrdu_data: a pointer to the CSRDU_DATA to be freed
+*/
+void CSRDU_free(CSRDU_DATA *csrdu_data)
+{
+    if(csrdu_data->nnz != NULL) free(csrdu_data->nnz);
+    if(csrdu_data->ja != NULL) free(csrdu_data->ja);
+    if(csrdu_data->ia != NULL) free(csrdu_data->ia);
+    if(csrdu_data->ja_ptr != NULL) free(csrdu_data->ja_ptr);
+    free(csrdu_data);
+}
+
+/** Arguments of the tasks of COO_bucket
+*   keys: the key of every element
+*   non_zero_size: the number of elements
+*   n: the number of keys
+*   parts: the number of parts the elements are cut into
+*   counts: n counters for every part, the elements of a key in the part and
+*           then the position of the next one
+*   dest: the position of every element
+*/
+struct coo_bucket_args {
+    int *keys;
+    SMOPS_INDEX non_zero_size;
+    int n;
+    int parts;
+    SMOPS_INDEX *counts;
+    SMOPS_INDEX *dest;
+};
+
+/** Counts the elements of every key in the parts p to q
+*
+*   parameters:
+*       void *arg: the struct coo_bucket_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void coo_count_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct coo_bucket_args *a = (struct coo_bucket_args *)arg;
+    SMOPS_INDEX *count, last;
+    for(SMOPS_INDEX part = p; part < q; part++) {
+        count = a->counts + part*a->n;
+        last = a->non_zero_size*(part + 1)/a->parts;
+        for(SMOPS_INDEX i = a->non_zero_size*part/a->parts; i < last; i++) {
+            count[a->keys[i]]++;
+        }
+    }
+}
+
+/** Gives every element of the parts p to q its position, the next one of its key
+*
+*   parameters:
+*       void *arg: the struct coo_bucket_args
+*       SMOPS_INDEX p: the first part
+*       SMOPS_INDEX q: the part after the last part
+*       int worker: unused
+*/
+void coo_place_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct coo_bucket_args *a = (struct coo_bucket_args *)arg;
+    SMOPS_INDEX *next, last;
+    for(SMOPS_INDEX part = p; part < q; part++) {
+        next = a->counts + part*a->n;
+        last = a->non_zero_size*(part + 1)/a->parts;
+        for(SMOPS_INDEX i = a->non_zero_size*part/a->parts; i < last; i++) {
+            a->dest[i] = next[a->keys[i]]++;
+        }
+    }
+}
+
+/** Works out where every element goes when the elements are grouped by key,
+*   keeping their order within a key (a stable counting sort). The elements are
+*   cut into a part per thread of the phase, each counting its keys, so the
+*   positions do not depend on the threads. Parts are only used while their
+*   counters take less memory than the elements.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the thread pool and for error handling
+*       int *keys: the key of every element, 0 to n - 1
+*       SMOPS_INDEX non_zero_size: the number of elements
+*       int n: the number of keys
+*       SMOPS_INDEX *offsets: where the first position of every key and the
+*                             number of elements are stored, n + 1 entries, may be NULL
 *
 *   return:
-*       the index of where the temp value has been sorted too
+*       the position of every element freed by the caller, NULL if it could not
+*       be allocated filling error message
 */
-int coo_quicksort_partition(COO_DATA *coo_data, int *sort, int p, int q)
+SMOPS_INDEX *COO_bucket(SMOPS_CTX *ctx, int *keys, SMOPS_INDEX non_zero_size, int n, SMOPS_INDEX *offsets)
 {
-    int temp = sort[q];
-    int pivot = p-1;
+    int parts = ctx->phase.threads;
+    if(parts < 1 || (SMOPS_INDEX)parts*n > non_zero_size) {parts = 1;}
+    SMOPS_INDEX *dest = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(non_zero_size > 0 ? non_zero_size : 1));
+    SMOPS_INDEX *counts = (SMOPS_INDEX *)calloc((size_t)parts*(n > 0 ? n : 1), sizeof(SMOPS_INDEX));
+    if(dest == NULL || counts == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to sort the elements");
+        free(dest);
+        free(counts);
+        return NULL;
+    }
 
-    for(int i = p; i <= q - 1; i++) {
-        if(sort[i] <= temp) {
-            pivot++;
-            coo_swap_data(coo_data, pivot, i);
+    struct coo_bucket_args args = { keys, non_zero_size, n, parts, counts, dest };
+    POOL_parallel_for(ctx, parts, 1, coo_count_task, &args);
+    SMOPS_INDEX pos = 0, count;
+    for(int key = 0; key < n; key++) {
+        if(offsets != NULL) {offsets[key] = pos;}
+        for(int part = 0; part < parts; part++) {
+            count = counts[(SMOPS_INDEX)part*n + key];
+            counts[(SMOPS_INDEX)part*n + key] = pos;
+            pos += count;
         }
     }
-    coo_swap_data(coo_data, pivot+1, q);
-    return pivot+1;
+    if(offsets != NULL) {offsets[n] = pos;}
+    POOL_parallel_for(ctx, parts, 1, coo_place_task, &args);
+    free(counts);
+    return dest;
 }
 
-/** Quicksorts the COO_DATA
+/** Arguments of coo_scatter_task */
+struct coo_scatter_args {
+    COO_DATA *from;
+    COO_DATA *to;
+    SMOPS_INDEX *dest;
+};
+
+/** Moves the elements p to q of a COO_DATA to their positions in another
 *
 *   parameters:
-*       COO_DATA *coo_data: the COO_DATA to be sorted
-*       int *sort: the array to sort by
-*       int p: lower bound of the quicksort
-*       int q: upper bound of the quicksort
+*       void *arg: the struct coo_scatter_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: unused
+*/
+void coo_scatter_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct coo_scatter_args *a = (struct coo_scatter_args *)arg;
+    SMOPS_INDEX d;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        d = a->dest[i];
+        a->to->coords_i[d] = a->from->coords_i[i];
+        a->to->coords_j[d] = a->from->coords_j[i];
+        a->to->values[d] = a->from->values[i];
+    }
+}
+
+/** Checks how far the elements already are in order of array_a then array_b
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       int *array_a: the array sorted by first
+*       int *array_b: the array sorted by for the same elements in array_a
+*       SMOPS_INDEX non_zero_size: the number of elements
+*       int n: the number of values in array_a
+*
+*   return:
+*       2 if the elements are in order, 1 if only the elements of every value of
+*       array_a are in order of array_b, 0 if neither, -1 if an error occurred
+*       filling error message
 */
-void coo_quicksort(COO_DATA *coo_data, int *sort, int p, int q)
+int COO_sorted(SMOPS_CTX *ctx, int *array_a, int *array_b, SMOPS_INDEX non_zero_size, int n)
 {
-    if(p < q) {
-        int part = coo_quicksort_partition(coo_data, sort, p, q);
-        coo_quicksort(coo_data, sort, p, part - 1);
-        coo_quicksort(coo_data, sort, part + 1, q);
+    SMOPS_INDEX i;
+    for(i = 1; i < non_zero_size; i++) {
+        if(array_a[i-1] > array_a[i] || (array_a[i-1] == array_a[i] && array_b[i-1] > array_b[i])) {break;}
+    }
+    if(i >= non_zero_size) {return 2;}
+
+    int *last = (int *)malloc(sizeof(int)*(n > 0 ? n : 1));
+    if(last == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to sort the elements");
+        return -1;
     }
+    for(int k = 0; k < n; k++) {
+        last[k] = -1;
+    }
+    for(i = 0; i < non_zero_size; i++) {
+        if(array_b[i] < last[array_a[i]]) {break;}
+        last[array_a[i]] = array_b[i];
+    }
+    free(last);
+    return i >= non_zero_size;
 }
 
-/** Sorts the COO_DATA by first sorting by array_a then sorting array_b for same
-*   elements in array_a.
+/** Sorts the COO_DATA by array_b and then by array_a with stable counting
+*   sorts, so it ends up in order of array_a then array_b in linear time. The
+*   pass by array_b is skipped when the elements of every value of array_a are
+*   already in its order, as for the row major elements of a parsed file.
 *
 *   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the thread pool and for error handling
 *       COO_DATA *coo_data: the COO_DATA to be sorted
-*       int *array_a: the array to be used first to sort
-*       int *array_b: the array to be used to sort the second time
-*       int non_zero_size: the number of non zero elements stored in COO_DATA
+*       int by_col: 1 to sort by coords_j then coords_i, 0 for coords_i then coords_j
+*       SMOPS_INDEX non_zero_size: the number of non zero elements stored in COO_DATA
+*       int rows: the number of rows of the matrix
+*       int cols: the number of cols of the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
 */
-void coo_sort_order(COO_DATA *coo_data, int *array_a, int *array_b, int non_zero_size)
+int coo_sort_order(SMOPS_CTX *ctx, COO_DATA *coo_data, int by_col, SMOPS_INDEX non_zero_size, int rows, int cols)
 {
-    coo_quicksort(coo_data, array_a, 0, non_zero_size - 1);
+    int sorted = by_col ? COO_sorted(ctx, coo_data->coords_j, coo_data->coords_i, non_zero_size, cols)
+        : COO_sorted(ctx, coo_data->coords_i, coo_data->coords_j, non_zero_size, rows);
+    if(sorted < 0 || sorted == 2) {return sorted > 0;}
 
-    int p = 0;
-    int q = 0;
+    COO_DATA *temp = COO_new(ctx);
+    if(temp == NULL) {return 0;}
+    size_t n = non_zero_size > 0 ? (size_t)non_zero_size : 1;
+    temp->coords_i = (int *)malloc(sizeof(int)*n);
+    temp->coords_j = (int *)malloc(sizeof(int)*n);
+    temp->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*n);
+    if(temp->coords_i == NULL || temp->coords_j == NULL || temp->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to sort the elements");
+        COO_free(temp);
+        return 0;
+    }
 
-    for(int i=1; i < non_zero_size; i++) {
-        if(array_a[i-1] != array_a[i]) {
-            coo_quicksort(coo_data, array_b, p, q);
-            p = i;
-            q = i;
+    COO_DATA swap;
+    SMOPS_INDEX *dest;
+    struct coo_scatter_args args = { coo_data, temp, NULL };
+    for(int pass = sorted; pass < 2; pass++) {
+        //The first pass orders by the minor coordinate, the second by the major one
+        if(pass == 0) {
+            dest = by_col ? COO_bucket(ctx, coo_data->coords_i, non_zero_size, rows, NULL)
+                : COO_bucket(ctx, coo_data->coords_j, non_zero_size, cols, NULL);
         } else {
-            q++;
+            dest = by_col ? COO_bucket(ctx, coo_data->coords_j, non_zero_size, cols, NULL)
+                : COO_bucket(ctx, coo_data->coords_i, non_zero_size, rows, NULL);
+        }
+        if(dest == NULL) {
+            COO_free(temp);
+            return 0;
         }
+        args.dest = dest;
+        POOL_parallel_for(ctx, non_zero_size, 0, coo_scatter_task, &args);
+        free(dest);
+        swap = *coo_data;
+        *coo_data = *temp;
+        *temp = swap;
     }
+    COO_free(temp);
+    return 1;
 }
 
 /** Sort the COO data structure in row major order
 *
 *   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the thread pool and for error handling
 *       COO_DATA *coo_data: the COO_DATA to be sorted
-*       int non_zero_size: the number of non zero elements stored in COO_DATA
+*       SMOPS_INDEX non_zero_size: the number of non zero elements stored in COO_DATA
+*       int rows: the number of rows of the matrix
+*       int cols: the number of cols of the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
 */
-void COO_sort_row_order(COO_DATA *coo_data, int non_zero_size)
+int COO_sort_row_order(SMOPS_CTX *ctx, COO_DATA *coo_data, SMOPS_INDEX non_zero_size, int rows, int cols)
 {
-    coo_sort_order(coo_data, coo_data->coords_i, coo_data->coords_j, non_zero_size);
+    return coo_sort_order(ctx, coo_data, 0, non_zero_size, rows, cols);
 }
 
 /** Sort the COO data structure in column major order
 *
 *   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the thread pool and for error handling
 *       COO_DATA *coo_data: the COO_DATA to be sorted
-*       int non_zero_size: the number of non zero elements stored in COO_DATA
+*       SMOPS_INDEX non_zero_size: the number of non zero elements stored in COO_DATA
+*       int rows: the number of rows of the matrix
+*       int cols: the number of cols of the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
 */
-void COO_sort_col_order(COO_DATA *coo_data, int non_zero_size)
+int COO_sort_col_order(SMOPS_CTX *ctx, COO_DATA *coo_data, SMOPS_INDEX non_zero_size, int rows, int cols)
 {
-    coo_sort_order(coo_data, coo_data->coords_j, coo_data->coords_i, non_zero_size);
+    return coo_sort_order(ctx, coo_data, 1, non_zero_size, rows, cols);
+}
+
+/** Gets the bits identifying a value, an int value is only its int member as
+*   the rest of the MATRIX_DATA is not set
+*
+*   parameters:
+*       MATRIX_DATA value: the value
+*       TYPE type: the type of the value
+*
+*   return:
+*       the bits of the value
+*/
+static inline uint64_t values_key(MATRIX_DATA value, TYPE type)
+{
+    uint64_t key;
+    if(type == INT) {return (uint64_t)(uint32_t)value.i;}
+    memcpy(&key, &value.f, sizeof(uint64_t));
+    return key;
+}
+
+/** Collects the distinct values of a matrix into a dictionary with an open
+*   addressing hash table, stopping as soon as there are more than VALUES_DICT_MAX.
+*   Values are compared by their bits so the dictionary gives back every value exactly.
+*
+*   parameters:
+*       MATRIX_DATA *values: the values
+*       SMOPS_INDEX n: the number of values
+*       TYPE type: the type of the values
+*       MATRIX_DATA *dict: where the distinct values are stored in the order they
+*                          are first seen, VALUES_DICT_MAX entries
+*       uint8_t *idx: where the index in dict of every value is stored, NULL if
+*                     only the distinct values are wanted
+*
+*   return:
+*       the number of distinct values, VALUES_DICT_MAX + 1 if there are more
+*/
+int VALUES_dictionary(MATRIX_DATA *values, SMOPS_INDEX n, TYPE type, MATRIX_DATA *dict, uint8_t *idx)
+{
+    uint64_t keys[1 << VALUES_HASH_BITS];
+    int slots[1 << VALUES_HASH_BITS];
+    uint64_t key;
+    int distinct = 0;
+    unsigned h;
+    for(h = 0; h < (1 << VALUES_HASH_BITS); h++) {
+        slots[h] = -1;
+    }
+    for(SMOPS_INDEX i = 0; i < n; i++) {
+        key = values_key(values[i], type);
+        h = (unsigned)((key*VALUES_HASH_MULT) >> (64 - VALUES_HASH_BITS));
+        while(slots[h] >= 0 && keys[h] != key) {
+            h = (h + 1) & ((1 << VALUES_HASH_BITS) - 1);
+        }
+        if(slots[h] < 0) {
+            if(distinct == VALUES_DICT_MAX) {return VALUES_DICT_MAX + 1;}
+            keys[h] = key;
+            slots[h] = distinct;
+            dict[distinct++] = values[i];
+        }
+        if(idx != NULL) {
+            idx[i] = (uint8_t)slots[h];
+        }
+    }
+    return distinct;
+}
+
+/** Packs the values of a CSR_DATA with the coding chosen by the planner and
+*   frees the full values
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       CSR_DATA *csr_data: the CSR_DATA with its values in nnz
+*       SMOPS_INDEX n: the number of values
+*       TYPE type: the type of the values
+*       VALUE_CODING coding: how to pack the values, must fit all of them
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int VALUES_pack(SMOPS_CTX *ctx, CSR_DATA *csr_data, SMOPS_INDEX n, TYPE type, VALUE_CODING coding)
+{
+    PACKED_VALUES *packed = &csr_data->packed;
+    size_t width = coding == VALUES_INT16 ? sizeof(int16_t) : sizeof(uint8_t);
+    if(coding == VALUES_FULL) {return 1;}
+
+    packed->data = malloc(width*(n > 0 ? n : 1));
+    if(coding == VALUES_DICT) {
+        packed->dict = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*VALUES_DICT_MAX);
+    }
+    if(packed->data == NULL || (coding == VALUES_DICT && packed->dict == NULL)) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for packed values for matrix");
+        return 0;
+    }
+
+    SMOPS_INDEX i;
+    switch(coding) {
+        case VALUES_INT8:
+            for(i = 0; i < n; i++) {
+                ((int8_t *)packed->data)[i] = (int8_t)csr_data->nnz[i].i;
+            }
+            break;
+        case VALUES_INT16:
+            for(i = 0; i < n; i++) {
+                ((int16_t *)packed->data)[i] = (int16_t)csr_data->nnz[i].i;
+            }
+            break;
+        default:
+            packed->dict_size = VALUES_dictionary(csr_data->nnz, n, type, packed->dict, (uint8_t *)packed->data);
+            if(packed->dict_size > VALUES_DICT_MAX) {
+                SMOPS_CTX_fill_err_msg(ctx, "too many distinct values to pack into a dictionary");
+                return 0;
+            }
+            break;
+    }
+    packed->coding = coding;
+    free(csr_data->nnz);
+    csr_data->nnz = NULL;
+    return 1;
+}
+
+/** Stores the columns of a CSR_DATA in 16 bits and frees the int columns, the
+*   matrix must have at most UINT16_MAX + 1 columns
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       CSR_DATA *csr_data: the CSR_DATA with its columns in ja
+*       SMOPS_INDEX n: the number of non zero elements
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int CSR_narrow_columns(SMOPS_CTX *ctx, CSR_DATA *csr_data, SMOPS_INDEX n)
+{
+    csr_data->ja16 = (uint16_t *)malloc(sizeof(uint16_t)*(n > 0 ? n : 1));
+    if(csr_data->ja16 == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for 16 bit csr columns for matrix");
+        return 0;
+    }
+    for(SMOPS_INDEX i = 0; i < n; i++) {
+        csr_data->ja16[i] = (uint16_t)csr_data->ja[i];
+    }
+    free(csr_data->ja);
+    csr_data->ja = NULL;
+    return 1;
+}
+
+/** Stores the offsets of a CSR_DATA (or CSC_DATA) in 32 bits and frees the wide
+*   offsets, the matrix must have at most INT32_MAX non zero elements
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       CSR_DATA *csr_data: the CSR_DATA with its offsets in ia
+*       int rows: the number of rows (columns of a CSC_DATA)
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int CSR_narrow_offsets(SMOPS_CTX *ctx, CSR_DATA *csr_data, int rows)
+{
+    csr_data->ia32 = (int32_t *)malloc(sizeof(int32_t)*(rows + 1));
+    if(csr_data->ia32 == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for 32 bit csr offsets for matrix");
+        return 0;
+    }
+    for(int r = 0; r <= rows; r++) {
+        csr_data->ia32[r] = (int32_t)csr_data->ia[r];
+    }
+    free(csr_data->ia);
+    csr_data->ia = NULL;
+    return 1;
 }
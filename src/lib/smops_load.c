@@ -3,8 +3,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <omp.h>
 #include <time.h>
+#include <sys/stat.h>
 
 #include "smops.h"
 
@@ -13,6 +13,8 @@
 #define INT_STR "int\0"
 #define READSPECLINE if(fgets(buffer, BUFFER_SIZE, file) == NULL)
 #define DATA_CHUNK_SIZE 1000
+#define LOAD_COMPARE_CHUNK 16384 //bytes of each file compared at a time when looking for identical inputs
+#define LOAD_PAIR_SKEW 8 //a matrix this many times larger than the other is loaded by the whole team
 
 /** Gets the data type from the string and puts it into the MATRIX data structure
 *
@@ -39,52 +41,74 @@ TYPE get_type(SMOPS_CTX *ctx, MATRIX *matrix, char *str) {
     return UNDEFINED;
 }
 
-/** Converts from COO format to CSR or CSC format
+/** Arguments of convert_coo_task */
+struct convert_coo_args {
+    MATRIX_DATA *nnz;
+    int *ja;
+    MATRIX_DATA *values;
+    int *array_b;
+    SMOPS_INDEX *dest;
+};
+
+/** Copies the elements p to q of the COO format to their positions in nnz and ja
+*
+*   parameters:
+*       void *arg: the struct convert_coo_args
+*       SMOPS_INDEX p: the first element
+*       SMOPS_INDEX q: the element after the last element
+*       int worker: unused
+*/
+void convert_coo_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct convert_coo_args *a = (struct convert_coo_args *)arg;
+    SMOPS_INDEX d;
+    for(SMOPS_INDEX i = p; i < q; i++) {
+        d = a->dest[i];
+        a->nnz[d] = a->values[i];
+        a->ja[d] = a->array_b[i];
+    }
+}
+
+/** Converts from COO format to CSR or CSC format by grouping the elements by
+*   row (CSR) or column (CSC) straight into the arrays, the COO format is only
+*   sorted first if the elements of a row or column are out of order
 *
 *   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the thread pool and for error handling
 *       MATRIX_DATA *nnz: the nnz array for CSR and CSC format
-*       int *ia: the ia array for the CSR and CSC format
+*       SMOPS_INDEX *ia: the ia array for the CSR and CSC format
 *       int *ja: the ja array for the CSR and CSC format
-*       MATRIX_DATA *values: the values from COO format that will go into the nnz array
-*       int *array_a: either coords_i or coords_j from COO format,
-*                     depending on converting to CSR or CSC format
-*       int non_zero_size: number of non zero elements in the matrix
-*       int n: either number of rows or cols depending converting to CSR or CSC format
-*       int thread_num: number of threads should be used
-*/
-void convert_coo(MATRIX_DATA *nnz, int *ia, int *ja, MATRIX_DATA *values,
-    int *array_a, int *array_b, int non_zero_size, int n, int thread_num)
-{
-    int i;
-    switch(thread_num) {
-        case 1:
-            for(i = 0; i < non_zero_size; i++) {
-                nnz[i] = values[i];
-                ja[i] = array_b[i];
-                ia[array_a[i] + 1] += 1;
-            }
-            break;
-        default:
-            #pragma omp parallel num_threads(thread_num) private(i)
-            {
-                #pragma omp for
-                for(i = 0; i < non_zero_size; i++) {
-                    nnz[i] = values[i];
-                    ja[i] = array_b[i];
-                    #pragma omp atomic
-                    ia[array_a[i] + 1] += 1;
-                }
-            }
-            break;
-    }
+*       COO_DATA *coo_data: the COO format
+*       int by_col: 1 to convert to CSC format, 0 for CSR format
+*       SMOPS_INDEX non_zero_size: number of non zero elements in the matrix
+*       int rows: the number of rows in the matrix
+*       int cols: the number of cols in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int convert_coo(SMOPS_CTX *ctx, MATRIX_DATA *nnz, SMOPS_INDEX *ia, int *ja, COO_DATA *coo_data,
+    int by_col, SMOPS_INDEX non_zero_size, int rows, int cols)
+{
+    int n = by_col ? cols : rows;
+    int sorted = by_col ? COO_sorted(ctx, coo_data->coords_j, coo_data->coords_i, non_zero_size, n)
+        : COO_sorted(ctx, coo_data->coords_i, coo_data->coords_j, non_zero_size, n);
+    if(sorted < 0) {return 0;}
+    if(sorted == 0 && (by_col ? COO_sort_col_order(ctx, coo_data, non_zero_size, rows, cols)
+        : COO_sort_row_order(ctx, coo_data, non_zero_size, rows, cols)) == 0) {return 0;}
 
-    for(int i = 1; i < n + 1; i++)
-    {
-        ia[i] += ia[i-1];
-    }
+    int *array_a = by_col ? coo_data->coords_j : coo_data->coords_i;
+    int *array_b = by_col ? coo_data->coords_i : coo_data->coords_j;
+    SMOPS_INDEX *dest = COO_bucket(ctx, array_a, non_zero_size, n, ia);
+    if(dest == NULL) {return 0;}
+    struct convert_coo_args args = { nnz, ja, coo_data->values, array_b, dest };
+    POOL_parallel_for(ctx, non_zero_size, 0, convert_coo_task, &args);
+    free(dest);
+    return 1;
 }
 
-/** Converts COO format to CSC format for a matrix
+/** Converts COO format to CSC format for a matrix, storing the offsets in 32
+*   bits and the rows in 16 bits if the planner chose to
 *
 *   parameters:
 *       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
@@ -95,7 +119,7 @@ void convert_coo(MATRIX_DATA *nnz, int *ia, int *ja, MATRIX_DATA *values,
 */
 int coo_to_csc(SMOPS_CTX *ctx, MATRIX *matrix)
 {
-    int non_zero_size = matrix->non_zero_size;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
     int cols = matrix->cols;
     COO_DATA *coo_data = matrix->coo_data;
     CSC_DATA *csc_data = matrix->csc_data;
@@ -109,7 +133,7 @@ int coo_to_csc(SMOPS_CTX *ctx, MATRIX *matrix)
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csc data for matrix");
         return 0;
     }
-    csc_data->ia = (int *)calloc(cols + 1, sizeof(int));
+    csc_data->ia = (SMOPS_INDEX *)calloc(cols + 1, sizeof(SMOPS_INDEX));
     if(csc_data->ia == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csc data for matrix");
         return 0;
@@ -120,55 +144,1019 @@ int coo_to_csc(SMOPS_CTX *ctx, MATRIX *matrix)
         return 0;
     }
 
-    COO_sort_col_order(coo_data, matrix->non_zero_size);
-
-    convert_coo(csc_data->nnz, csc_data->ia, csc_data->ja, coo_data->values,
-        coo_data->coords_j, coo_data->coords_i, non_zero_size, cols, ctx->thread_num);
-
-    return 1;
+    if(convert_coo(ctx, csc_data->nnz, csc_data->ia, csc_data->ja, coo_data, 1,
+        non_zero_size, matrix->rows, cols) == 0) {return 0;}
+
+    if(matrix->stats.ia32 && CSR_narrow_offsets(ctx, csc_data, cols) == 0) {return 0;}
+    if(matrix->stats.ja16) {return CSR_narrow_columns(ctx, csc_data, non_zero_size);}
+    return 1;
+}
+
+/** Converts a CSR matrix to CSC format without sorting. The elements of every
+*   column are counted, and the rows are walked in order so the rows of every
+*   column come out in order.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       CSC_DATA *csc_data: the CSC_DATA to fill
+*       CSR_DATA *csr_data: the CSR_DATA with full values, its offsets and columns in either width
+*       int rows: the number of rows in the matrix
+*       int cols: the number of cols in the matrix
+*       SMOPS_INDEX non_zero_size: the number of non zero elements in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int csr_to_csc(SMOPS_CTX *ctx, CSC_DATA *csc_data, CSR_DATA *csr_data, int rows, int cols,
+    SMOPS_INDEX non_zero_size)
+{
+    csc_data->nnz = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*non_zero_size);
+    csc_data->ia = (SMOPS_INDEX *)calloc(cols + 1, sizeof(SMOPS_INDEX));
+    csc_data->ja = (int *)malloc(sizeof(int)*non_zero_size);
+    SMOPS_INDEX *next = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(cols + 1));
+    if(csc_data->nnz == NULL || csc_data->ia == NULL || csc_data->ja == NULL || next == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csc data for matrix");
+        free(next);
+        return 0;
+    }
+
+    for(SMOPS_INDEX i = 0; i < non_zero_size; i++) {
+        csc_data->ia[CSR_COL(csr_data, i) + 1]++;
+    }
+    for(int c = 1; c < cols + 1; c++) {
+        csc_data->ia[c] += csc_data->ia[c-1];
+    }
+    memcpy(next, csc_data->ia, sizeof(SMOPS_INDEX)*(cols + 1));
+
+    SMOPS_INDEX pos;
+    for(int r = 0; r < rows; r++) {
+        for(SMOPS_INDEX i = CSR_ROW(csr_data, r); i < CSR_ROW(csr_data, r+1); i++) {
+            pos = next[CSR_COL(csr_data, i)]++;
+            csc_data->ja[pos] = r;
+            csc_data->nnz[pos] = csr_data->nnz[i];
+        }
+    }
+    free(next);
+    return 1;
+}
+
+/** Converts COO format to CSR format for a matrix, storing the offsets in 32
+*   bits, the columns in 16 bits and packing the values if the planner chose to
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the CSR format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_csr(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    int rows = matrix->rows;
+    COO_DATA *coo_data = matrix->coo_data;
+    CSR_DATA *csr_data = matrix->csr_data;
+
+    if(csr_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "csr memory has not been set for matrix (CSR format not set)");
+        return 0;
+    }
+    csr_data->nnz = (MATRIX_DATA *)calloc(non_zero_size, sizeof(MATRIX_DATA));
+    if(csr_data->nnz == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+        return 0;
+    }
+    csr_data->ia = (SMOPS_INDEX *)calloc(rows + 1, sizeof(SMOPS_INDEX));
+    if(csr_data->ia == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+        return 0;
+    }
+    csr_data->ja = (int *)malloc(sizeof(int)*non_zero_size);
+    if(csr_data->ja == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+        return 0;
+    }
+
+    if(convert_coo(ctx, csr_data->nnz, csr_data->ia, csr_data->ja, coo_data, 0,
+        non_zero_size, rows, matrix->cols) == 0) {return 0;}
+
+    if(matrix->stats.ia32 && CSR_narrow_offsets(ctx, csr_data, rows) == 0) {return 0;}
+    if(matrix->stats.ja16 && CSR_narrow_columns(ctx, csr_data, non_zero_size) == 0) {return 0;}
+    return VALUES_pack(ctx, csr_data, non_zero_size, matrix->type, matrix->stats.value_coding);
+}
+
+/** Converts COO format to DCSR format for a matrix. The COO_DATA is sorted in
+*   row order and walked once, a new stored row starts wherever the row changes,
+*   so no array has an entry per row of the matrix.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the DCSR format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_dcsr(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    COO_DATA *coo_data = matrix->coo_data;
+    DCSR_DATA *dcsr_data = matrix->dcsr_data;
+
+    if(dcsr_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "dcsr memory has not been set for matrix (DCSR format not set)");
+        return 0;
+    }
+    if(COO_sort_row_order(ctx, coo_data, non_zero_size, matrix->rows, matrix->cols) == 0) {return 0;}
+
+    int nzr = 0;
+    SMOPS_INDEX i;
+    for(i = 0; i < non_zero_size; i++) {
+        if(i == 0 || coo_data->coords_i[i] != coo_data->coords_i[i-1]) {
+            nzr++;
+        }
+    }
+    dcsr_data->nzr = nzr;
+    dcsr_data->nnz = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(non_zero_size > 0 ? non_zero_size : 1));
+    dcsr_data->ja = (int *)malloc(sizeof(int)*(non_zero_size > 0 ? non_zero_size : 1));
+    dcsr_data->ia = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(nzr + 1));
+    dcsr_data->row_ids = (int *)malloc(sizeof(int)*(nzr > 0 ? nzr : 1));
+    if(dcsr_data->nnz == NULL || dcsr_data->ja == NULL || dcsr_data->ia == NULL
+        || dcsr_data->row_ids == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dcsr data for matrix");
+        return 0;
+    }
+
+    int n = -1;
+    for(i = 0; i < non_zero_size; i++) {
+        if(i == 0 || coo_data->coords_i[i] != coo_data->coords_i[i-1]) {
+            n++;
+            dcsr_data->row_ids[n] = coo_data->coords_i[i];
+            dcsr_data->ia[n] = i;
+        }
+        dcsr_data->nnz[i] = coo_data->values[i];
+        dcsr_data->ja[i] = coo_data->coords_j[i];
+    }
+    dcsr_data->ia[nzr] = non_zero_size;
+    return 1;
+}
+
+/** Converts COO format to CSB format for a matrix. The elements are counted per
+*   block, then scattered to their block with their coordinates within it.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the CSB format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_csb(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    COO_DATA *coo_data = matrix->coo_data;
+    CSB_DATA *csb_data = matrix->csb_data;
+
+    if(csb_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "csb memory has not been set for matrix (CSB format not set)");
+        return 0;
+    }
+    if(matrix->stats.csb_beta == 0) {
+        matrix->stats.csb_beta = PLAN_csb_beta(matrix);
+    }
+    int beta = matrix->stats.csb_beta;
+    csb_data->beta = beta;
+    csb_data->block_rows = (matrix->rows + beta - 1)/beta;
+    csb_data->block_cols = (matrix->cols + beta - 1)/beta;
+    size_t blocks = (size_t)csb_data->block_rows*csb_data->block_cols;
+
+    csb_data->blk_ptr = (SMOPS_INDEX *)calloc(blocks + 1, sizeof(SMOPS_INDEX));
+    csb_data->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(non_zero_size > 0 ? non_zero_size : 1));
+    csb_data->lo_i = (uint16_t *)malloc(sizeof(uint16_t)*(non_zero_size > 0 ? non_zero_size : 1));
+    csb_data->lo_j = (uint16_t *)malloc(sizeof(uint16_t)*(non_zero_size > 0 ? non_zero_size : 1));
+    if(csb_data->blk_ptr == NULL || csb_data->values == NULL || csb_data->lo_i == NULL
+        || csb_data->lo_j == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csb data for matrix");
+        return 0;
+    }
+
+    size_t blk;
+    SMOPS_INDEX i, pos;
+    for(i = 0; i < non_zero_size; i++) {
+        blk = (size_t)(coo_data->coords_i[i]/beta)*csb_data->block_cols + coo_data->coords_j[i]/beta;
+        csb_data->blk_ptr[blk + 1]++;
+    }
+    for(blk = 0; blk < blocks; blk++) {
+        csb_data->blk_ptr[blk + 1] += csb_data->blk_ptr[blk];
+    }
+    //Fill every block from its start, then shift the starts back into place
+    for(i = 0; i < non_zero_size; i++) {
+        blk = (size_t)(coo_data->coords_i[i]/beta)*csb_data->block_cols + coo_data->coords_j[i]/beta;
+        pos = csb_data->blk_ptr[blk]++;
+        csb_data->values[pos] = coo_data->values[i];
+        csb_data->lo_i[pos] = (uint16_t)(coo_data->coords_i[i] % beta);
+        csb_data->lo_j[pos] = (uint16_t)(coo_data->coords_j[i] % beta);
+    }
+    for(blk = blocks; blk > 0; blk--) {
+        csb_data->blk_ptr[blk] = csb_data->blk_ptr[blk - 1];
+    }
+    csb_data->blk_ptr[0] = 0;
+    return 1;
+}
+
+/** Converts COO format to a dense row major array for a matrix
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the dense format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_dense(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    if(matrix->dense_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "dense memory has not been set for matrix (DENSE format not set)");
+        return 0;
+    }
+    matrix->dense_data->values = COO_to_dense(ctx, matrix->coo_data, matrix->rows,
+                                                matrix->cols, matrix->non_zero_size);
+    if(matrix->dense_data->values == NULL) {return 0;}
+    return 1;
+}
+
+/** Converts COO format to ELL format for a matrix, padding every row to the
+*   longest row found by the planner scan
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the ELL format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_ell(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    int rows = matrix->rows;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    int width = matrix->stats.row_nnz_max;
+    COO_DATA *coo_data = matrix->coo_data;
+    ELL_DATA *ell_data = matrix->ell_data;
+
+    if(ell_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "ell memory has not been set for matrix (ELL format not set)");
+        return 0;
+    }
+    size_t padded_size = (size_t)width*rows;
+    ell_data->width = width;
+    ell_data->nnz = (MATRIX_DATA *)calloc(padded_size > 0 ? padded_size : 1, sizeof(MATRIX_DATA));
+    if(ell_data->nnz == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for ell data for matrix");
+        return 0;
+    }
+    ell_data->ja = (int *)calloc(padded_size > 0 ? padded_size : 1, sizeof(int));
+    if(ell_data->ja == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for ell data for matrix");
+        return 0;
+    }
+    int *row_fill = (int *)calloc(rows > 0 ? rows : 1, sizeof(int));
+    if(row_fill == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for ell data for matrix");
+        return 0;
+    }
+
+    int r;
+    size_t pos;
+    for(SMOPS_INDEX i = 0; i < non_zero_size; i++) {
+        r = coo_data->coords_i[i];
+        pos = (size_t)row_fill[r]*rows + r;
+        ell_data->nnz[pos] = coo_data->values[i];
+        ell_data->ja[pos] = coo_data->coords_j[i];
+        row_fill[r]++;
+    }
+    free(row_fill);
+    return 1;
+}
+
+/** Row of a SELL window sorted by its length
+*/
+struct sell_row {
+    int len;
+    int row;
+};
+
+/** Orders sell_row by descending length, keeping the row order for equal lengths
+*/
+int sell_row_cmp(const void *a, const void *b)
+{
+    const struct sell_row *x = (const struct sell_row *)a;
+    const struct sell_row *y = (const struct sell_row *)b;
+    if(x->len != y->len) {
+        return y->len - x->len;
+    }
+    return x->row - y->row;
+}
+
+/** Converts a CSR_DATA to SELL-C-sigma. Within every window of SELL_SIGMA rows the
+*   rows are sorted by descending length, then every SELL_C sorted rows form a chunk
+*   padded to its longest row.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       SELL_DATA *sell_data: the SELL_DATA to fill
+*       CSR_DATA *csr_data: the matrix in CSR format
+*       int rows: the number of rows in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int csr_to_sell(SMOPS_CTX *ctx, SELL_DATA *sell_data, CSR_DATA *csr_data, int rows)
+{
+    SMOPS_INDEX *ia = csr_data->ia;
+    int chunks = (rows + SELL_C - 1)/SELL_C;
+    int lanes = chunks*SELL_C;
+    sell_data->chunks = chunks;
+    sell_data->cs = (SMOPS_INDEX *)calloc(chunks + 1, sizeof(SMOPS_INDEX));
+    sell_data->cl = (int *)calloc(chunks > 0 ? chunks : 1, sizeof(int));
+    sell_data->perm = (int *)malloc(sizeof(int)*(lanes > 0 ? lanes : 1));
+    struct sell_row *order = (struct sell_row *)malloc(sizeof(struct sell_row)*(rows > 0 ? rows : 1));
+    if(sell_data->cs == NULL || sell_data->cl == NULL || sell_data->perm == NULL || order == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for sell data for matrix");
+        free(order);
+        return 0;
+    }
+
+    int r;
+    for(r = 0; r < rows; r++) {
+        order[r].len = (int)(ia[r+1] - ia[r]);
+        order[r].row = r;
+    }
+    for(r = 0; r < rows; r += SELL_SIGMA) {
+        qsort(order + r, r + SELL_SIGMA < rows ? SELL_SIGMA : rows - r,
+                sizeof(struct sell_row), sell_row_cmp);
+    }
+    for(int l = 0; l < lanes; l++) {
+        sell_data->perm[l] = l < rows ? order[l].row : -1;
+    }
+
+    int width, lane;
+    for(int k = 0; k < chunks; k++) {
+        width = 0;
+        for(lane = k*SELL_C; lane < (k + 1)*SELL_C && lane < rows; lane++) {
+            if(order[lane].len > width) {
+                width = order[lane].len;
+            }
+        }
+        sell_data->cl[k] = width;
+        sell_data->cs[k+1] = sell_data->cs[k] + (SMOPS_INDEX)width*SELL_C;
+    }
+    free(order);
+
+    SMOPS_INDEX slots = sell_data->cs[chunks];
+    sell_data->nnz = (MATRIX_DATA *)calloc(slots > 0 ? slots : 1, sizeof(MATRIX_DATA));
+    sell_data->ja = (int *)calloc(slots > 0 ? slots : 1, sizeof(int));
+    if(sell_data->nnz == NULL || sell_data->ja == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for sell data for matrix");
+        return 0;
+    }
+
+    int row;
+    SMOPS_INDEX pos;
+    for(int k = 0; k < chunks; k++) {
+        for(int l = 0; l < SELL_C; l++) {
+            row = sell_data->perm[k*SELL_C + l];
+            if(row < 0) {continue;}
+            pos = sell_data->cs[k] + l;
+            for(SMOPS_INDEX i = ia[row]; i < ia[row+1]; i++) {
+                sell_data->nnz[pos] = csr_data->nnz[i];
+                sell_data->ja[pos] = csr_data->ja[i];
+                pos += SELL_C;
+            }
+        }
+    }
+    return 1;
+}
+
+/** Builds a CSR_DATA from the COO_DATA of a matrix for the formats converted from
+*   CSR, the elements are bucketed by row in linear time
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix with the COO_DATA
+*
+*   return:
+*       the CSR_DATA which the caller frees, NULL if an error occurred filling error message
+*/
+CSR_DATA *coo_to_temp_csr(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    int rows = matrix->rows;
+    COO_DATA *coo_data = matrix->coo_data;
+
+    CSR_DATA *csr_data = CSR_new(ctx);
+    if(csr_data == NULL) {return NULL;}
+    csr_data->nnz = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(non_zero_size > 0 ? non_zero_size : 1));
+    csr_data->ia = (SMOPS_INDEX *)calloc(rows + 1, sizeof(SMOPS_INDEX));
+    csr_data->ja = (int *)malloc(sizeof(int)*(non_zero_size > 0 ? non_zero_size : 1));
+    if(csr_data->nnz == NULL || csr_data->ia == NULL || csr_data->ja == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+        CSR_free(csr_data);
+        return NULL;
+    }
+
+    if(convert_coo(ctx, csr_data->nnz, csr_data->ia, csr_data->ja, coo_data, 0,
+        non_zero_size, rows, matrix->cols) == 0) {
+        CSR_free(csr_data);
+        return NULL;
+    }
+    return csr_data;
+}
+
+/** Converts COO format to SELL-C-sigma format for a matrix, going through CSR
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the SELL format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_sell(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    if(matrix->sell_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "sell memory has not been set for matrix (SELL format not set)");
+        return 0;
+    }
+    CSR_DATA *csr_data = coo_to_temp_csr(ctx, matrix);
+    if(csr_data == NULL) {return 0;}
+
+    int ret = csr_to_sell(ctx, matrix->sell_data, csr_data, matrix->rows);
+    CSR_free(csr_data);
+    return ret;
+}
+
+/** Converts a CSR_DATA to BCSR with the block size set in bcsr_data. The blocks
+*   of a block row are counted first with a marker per block column, then the
+*   elements are copied into their block.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       BCSR_DATA *bcsr_data: the BCSR_DATA to fill, block is already set
+*       CSR_DATA *csr_data: the matrix in CSR format
+*       int rows: the number of rows in the matrix
+*       int cols: the number of columns in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int csr_to_bcsr(SMOPS_CTX *ctx, BCSR_DATA *bcsr_data, CSR_DATA *csr_data, int rows, int cols)
+{
+    int block = bcsr_data->block;
+    int block_rows = (rows + block - 1)/block;
+    int block_cols = (cols + block - 1)/block;
+    SMOPS_INDEX *ia = csr_data->ia;
+    int *ja = csr_data->ja;
+    bcsr_data->block_rows = block_rows;
+    bcsr_data->block_cols = block_cols;
+
+    int *mark = (int *)malloc(sizeof(int)*(block_cols > 0 ? block_cols : 1));
+    int *slot = (int *)malloc(sizeof(int)*(block_cols > 0 ? block_cols : 1));
+    bcsr_data->ia = (int *)calloc(block_rows + 1, sizeof(int));
+    if(mark == NULL || slot == NULL || bcsr_data->ia == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for bcsr data for matrix");
+        free(mark);
+        free(slot);
+        return 0;
+    }
+
+    int b_col, r;
+    SMOPS_INDEX i;
+    for(b_col = 0; b_col < block_cols; b_col++) {
+        mark[b_col] = -1;
+    }
+    for(int b_row = 0; b_row < block_rows; b_row++) {
+        bcsr_data->ia[b_row + 1] = bcsr_data->ia[b_row];
+        for(r = b_row*block; r < (b_row + 1)*block && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                b_col = ja[i]/block;
+                if(mark[b_col] != b_row) {
+                    mark[b_col] = b_row;
+                    bcsr_data->ia[b_row + 1]++;
+                }
+            }
+        }
+    }
+
+    int blocks = bcsr_data->ia[block_rows];
+    bcsr_data->blocks = blocks;
+    bcsr_data->ja = (int *)malloc(sizeof(int)*(blocks > 0 ? blocks : 1));
+    bcsr_data->nnz = (MATRIX_DATA *)calloc(blocks > 0 ? (size_t)blocks*block*block : 1, sizeof(MATRIX_DATA));
+    if(bcsr_data->ja == NULL || bcsr_data->nnz == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for bcsr data for matrix");
+        free(mark);
+        free(slot);
+        return 0;
+    }
+
+    int pos;
+    for(b_col = 0; b_col < block_cols; b_col++) {
+        mark[b_col] = -1;
+    }
+    for(int b_row = 0; b_row < block_rows; b_row++) {
+        pos = bcsr_data->ia[b_row];
+        for(r = b_row*block; r < (b_row + 1)*block && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                b_col = ja[i]/block;
+                if(mark[b_col] != b_row) {
+                    mark[b_col] = b_row;
+                    slot[b_col] = pos;
+                    bcsr_data->ja[pos] = b_col;
+                    pos++;
+                }
+                bcsr_data->nnz[((size_t)slot[b_col]*block + r - b_row*block)*block
+                                + ja[i] - b_col*block] = csr_data->nnz[i];
+            }
+        }
+    }
+    free(mark);
+    free(slot);
+    return 1;
+}
+
+/** Converts COO format to BCSR format for a matrix, going through CSR. The block
+*   size is the one chosen by the planner in the stats of the matrix.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the BCSR format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_bcsr(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    int block = matrix->stats.bcsr_block;
+    if(matrix->bcsr_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "bcsr memory has not been set for matrix (BCSR format not set)");
+        return 0;
+    }
+    if(block < BCSR_MIN_BLOCK || block > BCSR_MAX_BLOCK) {
+        SMOPS_CTX_fill_err_msg(ctx, "no supported block size set for the BCSR format");
+        return 0;
+    }
+    CSR_DATA *csr_data = coo_to_temp_csr(ctx, matrix);
+    if(csr_data == NULL) {return 0;}
+
+    matrix->bcsr_data->block = block;
+    int ret = csr_to_bcsr(ctx, matrix->bcsr_data, csr_data, matrix->rows, matrix->cols);
+    CSR_free(csr_data);
+    if(ret == 1 && matrix->non_zero_size > 0) {
+        matrix->stats.bcsr_fill = (double) matrix->bcsr_data->blocks*block*block/matrix->non_zero_size;
+    }
+    return ret;
+}
+
+/** Orders ints in ascending order for qsort
+*
+*   parameters:
+*       const void *a: pointer to the first int
+*       const void *b: pointer to the second int
+*
+*   return:
+*       negative if a comes before b, positive if after, 0 if equal
+*/
+int bitmap_int_asc(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/** Converts a CSR_DATA to the bitmap tile format. The tiles of a tile row are
+*   collected with a marker per tile column and sorted, the masks of the tile row
+*   are set and the elements are then placed by the number of mask bits before
+*   their own bit, so the values of a tile are packed in row major order.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       BITMAP_DATA *bitmap_data: the BITMAP_DATA to fill
+*       CSR_DATA *csr_data: the matrix in CSR format
+*       int rows: the number of rows in the matrix
+*       int cols: the number of columns in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int csr_to_bitmap(SMOPS_CTX *ctx, BITMAP_DATA *bitmap_data, CSR_DATA *csr_data, int rows, int cols)
+{
+    int tile_rows = (rows + BITMAP_TILE - 1)/BITMAP_TILE;
+    int tile_cols = (cols + BITMAP_TILE - 1)/BITMAP_TILE;
+    SMOPS_INDEX *ia = csr_data->ia;
+    int *ja = csr_data->ja;
+    bitmap_data->tile_rows = tile_rows;
+    bitmap_data->tile_cols = tile_cols;
+
+    int *mark = (int *)malloc(sizeof(int)*(tile_cols > 0 ? tile_cols : 1));
+    int *slot = (int *)malloc(sizeof(int)*(tile_cols > 0 ? tile_cols : 1));
+    bitmap_data->ia = (int *)calloc(tile_rows + 1, sizeof(int));
+    if(mark == NULL || slot == NULL || bitmap_data->ia == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for bitmap data for matrix");
+        free(mark);
+        free(slot);
+        return 0;
+    }
+
+    int t_col, r;
+    SMOPS_INDEX i;
+    for(t_col = 0; t_col < tile_cols; t_col++) {
+        mark[t_col] = -1;
+    }
+    for(int t_row = 0; t_row < tile_rows; t_row++) {
+        bitmap_data->ia[t_row + 1] = bitmap_data->ia[t_row];
+        for(r = t_row*BITMAP_TILE; r < (t_row + 1)*BITMAP_TILE && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                t_col = ja[i]/BITMAP_TILE;
+                if(mark[t_col] != t_row) {
+                    mark[t_col] = t_row;
+                    bitmap_data->ia[t_row + 1]++;
+                }
+            }
+        }
+    }
+
+    int tiles = bitmap_data->ia[tile_rows];
+    bitmap_data->tiles = tiles;
+    bitmap_data->ja = (int *)malloc(sizeof(int)*(tiles > 0 ? tiles : 1));
+    bitmap_data->masks = (uint64_t *)calloc(tiles > 0 ? tiles : 1, sizeof(uint64_t));
+    bitmap_data->val_ptr = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(tiles + 1));
+    bitmap_data->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*(ia[rows] > 0 ? ia[rows] : 1));
+    if(bitmap_data->ja == NULL || bitmap_data->masks == NULL || bitmap_data->val_ptr == NULL
+        || bitmap_data->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for bitmap data for matrix");
+        free(mark);
+        free(slot);
+        return 0;
+    }
+
+    int pos, n, bit;
+    uint64_t mask;
+    for(t_col = 0; t_col < tile_cols; t_col++) {
+        mark[t_col] = -1;
+    }
+    bitmap_data->val_ptr[0] = 0;
+    for(int t_row = 0; t_row < tile_rows; t_row++) {
+        pos = bitmap_data->ia[t_row];
+        for(r = t_row*BITMAP_TILE; r < (t_row + 1)*BITMAP_TILE && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                t_col = ja[i]/BITMAP_TILE;
+                if(mark[t_col] != t_row) {
+                    mark[t_col] = t_row;
+                    bitmap_data->ja[pos++] = t_col;
+                }
+            }
+        }
+        qsort(bitmap_data->ja + bitmap_data->ia[t_row], pos - bitmap_data->ia[t_row], sizeof(int), bitmap_int_asc);
+        for(n = bitmap_data->ia[t_row]; n < pos; n++) {
+            slot[bitmap_data->ja[n]] = n;
+        }
+        for(r = t_row*BITMAP_TILE; r < (t_row + 1)*BITMAP_TILE && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                bit = (r % BITMAP_TILE)*BITMAP_TILE + ja[i] % BITMAP_TILE;
+                bitmap_data->masks[slot[ja[i]/BITMAP_TILE]] |= (uint64_t)1 << bit;
+            }
+        }
+        for(n = bitmap_data->ia[t_row]; n < pos; n++) {
+            bitmap_data->val_ptr[n + 1] = bitmap_data->val_ptr[n] + __builtin_popcountll(bitmap_data->masks[n]);
+        }
+        for(r = t_row*BITMAP_TILE; r < (t_row + 1)*BITMAP_TILE && r < rows; r++) {
+            for(i = ia[r]; i < ia[r+1]; i++) {
+                n = slot[ja[i]/BITMAP_TILE];
+                bit = (r % BITMAP_TILE)*BITMAP_TILE + ja[i] % BITMAP_TILE;
+                mask = bitmap_data->masks[n] & (((uint64_t)1 << bit) - 1);
+                bitmap_data->values[bitmap_data->val_ptr[n] + __builtin_popcountll(mask)] = csr_data->nnz[i];
+            }
+        }
+    }
+    free(mark);
+    free(slot);
+    return 1;
+}
+
+/** Converts COO format to the bitmap tile format for a matrix, going through CSR
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the BITMAP format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_bitmap(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    if(matrix->bitmap_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "bitmap memory has not been set for matrix (BITMAP format not set)");
+        return 0;
+    }
+    CSR_DATA *csr_data = coo_to_temp_csr(ctx, matrix);
+    if(csr_data == NULL) {return 0;}
+
+    int ret = csr_to_bitmap(ctx, matrix->bitmap_data, csr_data, matrix->rows, matrix->cols);
+    CSR_free(csr_data);
+    if(ret == 1) {
+        matrix->stats.bitmap_tiles = matrix->bitmap_data->tiles;
+    }
+    return ret;
+}
+
+/** Converts a CSR_DATA to CSR-DU, the values and row starts are taken over from
+*   the CSR_DATA. The bytes of every row are counted first, then the differences
+*   of the columns are written as varints.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       CSRDU_DATA *csrdu_data: the CSRDU_DATA to fill
+*       CSR_DATA *csr_data: the matrix in CSR format with sorted rows, its nnz and ia are taken
+*       int rows: the number of rows in the matrix
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int csr_to_csrdu(SMOPS_CTX *ctx, CSRDU_DATA *csrdu_data, CSR_DATA *csr_data, int rows)
+{
+    SMOPS_INDEX *ia = csr_data->ia;
+    int *ja = csr_data->ja;
+    csrdu_data->ja_ptr = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(rows + 1));
+    if(csrdu_data->ja_ptr == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csrdu data for matrix");
+        return 0;
+    }
+
+    unsigned delta;
+    SMOPS_INDEX i, bytes = 0;
+    int prev;
+    for(int r = 0; r < rows; r++) {
+        csrdu_data->ja_ptr[r] = bytes;
+        prev = 0;
+        for(i = ia[r]; i < ia[r+1]; i++) {
+            for(delta = ja[i] - prev; delta >= 0x80; delta >>= 7) {
+                bytes++;
+            }
+            bytes++;
+            prev = ja[i];
+        }
+    }
+    csrdu_data->ja_ptr[rows] = bytes;
+
+    csrdu_data->ja = (uint8_t *)malloc(bytes > 0 ? bytes : 1);
+    if(csrdu_data->ja == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csrdu data for matrix");
+        return 0;
+    }
+    uint8_t *out = csrdu_data->ja;
+    for(int r = 0; r < rows; r++) {
+        prev = 0;
+        for(i = ia[r]; i < ia[r+1]; i++) {
+            for(delta = ja[i] - prev; delta >= 0x80; delta >>= 7) {
+                *out++ = (uint8_t)((delta & 0x7F) | 0x80);
+            }
+            *out++ = (uint8_t)delta;
+            prev = ja[i];
+        }
+    }
+
+    csrdu_data->nnz = csr_data->nnz;
+    csrdu_data->ia = csr_data->ia;
+    csr_data->nnz = NULL;
+    csr_data->ia = NULL;
+    return 1;
+}
+
+/** Measures how fast the column stream of a CSR-DU matrix decodes by decoding it
+*   once with the decoder of the kernel the planner picks for CSRDU
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the operation
+*       MATRIX *matrix: the matrix in CSRDU format
+*
+*   return:
+*       millions of columns decoded per second, 0 if the matrix is empty
+*/
+double csrdu_decode_rate(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    CSRDU_DATA *du = matrix->csrdu_data;
+    CSRDU_DECODER decode = CSRDU_decoder(PLAN_kernel(ctx, CSRDU));
+    int buf[CSRDU_BATCH];
+    const uint8_t *ja;
+    SMOPS_INDEX i;
+    int k, col;
+    struct timespec start, end;
+    if(matrix->non_zero_size == 0) {return 0;}
+
+    clock_gettime(CLOCK_REALTIME, &start);
+    for(int r = 0; r < matrix->rows; r++) {
+        ja = du->ja + du->ja_ptr[r];
+        col = 0;
+        for(i = du->ia[r]; i < du->ia[r+1]; i += k) {
+            k = du->ia[r+1] - i < CSRDU_BATCH ? (int)(du->ia[r+1] - i) : CSRDU_BATCH;
+            ja = decode(buf, ja, col, k);
+            col = buf[k - 1];
+        }
+    }
+    clock_gettime(CLOCK_REALTIME, &end);
+    double time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/BILLION;
+    return time > 0 ? matrix->non_zero_size/time/1e6 : 0;
+}
+
+/** Converts COO format to CSR-DU format for a matrix, going through CSR. The
+*   compression ratio of the column indices and the decode rate are set in the
+*   stats of the matrix.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix to store the CSRDU format
+*
+*   return:
+*       1 if successfully executed, 0 otherwise and fills in error message
+*/
+int coo_to_csrdu(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    if(matrix->csrdu_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "csrdu memory has not been set for matrix (CSRDU format not set)");
+        return 0;
+    }
+    CSR_DATA *csr_data = coo_to_temp_csr(ctx, matrix);
+    if(csr_data == NULL) {return 0;}
+
+    int ret = csr_to_csrdu(ctx, matrix->csrdu_data, csr_data, matrix->rows);
+    CSR_free(csr_data);
+    if(ret == 1 && matrix->non_zero_size > 0) {
+        matrix->stats.csrdu_ratio = (double) matrix->non_zero_size*sizeof(int)
+                                        /matrix->csrdu_data->ja_ptr[matrix->rows];
+        matrix->stats.csrdu_decode_rate = csrdu_decode_rate(ctx, matrix);
+    }
+    return ret;
 }
 
-/** Converts COO format to CSR format for a matrix
+/** Converts COO format to DIA format for a matrix. The occupied diagonals are
+*   counted with an entry per offset, every diagonal is stored whole and the
+*   elements are scattered to their row within their diagonal.
 *
 *   parameters:
 *       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
-*       MATRIX *matrix: the matrix to store the CSR format
+*       MATRIX *matrix: the matrix to store the DIA format
 *
 *   return:
 *       1 if successfully executed, 0 otherwise and fills in error message
 */
-int coo_to_csr(SMOPS_CTX *ctx, MATRIX *matrix)
+int coo_to_dia(SMOPS_CTX *ctx, MATRIX *matrix)
 {
-    int non_zero_size = matrix->non_zero_size;
     int rows = matrix->rows;
+    int cols = matrix->cols;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
     COO_DATA *coo_data = matrix->coo_data;
-    CSR_DATA *csr_data = matrix->csr_data;
+    DIA_DATA *dia_data = matrix->dia_data;
 
-    if(csr_data == NULL) {
-        SMOPS_CTX_fill_err_msg(ctx, "csr memory has not been set for matrix (CSR format not set)");
+    if(dia_data == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "dia memory has not been set for matrix (DIA format not set)");
         return 0;
     }
-    csr_data->nnz = (MATRIX_DATA *)calloc(non_zero_size, sizeof(MATRIX_DATA));
-    if(csr_data->nnz == NULL) {
-        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+    //Offset k is at slot[k + rows - 1], the matrix has rows + cols - 1 diagonals
+    int *slot = (int *)calloc(rows + cols > 0 ? rows + cols : 1, sizeof(int));
+    if(slot == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dia data for matrix");
         return 0;
     }
-    csr_data->ia = (int *)calloc(rows + 1, sizeof(int));
-    if(csr_data->ia == NULL) {
-        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+    SMOPS_INDEX i;
+    int k, d;
+    for(i = 0; i < non_zero_size; i++) {
+        slot[coo_data->coords_j[i] - coo_data->coords_i[i] + rows - 1] = 1;
+    }
+    int diagonals = 0;
+    for(i = 0; i < rows + cols - 1; i++) {
+        diagonals += slot[i];
+    }
+
+    dia_data->diagonals = diagonals;
+    dia_data->offsets = (int *)malloc(sizeof(int)*(diagonals > 0 ? diagonals : 1));
+    dia_data->start = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(diagonals + 1));
+    if(dia_data->offsets == NULL || dia_data->start == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dia data for matrix");
+        free(slot);
         return 0;
     }
-    csr_data->ja = (int *)malloc(sizeof(int)*non_zero_size);
-    if(csr_data->ja == NULL) {
-        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for csr data for matrix");
+    dia_data->start[0] = 0;
+    d = 0;
+    for(i = 0; i < rows + cols - 1; i++) {
+        if(slot[i] == 0) {continue;}
+        k = (int)i - rows + 1;
+        dia_data->offsets[d] = k;
+        dia_data->start[d+1] = dia_data->start[d]
+                            + (rows < cols - k ? rows : cols - k) - (k < 0 ? -k : 0);
+        slot[i] = d++;
+    }
+
+    size_t stored = dia_data->start[diagonals];
+    dia_data->values = (MATRIX_DATA *)calloc(stored > 0 ? stored : 1, sizeof(MATRIX_DATA));
+    if(dia_data->values == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for dia data for matrix");
+        free(slot);
         return 0;
     }
+    for(i = 0; i < non_zero_size; i++) {
+        k = coo_data->coords_j[i] - coo_data->coords_i[i];
+        d = slot[k + rows - 1];
+        dia_data->values[dia_data->start[d] + coo_data->coords_i[i] - (k < 0 ? -k : 0)] = coo_data->values[i];
+    }
+    free(slot);
+
+    matrix->stats.dia_diagonals = diagonals;
+    matrix->stats.dia_fill = non_zero_size > 0 ? (double) stored/non_zero_size : 0;
+    return 1;
+}
+
+/** Arguments of the tasks moving a dense matrix into COO_DATA */
+struct dense_to_coo_args {
+    MATRIX_DATA *dense;
+    COO_DATA *coo_data;
+    SMOPS_INDEX *row_start;
+    TYPE type;
+    int cols;
+};
 
-    COO_sort_row_order(coo_data, matrix->non_zero_size);
+/** Counts the non zero elements of the rows p to q of a dense matrix into
+*   row_start[r + 1]
+*
+*   parameters:
+*       void *arg: the struct dense_to_coo_args
+*       SMOPS_INDEX p: the first row
+*       SMOPS_INDEX q: the row after the last row
+*       int worker: unused
+*/
+void dense_count_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dense_to_coo_args *a = (struct dense_to_coo_args *)arg;
+    MATRIX_DATA *row;
+    SMOPS_INDEX count;
+    for(SMOPS_INDEX r = p; r < q; r++) {
+        row = a->dense + (size_t)r*a->cols;
+        count = 0;
+        for(int c = 0; c < a->cols; c++) {
+            count += a->type == FLOAT ? row[c].f != 0 : row[c].i != 0;
+        }
+        a->row_start[r + 1] = count;
+    }
+}
 
-    convert_coo(csr_data->nnz, csr_data->ia, csr_data->ja, coo_data->values,
-        coo_data->coords_i, coo_data->coords_j, non_zero_size, rows, ctx->thread_num);
+/** Moves the non zero elements of the rows p to q of a dense matrix into COO_DATA
+*   from row_start[r] onwards
+*
+*   parameters: see dense_count_task
+*/
+void dense_fill_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct dense_to_coo_args *a = (struct dense_to_coo_args *)arg;
+    COO_DATA *coo_data = a->coo_data;
+    MATRIX_DATA *row;
+    SMOPS_INDEX pos;
+    for(SMOPS_INDEX r = p; r < q; r++) {
+        row = a->dense + (size_t)r*a->cols;
+        pos = a->row_start[r];
+        for(int c = 0; c < a->cols; c++) {
+            if(a->type == FLOAT ? row[c].f != 0 : row[c].i != 0) {
+                coo_data->coords_i[pos] = (int)r;
+                coo_data->coords_j[pos] = c;
+                coo_data->values[pos] = row[c];
+                pos++;
+            }
+        }
+    }
+}
 
+/** Moves the non zero elements of the dense matrix parsed from the file into the
+*   allocated COO_DATA of the matrix in row order. The rows are counted and then
+*   filled by the thread pool.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix with the allocated COO_DATA
+*       MATRIX_DATA *dense_matrix: the parsed matrix (rows x cols)
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling error message
+*/
+int dense_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_DATA *dense_matrix)
+{
+    int rows = matrix->rows;
+    SMOPS_INDEX *row_start = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*(rows + 1));
+    if(row_start == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for coo_data");
+        return 0;
+    }
+    struct dense_to_coo_args args = { dense_matrix, matrix->coo_data, row_start, matrix->type, matrix->cols };
+    row_start[0] = 0;
+    POOL_parallel_for(ctx, rows, 0, dense_count_task, &args);
+    for(int r = 0; r < rows; r++) {
+        row_start[r + 1] += row_start[r];
+    }
+    POOL_parallel_for(ctx, rows, 0, dense_fill_task, &args);
+    free(row_start);
     return 1;
 }
 
@@ -184,9 +1172,8 @@ int coo_to_csr(SMOPS_CTX *ctx, MATRIX *matrix)
 */
 int float_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
 {
-    int size = matrix->size;
-    int cols = matrix->cols;
-    int non_zero_size = 0;
+    int64_t size = matrix->size;
+    int64_t non_zero_size = 0;
     MATRIX_DATA *dense_matrix = (MATRIX_DATA *)calloc(size, sizeof(MATRIX_DATA));
     if(dense_matrix ==  NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to temporarily store dense matrix");
@@ -194,48 +1181,21 @@ int float_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
     }
     COO_DATA *coo_data = matrix->coo_data;
 
-    int index;
+    int64_t index;
     double elem;
     char *ptr;
     char *elem_str;
-    switch(ctx->thread_num) {
-        case 1:
-            index = 0;
-            elem_str = strtok_r(data_str, " ", &ptr);
-            do {
-                elem = atof(elem_str);
-
-                if(elem != 0) {
-                    dense_matrix[index].f = elem;
-                    non_zero_size++;
-                }
-                index++;
-            } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num)
-            {
-                #pragma omp single
-                {
-                    index = 0;
-                    elem_str = strtok_r(data_str, " ", &ptr);
-                    do {
-                        elem = atof(elem_str);
-
-                        #pragma omp task firstprivate(index, elem)
-                        {
-                            if(elem != 0) {
-                                dense_matrix[index].f = elem;
-                                #pragma omp atomic
-                                non_zero_size++;
-                            }
-                        }
-                        index++;
-                    } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
-                }
-            }
-            break;
-    }
+    index = 0;
+    elem_str = strtok_r(data_str, " ", &ptr);
+    do {
+        elem = atof(elem_str);
+
+        if(elem != 0) {
+            dense_matrix[index].f = elem;
+            non_zero_size++;
+        }
+        index++;
+    } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
 
     matrix->non_zero_size = non_zero_size;
 
@@ -255,19 +1215,9 @@ int float_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
         return 0;
     }
 
-    index = 0;
-    for (int i = 0; i < size; i++) {
-        elem = dense_matrix[i].f;
-        if(elem != 0) {
-            coo_data->coords_i[index] = i / cols;
-            coo_data->coords_j[index] = i % cols;
-            coo_data->values[index].f = elem;
-            index++;
-        }
-    }
-
+    int done = dense_to_coo(ctx, matrix, dense_matrix);
     free(dense_matrix);
-    return 1;
+    return done;
 }
 
 /** Reads the data_str and converts it to COO format with data type int
@@ -282,9 +1232,8 @@ int float_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
 */
 int int_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
 {
-    int size = matrix->size;
-    int cols = matrix->cols;
-    int non_zero_size = 0;
+    int64_t size = matrix->size;
+    int64_t non_zero_size = 0;
     MATRIX_DATA *dense_matrix = (MATRIX_DATA *)calloc(size, sizeof(MATRIX_DATA));
     if(dense_matrix ==  NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to temporarily store dense matrix");
@@ -292,47 +1241,21 @@ int int_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
     }
     COO_DATA *coo_data = matrix->coo_data;
 
-    int index, elem;
+    int64_t index;
+    int elem;
     char *ptr;
     char *elem_str;
-    switch(ctx->thread_num) {
-        case 1:
-            index = 0;
-            elem_str = strtok_r(data_str, " ", &ptr);
-            do {
-                elem = atoi(elem_str);
-
-                if(elem != 0) {
-                    dense_matrix[index].i = elem;
-                    non_zero_size++;
-                }
-                index++;
-            } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
-            break;
-        default:
-            #pragma omp parallel num_threads(ctx->thread_num)
-            {
-                #pragma omp single
-                {
-                    index = 0;
-                    elem_str = strtok_r(data_str, " ", &ptr);
-                    do {
-                        elem = atoi(elem_str);
-
-                        #pragma omp task firstprivate(index, elem)
-                        {
-                            if(elem != 0) {
-                                dense_matrix[index].i = elem;
-                                #pragma omp atomic
-                                non_zero_size++;
-                            }
-                        }
-                        index++;
-                    } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
-                }
-            }
-            break;
-    }
+    index = 0;
+    elem_str = strtok_r(data_str, " ", &ptr);
+    do {
+        elem = atoi(elem_str);
+
+        if(elem != 0) {
+            dense_matrix[index].i = elem;
+            non_zero_size++;
+        }
+        index++;
+    } while((elem_str = strtok_r(NULL, " ", &ptr)) != NULL);
 
     matrix->non_zero_size = non_zero_size;
 
@@ -352,19 +1275,9 @@ int int_parse_data_str_to_coo(SMOPS_CTX *ctx, MATRIX *matrix, char *data_str)
         return 0;
     }
 
-    index = 0;
-    for (int i = 0; i < size; i++) {
-        elem = dense_matrix[i].i;
-        if(elem != 0) {
-            coo_data->coords_i[index] = i / cols;
-            coo_data->coords_j[index] = i % cols;
-            coo_data->values[index].i = elem;
-            index++;
-        }
-    }
-
+    int done = dense_to_coo(ctx, matrix, dense_matrix);
     free(dense_matrix);
-    return 1;
+    return done;
 }
 
 /** Reads the data_str and converts it to COO format
@@ -399,6 +1312,24 @@ int convert_from_coo(SMOPS_CTX *ctx, MATRIX *matrix)
             return coo_to_csr(ctx, matrix);
         case CSC:
             return coo_to_csc(ctx, matrix);
+        case DENSE:
+            return coo_to_dense(ctx, matrix);
+        case ELL:
+            return coo_to_ell(ctx, matrix);
+        case SELL:
+            return coo_to_sell(ctx, matrix);
+        case BCSR:
+            return coo_to_bcsr(ctx, matrix);
+        case DIA:
+            return coo_to_dia(ctx, matrix);
+        case DCSR:
+            return coo_to_dcsr(ctx, matrix);
+        case CSB:
+            return coo_to_csb(ctx, matrix);
+        case BITMAP:
+            return coo_to_bitmap(ctx, matrix);
+        case CSRDU:
+            return coo_to_csrdu(ctx, matrix);
         case COO:
             return 1;
         case NONE:
@@ -409,6 +1340,58 @@ int convert_from_coo(SMOPS_CTX *ctx, MATRIX *matrix)
     return 0;
 }
 
+/** Converts a loaded matrix to another format from its COO_DATA
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the loaded matrix to convert
+*       MATRIX_FORMAT format: the format to convert the matrix to
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int MATRIX_convert(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
+{
+    if(matrix->format == format && (format != BCSR
+        || matrix->bcsr_data->block == matrix->stats.bcsr_block)) {return 1;}
+    if(MATRIX_switch_format(ctx, matrix, format) == 0) {return 0;}
+    //Called from inside an operation, which gets its phase back afterwards
+    PHASE phase = SMOPS_CTX_plan_phase(ctx, PHASE_CONVERT, NO_OP, (double)matrix->non_zero_size);
+    int converted = convert_from_coo(ctx, matrix);
+    ctx->phase = phase;
+    if(converted == 0) {return 0;}
+    matrix->kernel = PLAN_kernel(ctx, format);
+    PLAN_report(ctx, matrix, "converted");
+    return 1;
+}
+
+/** Plans the format of a loaded matrix for an operation and converts it to that
+*   format, used for a view of a matrix loaded for another operation. The format
+*   is picked by PLAN_select from the stats of the matrix, a view builds it from
+*   its own copy of the elements.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the loaded matrix to plan
+*       OPERATION op: the operation the matrix is planned for
+*       MATRIX_FORMAT requested: the format the operation needs for the matrix, NONE if any
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int MATRIX_plan(SMOPS_CTX *ctx, MATRIX *matrix, OPERATION op, MATRIX_FORMAT requested)
+{
+    //Called from inside an operation, which gets its phase and operation back afterwards
+    OPERATION operation = ctx->operation;
+    PHASE phase = SMOPS_CTX_plan_phase(ctx, PHASE_CONVERT, NO_OP, (double)matrix->non_zero_size);
+    ctx->operation = op;
+    int planned = MATRIX_switch_format(ctx, matrix, requested) && PLAN_select(ctx, matrix)
+        && convert_from_coo(ctx, matrix);
+    ctx->operation = operation;
+    ctx->phase = phase;
+    return planned;
+}
+
 /** Gets the type of the matrix specifed in the file for preloading
 *
 *   parameters:
@@ -490,30 +1473,22 @@ int MATRIX_preload_type(SMOPS_CTX *ctx, MATRIX *matrix_a, char *filename_a, MATR
     return 1;
 }
 
-/** Loads the data for the matrix from the input file specified
+/** Reads the type, rows and cols lines at the top of a matrix file. The type
+*   is only taken from the file if it was not preloaded.
 *
 *   parameters:
 *       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
-*       MATRIX *matrix: the matrix load the data from file into
-*       char *filename: the file to load the data from
+*       MATRIX *matrix: the matrix to set the type and size of
+*       FILE *file: the matrix file, left at its data line
 *
 *   return:
-*       1 if data has successfully loaded, 0 otherwise
+*       1 if successfully executed, 0 otherwise filling error message
 */
-int MATRIX_load(SMOPS_CTX *ctx, MATRIX *matrix, char *filename)
+int load_header(SMOPS_CTX *ctx, MATRIX *matrix, FILE *file)
 {
-    struct timespec start, end;
-    clock_gettime(CLOCK_REALTIME, &start);
-    FILE *file = fopen(filename, "r");
-    if(file == NULL) {
-        SMOPS_CTX_fill_err_msg(ctx, "failed to open file");
-        return 0;
-    }
-
     char buffer[BUFFER_SIZE];
     READSPECLINE {
         SMOPS_CTX_fill_err_msg(ctx, "failed to read file");
-        fclose(file);
         return 0;
     }
 
@@ -521,45 +1496,303 @@ int MATRIX_load(SMOPS_CTX *ctx, MATRIX *matrix, char *filename)
     if(matrix->type == UNDEFINED) {
         if(get_type(ctx, matrix, buffer) == UNDEFINED) {
             SMOPS_CTX_fill_err_msg(ctx, "failed to get data type from input file");
-            fclose(file);
             return 0;
         }
     }
 
     READSPECLINE {
         SMOPS_CTX_fill_err_msg(ctx, "failed to read file");
-        fclose(file);
         return 0;
     }
     matrix->rows = atoi(buffer);
     READSPECLINE {
         SMOPS_CTX_fill_err_msg(ctx, "failed to read file");
-        fclose(file);
         return 0;
     }
     matrix->cols = atoi(buffer);
-    matrix->size = matrix->rows * matrix->cols;
+    matrix->size = (int64_t)matrix->rows * matrix->cols;
+    return 1;
+}
+
+/** Reads the data line of a matrix file whose header has been read, plans the
+*   format of the matrix and converts it into that format
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: the matrix with its type and size set by load_header
+*       FILE *file: the matrix file at its data line
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int load_body(SMOPS_CTX *ctx, MATRIX *matrix, FILE *file)
+{
+    SMOPS_CTX_plan_phase(ctx, PHASE_LOAD, NO_OP, (double)matrix->size);
 
     size_t data_size = sizeof(char)*DATA_CHUNK_SIZE;
     char *data_str = (char *)malloc(data_size);
-    if((data_size = getline(&data_str, &data_size, file)) == -1) {
+    if(getline(&data_str, &data_size, file) == -1) {
         SMOPS_CTX_fill_err_msg(ctx, "error occurred reading data line from file");
-        fclose(file);
+        free(data_str);
         return 0;
     }
     if(parse_data_str_to_coo(ctx, matrix, data_str) == 0) {
         free(data_str);
-        fclose(file);
         return 0;
     }
+    free(data_str);
+    if(PLAN_scan(ctx, matrix) == 0 || PLAN_select(ctx, matrix) == 0) {
+        return 0;
+    }
+    SMOPS_CTX_plan_phase(ctx, PHASE_CONVERT, NO_OP, (double)matrix->non_zero_size);
     if(convert_from_coo(ctx, matrix) == 0) {
-        free(data_str);
+        return 0;
+    }
+    //How well CSRDU compresses is only known once the matrix is encoded
+    if(matrix->format == CSRDU) {
+        PLAN_report(ctx, matrix, "encoded");
+    }
+    return 1;
+}
+
+/** Loads the data for the matrix from the input file specified
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: the matrix load the data from file into
+*       char *filename: the file to load the data from
+*
+*   return:
+*       1 if data has successfully loaded, 0 otherwise
+*/
+int MATRIX_load(SMOPS_CTX *ctx, MATRIX *matrix, char *filename)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+    FILE *file = fopen(filename, "r");
+    if(file == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to open file");
+        return 0;
+    }
+
+    if(load_header(ctx, matrix, file) == 0 || load_body(ctx, matrix, file) == 0) {
         fclose(file);
+        return 0;
     }
-    free(data_str);
     fclose(file);
     clock_gettime(CLOCK_REALTIME, &end);
     ctx->time_load += (end.tv_sec - start.tv_sec) +
                         (end.tv_nsec - start.tv_nsec)/ BILLION;
     return 1;
 }
+
+/** Arguments of load_body_job */
+struct load_body_args {
+    MATRIX *matrix;
+    FILE *file;
+};
+
+/** Runs load_body as an asynchronous call
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX of the call
+*       void *arg: the struct load_body_args
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int load_body_job(SMOPS_CTX *ctx, void *arg)
+{
+    struct load_body_args *args = (struct load_body_args *)arg;
+    return load_body(ctx, args->matrix, args->file);
+}
+
+/** Loads the bodies of two matrix files at the same time on split thread teams.
+*   The threads are shared in proportion to the sizes of the matrices. matrix_a
+*   is loaded on the calling thread and matrix_b as a call on the pool of ctx,
+*   and the pool splits its threads between the loops of both, so no more than
+*   thread_num threads run at once.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX with at least 2 threads
+*       MATRIX *matrix_a: the first matrix with its header read
+*       FILE *file_a: the file of the first matrix at its data line
+*       MATRIX *matrix_b: the second matrix with its header read
+*       FILE *file_b: the file of the second matrix at its data line
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int load_pair_split(SMOPS_CTX *ctx, MATRIX *matrix_a, FILE *file_a, MATRIX *matrix_b, FILE *file_b)
+{
+    int threads = ctx->thread_num;
+    int team_a = (int)((double)threads*matrix_a->size/(matrix_a->size + matrix_b->size) + 0.5);
+    team_a = team_a < 1 ? 1 : team_a > threads - 1 ? threads - 1 : team_a;
+
+    SMOPS_CTX *call_a = SMOPS_CTX_new_call(ctx);
+    SMOPS_CTX *call_b = SMOPS_CTX_new_call(ctx);
+    if(call_a == NULL || call_b == NULL) {
+        if(call_a != NULL) SMOPS_CTX_free(call_a);
+        if(call_b != NULL) SMOPS_CTX_free(call_b);
+        SMOPS_CTX_fill_err_msg(ctx, "failed to start the thread teams for loading");
+        return 0;
+    }
+    call_a->thread_num = team_a;
+    call_b->thread_num = threads - team_a;
+
+    struct load_body_args args = { matrix_b, file_b };
+    int loaded = 0;
+    SMOPS_FUTURE *load_b = SMOPS_async(call_b, load_body_job, &args, sizeof(args), NULL, 0);
+    if(load_b != NULL) {
+        loaded = load_body(call_a, matrix_a, file_a);
+        loaded = SMOPS_FUTURE_wait(load_b) && loaded;
+        SMOPS_FUTURE_free(load_b);
+    }
+    SMOPS_CTX_merge_call(ctx, call_a);
+    SMOPS_CTX_merge_call(ctx, call_b);
+    SMOPS_CTX_free(call_a);
+    SMOPS_CTX_free(call_b);
+    return loaded;
+}
+
+/** Checks if two open matrix files are the same input, either the same file or
+*   two files with the same bytes. Files of the same size are compared chunk by
+*   chunk until they differ, then both are rewound.
+*
+*   parameters:
+*       FILE *file_a: the first file at its start
+*       FILE *file_b: the second file at its start
+*
+*   return:
+*       1 if the files hold the same matrix, 0 otherwise
+*/
+int load_same_file(FILE *file_a, FILE *file_b)
+{
+    struct stat stat_a, stat_b;
+    if(fstat(fileno(file_a), &stat_a) != 0 || fstat(fileno(file_b), &stat_b) != 0) {return 0;}
+    if(stat_a.st_dev == stat_b.st_dev && stat_a.st_ino == stat_b.st_ino) {return 1;}
+    if(stat_a.st_size != stat_b.st_size) {return 0;}
+
+    char chunk_a[LOAD_COMPARE_CHUNK], chunk_b[LOAD_COMPARE_CHUNK];
+    size_t read_a, read_b;
+    int same = 1;
+    do {
+        read_a = fread(chunk_a, 1, LOAD_COMPARE_CHUNK, file_a);
+        read_b = fread(chunk_b, 1, LOAD_COMPARE_CHUNK, file_b);
+        same = read_a == read_b && memcmp(chunk_a, chunk_b, read_a) == 0;
+    } while(same && read_a == LOAD_COMPARE_CHUNK);
+    rewind(file_a);
+    rewind(file_b);
+    return same;
+}
+
+/** Makes a matrix from the same input as a loaded matrix without parsing it
+*   again. The matrix becomes a view of the loaded matrix (see MATRIX_view) and
+*   shares all its data when it would be planned the same. Otherwise the format
+*   set on it is planned from the stats of the loaded matrix and built from its
+*   elements, a CSC operand of a CSR matrix is transposed from the CSR_DATA. The
+*   CSC operand of A*A is never read, A*A runs from the rows of A, so it is shared.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: the matrix to make, with any format it requires set
+*       MATRIX *store: the loaded matrix
+*       MATRIX_FORMAT store_requested: the format set on store before it was loaded
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int load_alias(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX *store, MATRIX_FORMAT store_requested)
+{
+    MATRIX_FORMAT requested = matrix->format;
+    MATRIX_free_data(matrix);
+    *matrix = *store;
+    matrix->store = store;
+    if(requested == store_requested || requested == store->format
+        || (ctx->operation == MATRIX_MULT && requested == CSC && store->format == CSR)) {
+        PLAN_report(ctx, matrix, "shared");
+        return 1;
+    }
+
+    SMOPS_CTX_plan_phase(ctx, PHASE_CONVERT, NO_OP, (double)matrix->non_zero_size);
+    if(MATRIX_switch_format(ctx, matrix, requested) == 0 || PLAN_select(ctx, matrix) == 0) {return 0;}
+    if(matrix->format == store->format) {
+        MATRIX_free_data(matrix);
+        *matrix = *store;
+        matrix->store = store;
+        return 1;
+    }
+    if(matrix->format == CSC && store->format == CSR && store->csr_data->nnz != NULL) {
+        if(csr_to_csc(ctx, matrix->csc_data, store->csr_data, matrix->rows, matrix->cols,
+            matrix->non_zero_size) == 0) {return 0;}
+        if(matrix->stats.ia32 && CSR_narrow_offsets(ctx, matrix->csc_data, matrix->cols) == 0) {return 0;}
+        return matrix->stats.ja16 == 0 || CSR_narrow_columns(ctx, matrix->csc_data, matrix->non_zero_size);
+    }
+    return convert_from_coo(ctx, matrix);
+}
+
+/** Loads the matrices a and b of a two matrix operation, opening each file once.
+*   The types are taken from both headers, if either matrix is of type float both
+*   are loaded as float. The bodies are loaded at the same time on split thread
+*   teams, unless one matrix is LOAD_PAIR_SKEW times larger than the other or
+*   there is one thread, then they are loaded one after the other by the whole
+*   team. Formats set beforehand, such as CSC for the right matrix of matrix
+*   multiplication, are kept. When both names are the same file or the files
+*   have the same bytes the input is parsed once, matrix_b is made from matrix_a
+*   by load_alias and must be freed before it.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix_a: matrix a
+*       char *filename_a: the file name for matrix a
+*       MATRIX *matrix_b: matrix b
+*       char *filename_b: the file name for matrix b
+*
+*   return:
+*       1 if both matrices have successfully loaded, 0 otherwise filling error message
+*/
+int MATRIX_load_pair(SMOPS_CTX *ctx, MATRIX *matrix_a, char *filename_a, MATRIX *matrix_b, char *filename_b)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_REALTIME, &start);
+
+    FILE *file_a = fopen(filename_a, "r");
+    if(file_a == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to open first file");
+        return 0;
+    }
+    FILE *file_b = fopen(filename_b, "r");
+    if(file_b == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to open second file");
+        fclose(file_a);
+        return 0;
+    }
+
+    matrix_a->type = UNDEFINED;
+    matrix_b->type = UNDEFINED;
+    MATRIX_FORMAT requested_a = matrix_a->format;
+    int same = load_same_file(file_a, file_b);
+    int loaded = load_header(ctx, matrix_a, file_a) && (same || load_header(ctx, matrix_b, file_b));
+    if(loaded == 1 && same) {
+        loaded = load_body(ctx, matrix_a, file_a) && load_alias(ctx, matrix_b, matrix_a, requested_a);
+    } else if(loaded == 1) {
+        if(matrix_a->type == FLOAT || matrix_b->type == FLOAT) {
+            matrix_a->type = FLOAT;
+            matrix_b->type = FLOAT;
+        }
+        int64_t small = matrix_a->size < matrix_b->size ? matrix_a->size : matrix_b->size;
+        int64_t large = matrix_a->size < matrix_b->size ? matrix_b->size : matrix_a->size;
+        if(ctx->thread_num > 1 && small*LOAD_PAIR_SKEW >= large) {
+            loaded = load_pair_split(ctx, matrix_a, file_a, matrix_b, file_b);
+        } else {
+            loaded = load_body(ctx, matrix_a, file_a) && load_body(ctx, matrix_b, file_b);
+        }
+    }
+    fclose(file_a);
+    fclose(file_b);
+    if(loaded == 0) {return 0;}
+    clock_gettime(CLOCK_REALTIME, &end);
+    ctx->time_load += (end.tv_sec - start.tv_sec) +
+                        (end.tv_nsec - start.tv_nsec)/ BILLION;
+    return 1;
+}
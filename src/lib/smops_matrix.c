@@ -1,6 +1,10 @@
 #include <stdlib.h>
 #include "smops.h"
 
+//A view owns the data of a format unless it still shares it with its store
+#define MATRIX_OWNS(matrix, data) ((matrix)->data != NULL \
+    && ((matrix)->store == NULL || (matrix)->data != (matrix)->store->data))
+
 /** Frees the data associated to the matrix
 *
 *   parameters:
@@ -8,9 +12,18 @@
 */
 void MATRIX_free_data(MATRIX *matrix)
 {
-    if(matrix->coo_data != NULL) COO_free(matrix->coo_data);
-    if(matrix->csr_data != NULL) CSR_free(matrix->csr_data);
-    if(matrix->csc_data != NULL) CSC_free(matrix->csc_data);
+    if(MATRIX_OWNS(matrix, coo_data)) COO_free(matrix->coo_data);
+    if(MATRIX_OWNS(matrix, csr_data)) CSR_free(matrix->csr_data);
+    if(MATRIX_OWNS(matrix, csc_data)) CSC_free(matrix->csc_data);
+    if(MATRIX_OWNS(matrix, dense_data)) DENSE_free(matrix->dense_data);
+    if(MATRIX_OWNS(matrix, ell_data)) ELL_free(matrix->ell_data);
+    if(MATRIX_OWNS(matrix, sell_data)) SELL_free(matrix->sell_data);
+    if(MATRIX_OWNS(matrix, bcsr_data)) BCSR_free(matrix->bcsr_data);
+    if(MATRIX_OWNS(matrix, dia_data)) DIA_free(matrix->dia_data);
+    if(MATRIX_OWNS(matrix, dcsr_data)) DCSR_free(matrix->dcsr_data);
+    if(MATRIX_OWNS(matrix, csb_data)) CSB_free(matrix->csb_data);
+    if(MATRIX_OWNS(matrix, bitmap_data)) BITMAP_free(matrix->bitmap_data);
+    if(MATRIX_OWNS(matrix, csrdu_data)) CSRDU_free(matrix->csrdu_data);
 }
 
 /** Frees the memory for a matrix
@@ -24,27 +37,18 @@ void MATRIX_free(MATRIX *matrix)
     free(matrix);
 }
 
-/** Sets the format for the Matrix
+/** Allocates the data for the format of the matrix other than the COO_DATA,
+*   which every matrix has
 *
 *   paramaters:
 *       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
-*       MATRIX *matrix: a pointer to the matrix to have its format set
-*       MATRIX_FORMAT format: the format to set for the matrix
+*       MATRIX *matrix: a pointer to the matrix to allocate the format data for
 *
 *   return:
 *       1 if executed successfully, 0 if not and fills the err_msg in SMOPS_CTX
 */
-int MATRIX_set_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
+int matrix_new_format_data(SMOPS_CTX *ctx, MATRIX *matrix)
 {
-    matrix->format = format;
-
-    matrix->coo_data = NULL;
-    matrix->csr_data = NULL;
-    matrix->csc_data = NULL;
-
-    matrix->coo_data = COO_new(ctx);
-    if(matrix->coo_data == NULL) {return 0;}
-
     switch(matrix->format){
         case CSR:
             matrix->csr_data = CSR_new(ctx);
@@ -56,6 +60,44 @@ int MATRIX_set_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
             matrix->csc_data = CSC_new(ctx);
             if(matrix->csc_data == NULL) {return 0;}
             break;
+        case DENSE:
+            matrix->dense_data = DENSE_new(ctx);
+            if(matrix->dense_data == NULL) {return 0;}
+            break;
+        case ELL:
+            matrix->ell_data = ELL_new(ctx);
+            if(matrix->ell_data == NULL) {return 0;}
+            break;
+        case SELL:
+            matrix->sell_data = SELL_new(ctx);
+            if(matrix->sell_data == NULL) {return 0;}
+            break;
+        case BCSR:
+            matrix->bcsr_data = BCSR_new(ctx);
+            if(matrix->bcsr_data == NULL) {return 0;}
+            break;
+        case DIA:
+            matrix->dia_data = DIA_new(ctx);
+            if(matrix->dia_data == NULL) {return 0;}
+            break;
+        case DCSR:
+            matrix->dcsr_data = DCSR_new(ctx);
+            if(matrix->dcsr_data == NULL) {return 0;}
+            break;
+        case CSB:
+            matrix->csb_data = CSB_new(ctx);
+            if(matrix->csb_data == NULL) {return 0;}
+            break;
+        case BITMAP:
+            matrix->bitmap_data = BITMAP_new(ctx);
+            if(matrix->bitmap_data == NULL) {return 0;}
+            break;
+        case CSRDU:
+            matrix->csrdu_data = CSRDU_new(ctx);
+            if(matrix->csrdu_data == NULL) {return 0;}
+            break;
+        case NONE:
+            break;
         default:
             SMOPS_CTX_fill_err_msg(ctx, "failed to get required format for matrix");
             return 0;
@@ -63,6 +105,87 @@ int MATRIX_set_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
     return 1;
 }
 
+/** Sets the format for the Matrix
+*
+*   paramaters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: a pointer to the matrix to have its format set
+*       MATRIX_FORMAT format: the format to set for the matrix
+*
+*   return:
+*       1 if executed successfully, 0 if not and fills the err_msg in SMOPS_CTX
+*/
+int MATRIX_set_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
+{
+    matrix->format = format;
+
+    matrix->coo_data = NULL;
+    matrix->csr_data = NULL;
+    matrix->csc_data = NULL;
+    matrix->dense_data = NULL;
+    matrix->ell_data = NULL;
+    matrix->sell_data = NULL;
+    matrix->bcsr_data = NULL;
+    matrix->dia_data = NULL;
+    matrix->dcsr_data = NULL;
+    matrix->csb_data = NULL;
+    matrix->bitmap_data = NULL;
+    matrix->csrdu_data = NULL;
+
+    matrix->coo_data = COO_new(ctx);
+    if(matrix->coo_data == NULL) {return 0;}
+
+    return matrix_new_format_data(ctx, matrix);
+}
+
+/** Switches the format of the matrix while keeping its COO_DATA.
+*   The data of the old format is freed and empty data is set for the new format,
+*   MATRIX_convert fills it from the COO_DATA. A view leaves the data it shares
+*   with its store alone.
+*
+*   paramaters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *matrix: a pointer to the matrix to have its format switched
+*       MATRIX_FORMAT format: the new format for the matrix
+*
+*   return:
+*       1 if executed successfully, 0 if not and fills the err_msg in SMOPS_CTX
+*/
+int MATRIX_switch_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format)
+{
+    //Converting sorts the COO_DATA, so a view sorts its own copy and the store is never written
+    if(matrix->store != NULL && matrix->coo_data == matrix->store->coo_data) {
+        COO_DATA *coo_data = COO_copy(ctx, matrix->coo_data, matrix->non_zero_size);
+        if(coo_data == NULL) {return 0;}
+        matrix->coo_data = coo_data;
+    }
+    if(MATRIX_OWNS(matrix, csr_data)) CSR_free(matrix->csr_data);
+    if(MATRIX_OWNS(matrix, csc_data)) CSC_free(matrix->csc_data);
+    if(MATRIX_OWNS(matrix, dense_data)) DENSE_free(matrix->dense_data);
+    if(MATRIX_OWNS(matrix, ell_data)) ELL_free(matrix->ell_data);
+    if(MATRIX_OWNS(matrix, sell_data)) SELL_free(matrix->sell_data);
+    if(MATRIX_OWNS(matrix, bcsr_data)) BCSR_free(matrix->bcsr_data);
+    if(MATRIX_OWNS(matrix, dia_data)) DIA_free(matrix->dia_data);
+    if(MATRIX_OWNS(matrix, dcsr_data)) DCSR_free(matrix->dcsr_data);
+    if(MATRIX_OWNS(matrix, csb_data)) CSB_free(matrix->csb_data);
+    if(MATRIX_OWNS(matrix, bitmap_data)) BITMAP_free(matrix->bitmap_data);
+    if(MATRIX_OWNS(matrix, csrdu_data)) CSRDU_free(matrix->csrdu_data);
+    matrix->csr_data = NULL;
+    matrix->csc_data = NULL;
+    matrix->dense_data = NULL;
+    matrix->ell_data = NULL;
+    matrix->sell_data = NULL;
+    matrix->bcsr_data = NULL;
+    matrix->dia_data = NULL;
+    matrix->dcsr_data = NULL;
+    matrix->csb_data = NULL;
+    matrix->bitmap_data = NULL;
+    matrix->csrdu_data = NULL;
+
+    matrix->format = format;
+    return matrix_new_format_data(ctx, matrix);
+}
+
 /** Changes the format of the matrix
 *
 *   parameters:
@@ -88,13 +211,13 @@ int MATRIX_change_format(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format_ne
 *       TYPE type: the new type for the matrix
 *       int rows: the new number of rows for the matrix
 *       int cols: the new number of cols for the matrix
-*       int non_zero_size: the number of non zero elements to be set for matrix
+*       SMOPS_INDEX non_zero_size: the number of non zero elements to be set for matrix
 *
 *   return:
 *       1 if successfully executed, 0 otherwise filling error message
 */
 int MATRIX_set_properties(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format,
-                            TYPE type, int rows, int cols, int non_zero_size)
+                            TYPE type, int rows, int cols, SMOPS_INDEX non_zero_size)
 {
     if(matrix == NULL) {
         SMOPS_CTX_fill_err_msg(ctx, "a null matrix was used a parameter for MATRIX_set_properties");
@@ -103,7 +226,7 @@ int MATRIX_set_properties(SMOPS_CTX *ctx, MATRIX *matrix, MATRIX_FORMAT format,
     matrix->type = type;
     matrix->rows = rows;
     matrix->cols = cols;
-    matrix->size = rows*cols;
+    matrix->size = (int64_t)rows*cols;
     matrix->non_zero_size = non_zero_size;
     return MATRIX_change_format(ctx, matrix, format);
 }
@@ -125,14 +248,62 @@ MATRIX *MATRIX_new(SMOPS_CTX *ctx)
         return NULL;
     }
 
-    MATRIX_FORMAT OPERATION_FORMATS[] = OP_MAP_FORMAT;
-    if(MATRIX_set_format(ctx,
-            matrix,
-            (MATRIX_FORMAT) OPERATION_FORMATS[ctx->operation]) == 0){
+    //The format is chosen by the planner once the matrix is loaded
+    if(MATRIX_set_format(ctx, matrix, NONE) == 0){
         free(matrix);
         return NULL;
     }
 
     matrix->type = UNDEFINED;
+    matrix->kernel = KERNEL_SCALAR;
+    matrix->stats = (MATRIX_STATS){0};
+    matrix->store = NULL;
     return matrix;
 }
+
+/** Creates a view of a loaded matrix for one call. The view shares the data of
+*   the matrix, which is never written through the view: an operation needing
+*   another format converts a copy of the elements owned by the view. Several
+*   calls can so run operations on views of the same matrix at the same time.
+*   The matrix must outlive its views.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: a pointer to the SMOPS_CTX
+*       MATRIX *store: the loaded matrix
+*
+*   return:
+*       the view freed with MATRIX_free, NULL if an error has occurred and fills
+*       err_msg in SMOPS_CTX
+*/
+MATRIX *MATRIX_view(SMOPS_CTX *ctx, MATRIX *store)
+{
+    if(store->store != NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "a view cannot be made of another view");
+        return NULL;
+    }
+    MATRIX *view = (MATRIX *)malloc(sizeof(MATRIX));
+    if(view == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for matrix view");
+        return NULL;
+    }
+    *view = *store;
+    view->store = store;
+    return view;
+}
+
+/** Checks if two matrices hold the same elements because one is a view of the
+*   other or both are views of the same matrix, such as A and A in A+A
+*
+*   parameters:
+*       MATRIX *matrix_a: one matrix
+*       MATRIX *matrix_b: the other matrix
+*
+*   return:
+*       1 if the matrices share their store, 0 otherwise
+*/
+int MATRIX_aliases(MATRIX *matrix_a, MATRIX *matrix_b)
+{
+    MATRIX *store_a = matrix_a->store != NULL ? matrix_a->store : matrix_a;
+    MATRIX *store_b = matrix_b->store != NULL ? matrix_b->store : matrix_b;
+    return store_a == store_b;
+}
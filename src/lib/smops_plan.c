@@ -0,0 +1,633 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "smops.h"
+
+#define PLAN_LINE_SIZE 192
+#define PLAN_MV_DENSE_DENSITY 0.6
+#define PLAN_ELL_MAX_PADDING 1.2
+#define PLAN_SELL_MAX_PADDING 1.2
+#define PLAN_SHORT_ROW 32
+#define PLAN_BCSR_MAX_FILL 1.2
+#define PLAN_DIA_MAX_FILL 1.2
+#define PLAN_DCSR_MIN_EMPTY 0.5
+#define PLAN_BITMAP_MIN_TILE_NNZ 8
+#define PLAN_CSRDU_MIN_BYTES (8 << 20) //CSR bigger than the last level cache is memory bound
+#define PLAN_CSRDU_MAX_GAP 128 //columns closer than this take one byte
+#define PLAN_JA16_MAX_COLS (UINT16_MAX + 1)
+#define PLAN_IA32_MAX_NNZ INT32_MAX
+
+/** Checks if the cpu supports the AVX2 and FMA instructions used by the simd kernels
+*
+*   return:
+*       1 if the simd kernels can be used, 0 otherwise
+*/
+int plan_cpu_has_simd()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+/** Orders ints in descending order for qsort
+*/
+int plan_int_desc(const void *a, const void *b)
+{
+    return *(const int *)b - *(const int *)a;
+}
+
+/** Measures the padding of the SELL format by sorting the row lengths within
+*   every window of SELL_SIGMA rows and padding every SELL_C rows to the longest
+*
+*   parameters:
+*       int *row_nnz: the number of non zero elements in every row, is reordered
+*       int rows: the number of rows
+*       SMOPS_INDEX non_zero_size: the number of non zero elements
+*
+*   return:
+*       stored elements/non zero elements of the SELL format
+*/
+double plan_sell_padding(int *row_nnz, int rows, SMOPS_INDEX non_zero_size)
+{
+    if(non_zero_size == 0) {return 0;}
+    double slots = 0;
+    for(int r = 0; r < rows; r += SELL_SIGMA) {
+        qsort(row_nnz + r, r + SELL_SIGMA < rows ? SELL_SIGMA : rows - r, sizeof(int), plan_int_desc);
+    }
+    for(int r = 0; r < rows; r += SELL_C) {
+        slots += (double) row_nnz[r]*SELL_C;
+    }
+    return slots/non_zero_size;
+}
+
+/** Counts the diagonals with a non zero element and the elements the DIA format
+*   stores for them, marking every occupied offset k at k + rows - 1
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the scanned matrix, dia_diagonals and dia_fill are set in its stats
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int plan_dia_fill(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    MATRIX_STATS *stats = &matrix->stats;
+    int rows = matrix->rows;
+    int cols = matrix->cols;
+    int *coords_i = matrix->coo_data->coords_i;
+    int *coords_j = matrix->coo_data->coords_j;
+    stats->dia_diagonals = 0;
+    stats->dia_fill = 0;
+    if(matrix->non_zero_size == 0) {return 1;}
+
+    char *occupied = (char *)calloc(rows + cols, sizeof(char));
+    if(occupied == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to count the matrix diagonals");
+        return 0;
+    }
+    for(SMOPS_INDEX i = 0; i < matrix->non_zero_size; i++) {
+        occupied[coords_j[i] - coords_i[i] + rows - 1] = 1;
+    }
+    double stored = 0;
+    int k;
+    for(int i = 0; i < rows + cols - 1; i++) {
+        if(occupied[i] == 0) {continue;}
+        k = i - rows + 1;
+        stats->dia_diagonals++;
+        stored += (rows < cols - k ? rows : cols - k) - (k < 0 ? -k : 0);
+    }
+    stats->dia_fill = stored/matrix->non_zero_size;
+    free(occupied);
+    return 1;
+}
+
+/** Scans the COO_DATA of a loaded matrix to measure its structure for the planner
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the matrix parsed into COO format, its stats are filled in
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int PLAN_scan(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    MATRIX_STATS *stats = &matrix->stats;
+    int rows = matrix->rows;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    int *coords_i = matrix->coo_data->coords_i;
+    int *coords_j = matrix->coo_data->coords_j;
+
+    stats->density = matrix->size > 0 ? (double) non_zero_size/matrix->size : 0;
+    stats->row_nnz_mean = rows > 0 ? (double) non_zero_size/rows : 0;
+    stats->row_nnz_var = 0;
+    stats->row_nnz_max = 0;
+    stats->empty_rows = rows;
+    stats->bandwidth = 0;
+    stats->sell_padding = 0;
+    if(rows == 0) {return 1;}
+
+    int *row_nnz = (int *)calloc(rows, sizeof(int));
+    if(row_nnz == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to scan matrix structure");
+        return 0;
+    }
+
+    int distance;
+    for(SMOPS_INDEX i = 0; i < non_zero_size; i++) {
+        row_nnz[coords_i[i]]++;
+        distance = abs(coords_i[i] - coords_j[i]);
+        if(distance > stats->bandwidth) {
+            stats->bandwidth = distance;
+        }
+    }
+
+    double diff;
+    for(int r = 0; r < rows; r++) {
+        if(row_nnz[r] > stats->row_nnz_max) {
+            stats->row_nnz_max = row_nnz[r];
+        }
+        if(row_nnz[r] > 0) {
+            stats->empty_rows--;
+        }
+        diff = row_nnz[r] - stats->row_nnz_mean;
+        stats->row_nnz_var += diff*diff;
+    }
+    stats->row_nnz_var /= rows;
+    stats->sell_padding = plan_sell_padding(row_nnz, rows, non_zero_size);
+
+    free(row_nnz);
+    return plan_dia_fill(ctx, matrix);
+}
+
+/** Gets the kernel variant to use for a format in the current operation
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the operation
+*       MATRIX_FORMAT format: the format of the matrix
+*
+*   return:
+*       KERNEL_SIMD if the operation has simd kernels for the format
+*       and the cpu supports them, KERNEL_SCALAR otherwise
+*/
+KERNEL PLAN_kernel(SMOPS_CTX *ctx, MATRIX_FORMAT format)
+{
+    switch(ctx->operation) {
+        case MATRIX_VECTOR_MULT:
+            if(format == CSR || format == ELL || format == SELL || format == DENSE || format == CSRDU) {
+                return plan_cpu_has_simd() ? KERNEL_SIMD : KERNEL_SCALAR;
+            }
+            if(format == BITMAP) {
+                return plan_cpu_has_simd() && __builtin_cpu_supports("bmi2") ? KERNEL_SIMD : KERNEL_SCALAR;
+            }
+            return KERNEL_SCALAR;
+        case ADD:
+            if(format == CSRDU) {
+                return plan_cpu_has_simd() ? KERNEL_SIMD : KERNEL_SCALAR;
+            }
+            return format == DENSE ? KERNEL_SIMD : KERNEL_SCALAR;
+        case MATRIX_MULT:
+            return format == DENSE ? KERNEL_SIMD : KERNEL_SCALAR;
+        case TRACE:
+            if(format == SELL || format == CSRDU) {
+                return plan_cpu_has_simd() ? KERNEL_SIMD : KERNEL_SCALAR;
+            }
+            return KERNEL_SCALAR;
+        default:
+            return KERNEL_SCALAR;
+    }
+}
+
+/** Adds the format, kernel and structure of the matrix to the plan report
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the plan report
+*       MATRIX *matrix: the matrix to report
+*       char *reason: why the matrix has this format
+*/
+void PLAN_report(SMOPS_CTX *ctx, MATRIX *matrix, char *reason)
+{
+    char *format_to_string[] = FORMAT_MAP_STRING;
+    char *kernel_to_string[] = KERNEL_MAP_STRING;
+    char *coding_to_string[] = VALUE_CODING_MAP_STRING;
+    char line[PLAN_LINE_SIZE];
+    char block[PLAN_LINE_SIZE/4] = "";
+    MATRIX_STATS *stats = &matrix->stats;
+    if(matrix->format == BCSR) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", block %d fill %.2f", stats->bcsr_block, stats->bcsr_fill);
+    } else if(matrix->format == DIA) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", diagonals %d fill %.2f", stats->dia_diagonals, stats->dia_fill);
+    } else if(matrix->format == CSB) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", beta %d", stats->csb_beta);
+    } else if(matrix->format == DCSR) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", nonempty rows %d", matrix->rows - stats->empty_rows);
+    } else if(matrix->format == BITMAP) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", tiles %d nnz/tile %.2f", stats->bitmap_tiles,
+            stats->bitmap_tiles > 0 ? (double) matrix->non_zero_size/stats->bitmap_tiles : 0);
+    } else if(matrix->format == CSR || matrix->format == CSC) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", ia %d bit, ja %d bit, values %s", stats->ia32 ? 32 : 64, stats->ja16 ? 16 : 32,
+            coding_to_string[stats->value_coding]);
+        if(stats->value_coding == VALUES_DICT) {
+            snprintf(block + strlen(block), PLAN_LINE_SIZE/4 - strlen(block), " %d", stats->value_distinct);
+        }
+    } else if(matrix->format == CSRDU && stats->csrdu_ratio > 0) {
+        snprintf(block, PLAN_LINE_SIZE/4, ", ja ratio %.2f decode %.0f Mcol/s", stats->csrdu_ratio,
+            stats->csrdu_decode_rate);
+    }
+    snprintf(line, PLAN_LINE_SIZE,
+        "plan: %dx%d %s %s (%s, density %.4f, nnz/row %.2f var %.2f max %d, bandwidth %d%s)",
+        matrix->rows, matrix->cols, format_to_string[matrix->format],
+        kernel_to_string[matrix->kernel], reason, stats->density, stats->row_nnz_mean,
+        stats->row_nnz_var, stats->row_nnz_max, stats->bandwidth, block);
+    SMOPS_CTX_add_plan_report(ctx, line);
+}
+
+/** Checks if ELL padding to the longest row stays within PLAN_ELL_MAX_PADDING
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*
+*   return:
+*       1 if the ELL format is worth using, 0 otherwise
+*/
+int plan_ell_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    double padded = (double) matrix->stats.row_nnz_max*matrix->rows;
+    return padded <= PLAN_ELL_MAX_PADDING*matrix->non_zero_size;
+}
+
+/** Checks if the matrix has short rows that SELL stores with little padding.
+*   Long rows are left to CSR, which already vectorises along the row.
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*
+*   return:
+*       1 if the SELL format is worth using, 0 otherwise
+*/
+int plan_sell_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    return matrix->stats.row_nnz_mean < PLAN_SHORT_ROW
+            && matrix->stats.sell_padding <= PLAN_SELL_MAX_PADDING;
+}
+
+/** Checks if the non zero elements lie on few enough diagonals that storing
+*   them whole stays within PLAN_DIA_MAX_FILL
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*
+*   return:
+*       1 if the DIA format is worth using, 0 otherwise
+*/
+int plan_dia_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    return matrix->stats.dia_fill <= PLAN_DIA_MAX_FILL;
+}
+
+/** Checks if the indices stored in ja fit in 16 bits, the columns of a CSR
+*   matrix or the rows of a CSC matrix
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*       MATRIX_FORMAT format: the format picked for the matrix
+*
+*   return:
+*       1 if ja can be stored in 16 bits, 0 otherwise
+*/
+int plan_ja16_fits(MATRIX *matrix, MATRIX_FORMAT format)
+{
+    if(format == CSR) {return matrix->cols <= PLAN_JA16_MAX_COLS;}
+    if(format == CSC) {return matrix->rows <= PLAN_JA16_MAX_COLS;}
+    return 0;
+}
+
+/** Checks if enough rows are empty that skipping them with DCSR pays off
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*
+*   return:
+*       1 if the DCSR format is worth using, 0 otherwise
+*/
+int plan_dcsr_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    return matrix->stats.empty_rows >= PLAN_DCSR_MIN_EMPTY*matrix->rows;
+}
+
+/** Checks if the non zero elements gather in semi-dense tiles, a tile with at
+*   least PLAN_BITMAP_MIN_TILE_NNZ elements pays for its mask and index and the
+*   kernels work on whole rows of a tile
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix, bitmap_tiles is set in its stats
+*
+*   return:
+*       1 if the BITMAP format is worth using, 0 otherwise
+*/
+int plan_bitmap_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    return matrix->non_zero_size >= (double) PLAN_BITMAP_MIN_TILE_NNZ*matrix->stats.bitmap_tiles;
+}
+
+/** Checks if the matrix is big enough for spmv and addition to be memory
+*   bound and its rows close enough for most column differences to fit in one
+*   varint byte. The mean difference is estimated from the width a row can span,
+*   the whole row or the band, over the mean number of elements in a row.
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*
+*   return:
+*       1 if the CSRDU format is worth using, 0 otherwise
+*/
+int plan_csrdu_fits(MATRIX *matrix)
+{
+    if(matrix->non_zero_size == 0) {return 0;}
+    double span = 2.0*matrix->stats.bandwidth + 1 < matrix->cols ? 2.0*matrix->stats.bandwidth + 1 : matrix->cols;
+    return (double) matrix->non_zero_size*(sizeof(MATRIX_DATA) + sizeof(int)) >= PLAN_CSRDU_MIN_BYTES
+            && span < PLAN_CSRDU_MAX_GAP*matrix->stats.row_nnz_mean;
+}
+
+/** Picks how to pack the values of the matrix, from the range of int values
+*   and the number of distinct values. A uint8_t dictionary index is as narrow
+*   as int8_t so the dictionary is tried before int16_t, float values can only
+*   be packed into a dictionary.
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix, value_coding and value_distinct are set in its stats
+*
+*   return:
+*       1 if the values can be packed, 0 otherwise
+*/
+int plan_value_coding(MATRIX *matrix)
+{
+    MATRIX_STATS *stats = &matrix->stats;
+    MATRIX_DATA *values = matrix->coo_data->values;
+    MATRIX_DATA dict[VALUES_DICT_MAX];
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    stats->value_coding = VALUES_FULL;
+    stats->value_distinct = 0;
+    if(non_zero_size == 0) {return 0;}
+
+    int min = 0, max = 0;
+    if(matrix->type == INT) {
+        min = values[0].i;
+        max = values[0].i;
+        for(SMOPS_INDEX i = 1; i < non_zero_size; i++) {
+            if(values[i].i < min) {min = values[i].i;}
+            if(values[i].i > max) {max = values[i].i;}
+        }
+        if(min >= INT8_MIN && max <= INT8_MAX) {
+            stats->value_coding = VALUES_INT8;
+            return 1;
+        }
+    }
+    stats->value_distinct = VALUES_dictionary(values, non_zero_size, matrix->type, dict, NULL);
+    if(stats->value_distinct <= VALUES_DICT_MAX) {
+        stats->value_coding = VALUES_DICT;
+    } else if(matrix->type == INT && min >= INT16_MIN && max <= INT16_MAX) {
+        stats->value_coding = VALUES_INT16;
+    }
+    return stats->value_coding != VALUES_FULL;
+}
+
+/** Gets the block size of the CSB format, the power of 2 nearest above the square
+*   root of the larger dimension so a block row and a block column of x stay in
+*   cache, within the 16 bit local coordinates
+*
+*   parameters:
+*       MATRIX *matrix: the matrix
+*
+*   return:
+*       the block size beta
+*/
+int PLAN_csb_beta(MATRIX *matrix)
+{
+    int n = matrix->rows > matrix->cols ? matrix->rows : matrix->cols;
+    int beta = CSB_MIN_BETA;
+    while(beta < CSB_MAX_BETA && (double) beta*beta < n) {
+        beta *= 2;
+    }
+    return beta;
+}
+
+/** Counts the blocks of the BCSR format with the block size, going through the
+*   elements one block row at a time with a marker per block column
+*
+*   parameters:
+*       MATRIX *matrix: the scanned matrix
+*       SMOPS_INDEX *row_start: start of every row in order (rows + 1 entries)
+*       SMOPS_INDEX *order: the elements of the COO_DATA ordered by row
+*       int *mark: a buffer with an entry per column
+*       int block: the block size
+*
+*   return:
+*       the number of blocks with a non zero element
+*/
+double plan_bcsr_blocks(MATRIX *matrix, SMOPS_INDEX *row_start, SMOPS_INDEX *order, int *mark, int block)
+{
+    int *coords_j = matrix->coo_data->coords_j;
+    int rows = matrix->rows;
+    int block_cols = (matrix->cols + block - 1)/block;
+    double blocks = 0;
+    int b_col;
+    for(b_col = 0; b_col < block_cols; b_col++) {
+        mark[b_col] = -1;
+    }
+    for(int b_row = 0; b_row*block < rows; b_row++) {
+        int end = (b_row + 1)*block < rows ? (b_row + 1)*block : rows;
+        for(SMOPS_INDEX i = row_start[b_row*block]; i < row_start[end]; i++) {
+            b_col = coords_j[order[i]]/block;
+            if(mark[b_col] != b_row) {
+                mark[b_col] = b_row;
+                blocks++;
+            }
+        }
+    }
+    return blocks;
+}
+
+/** Estimates the fill (stored elements/non zero elements) of every BCSR block size
+*   and picks the one moving the fewest bytes for a block and its index. A block
+*   size is only picked if its fill is within PLAN_BCSR_MAX_FILL and it moves
+*   fewer bytes than CSR. The BITMAP_TILE tiles of the bitmap format are counted
+*   the same way.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for error handling
+*       MATRIX *matrix: the scanned matrix, bcsr_block, bcsr_fill and bitmap_tiles
+*                       are set in its stats
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int plan_bcsr_block(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    MATRIX_STATS *stats = &matrix->stats;
+    int rows = matrix->rows;
+    SMOPS_INDEX non_zero_size = matrix->non_zero_size;
+    int *coords_i = matrix->coo_data->coords_i;
+    stats->bcsr_block = 0;
+    stats->bcsr_fill = 0;
+    stats->bitmap_tiles = 0;
+    if(non_zero_size == 0) {return 1;}
+
+    SMOPS_INDEX *row_start = (SMOPS_INDEX *)calloc(rows + 1, sizeof(SMOPS_INDEX));
+    SMOPS_INDEX *order = (SMOPS_INDEX *)malloc(sizeof(SMOPS_INDEX)*non_zero_size);
+    int *mark = (int *)malloc(sizeof(int)*(matrix->cols > 0 ? matrix->cols : 1));
+    if(row_start == NULL || order == NULL || mark == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory to estimate the bcsr fill");
+        free(row_start);
+        free(order);
+        free(mark);
+        return 0;
+    }
+    SMOPS_INDEX i;
+    for(i = 0; i < non_zero_size; i++) {
+        row_start[coords_i[i] + 1]++;
+    }
+    for(i = 0; i < rows; i++) {
+        row_start[i + 1] += row_start[i];
+    }
+    for(i = 0; i < non_zero_size; i++) {
+        order[row_start[coords_i[i]]++] = i;
+    }
+    for(i = rows; i > 0; i--) {
+        row_start[i] = row_start[i - 1];
+    }
+    row_start[0] = 0;
+
+    double best = (sizeof(MATRIX_DATA) + sizeof(int))*(double)non_zero_size;
+    double blocks, bytes;
+    for(int block = BCSR_MIN_BLOCK; block <= BCSR_MAX_BLOCK; block++) {
+        blocks = plan_bcsr_blocks(matrix, row_start, order, mark, block);
+        bytes = blocks*(block*block*sizeof(MATRIX_DATA) + sizeof(int));
+        if(blocks*block*block <= PLAN_BCSR_MAX_FILL*non_zero_size && bytes < best) {
+            best = bytes;
+            stats->bcsr_block = block;
+            stats->bcsr_fill = blocks*block*block/non_zero_size;
+        }
+    }
+    stats->bitmap_tiles = (int) plan_bcsr_blocks(matrix, row_start, order, mark, BITMAP_TILE);
+    free(row_start);
+    free(order);
+    free(mark);
+    return 1;
+}
+
+/** Picks the format and kernel for a scanned matrix in the current operation.
+*   A format set on the matrix before loading is a requirement of the operand
+*   (eg. CSC for the right matrix of mm), it is only replaced by DENSE, BCSR, DIA,
+*   BITMAP, DCSR or CSRDU when the operation has an engine for them. A matrix without a format
+*   (NONE) is given the best format for its structure, unless the operation only
+*   walks its elements once and would not make up for a conversion. CSR and CSC
+*   offsets are stored in 32 bits when the non zero elements fit.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the operation and error handling
+*       MATRIX *matrix: the scanned matrix, its format and kernel are set
+*
+*   return:
+*       1 if successfully executed, 0 otherwise filling error message
+*/
+int PLAN_select(SMOPS_CTX *ctx, MATRIX *matrix)
+{
+    MATRIX_FORMAT requested = matrix->format;
+    MATRIX_FORMAT format = requested;
+    MATRIX_STATS *stats = &matrix->stats;
+
+    switch(ctx->operation) {
+        case ADD:
+        case MATRIX_MULT:
+            if(stats->density >= ctx->dense_threshold) {
+                format = DENSE;
+                break;
+            }
+            if(ctx->operation == ADD && plan_dia_fits(matrix)) {
+                format = DIA;
+                break;
+            }
+            if(plan_bcsr_block(ctx, matrix) == 0) {return 0;}
+            if(stats->bcsr_block > 0) {
+                format = BCSR;
+            } else if(plan_bitmap_fits(matrix)) {
+                format = BITMAP;
+            } else if(ctx->operation == ADD && plan_dcsr_fits(matrix)) {
+                format = DCSR;
+            } else if(ctx->operation == ADD && plan_csrdu_fits(matrix)) {
+                format = CSRDU;
+            } else if(requested == NONE) {
+                format = CSR;
+            }
+            break;
+        case MATRIX_VECTOR_MULT:
+            if(requested != NONE) {break;}
+            if(stats->density >= PLAN_MV_DENSE_DENSITY) {
+                format = DENSE;
+                break;
+            }
+            if(plan_dia_fits(matrix)) {
+                format = DIA;
+                break;
+            }
+            if(plan_bcsr_block(ctx, matrix) == 0) {return 0;}
+            if(stats->bcsr_block > 0) {
+                format = BCSR;
+            } else if(plan_bitmap_fits(matrix)) {
+                format = BITMAP;
+            } else if(plan_dcsr_fits(matrix)) {
+                format = DCSR;
+            } else if(plan_csrdu_fits(matrix)) {
+                format = CSRDU;
+            } else if(plan_value_coding(matrix)) {
+                format = CSR; //packed values move fewer bytes than ELL or SELL save
+            } else if(plan_ell_fits(matrix)) {
+                format = ELL;
+            } else if(plan_sell_fits(matrix)) {
+                format = SELL;
+            } else {
+                format = CSR;
+            }
+            stats->ja16 = format == CSR && plan_ja16_fits(matrix, format);
+            break;
+        case TRANSPOSE_VECTOR_MULT:
+            if(requested != NONE) {break;}
+            format = CSB;
+            stats->csb_beta = PLAN_csb_beta(matrix);
+            break;
+        case TRACE_PRODUCT:
+        case INNER_PRODUCT:
+        case MATRIX_BLOCK_MULT:
+            if(requested == NONE) {
+                format = CSR;
+            }
+            break;
+        default:
+            //Trace, sum, transpose and scalar multiplication walk the elements
+            //once, as cheap as converting them, so they stay in COO
+            if(requested == NONE) {
+                format = COO;
+            }
+            break;
+    }
+    if(ctx->operation == ADD || ctx->operation == MATRIX_MULT
+        || ctx->operation == TRACE_PRODUCT || ctx->operation == INNER_PRODUCT) {
+        stats->ja16 = plan_ja16_fits(matrix, format);
+    }
+    stats->ia32 = matrix->non_zero_size <= PLAN_IA32_MAX_NNZ;
+
+    if(format != matrix->format) {
+        if(MATRIX_switch_format(ctx, matrix, format) == 0) {return 0;}
+    }
+    matrix->kernel = PLAN_kernel(ctx, format);
+    PLAN_report(ctx, matrix, requested == NONE || requested != format ? "planned" : "requested");
+    return 1;
+}
@@ -0,0 +1,1234 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "smops.h"
+
+#define POOL_DEQUE_SIZE 64 //a range is halved at most 63 times, so a deque never holds more
+#define POOL_SPLITS_PER_WORKER 8 //ranges per worker when no grain size is given
+#define POOL_SUM_BLOCKS 256 //blocks of a reproducible sum, whatever the number of threads
+#define POOL_REPRODUCIBLE_PARTS 256 //merge path parts of a reproducible run
+#define POOL_SPIN 4096 //polls of the job generation before a worker sleeps
+#define POOL_MAX_LOOPS 8 //parallel loops the pool runs at once, a loop finding no free slot runs on its caller
+#define POOL_CGROUP2_CPU "/sys/fs/cgroup/cpu.max"
+#define POOL_CGROUP1_QUOTA "/sys/fs/cgroup/cpu/cpu.cfs_quota_us"
+#define POOL_CGROUP1_PERIOD "/sys/fs/cgroup/cpu/cpu.cfs_period_us"
+#define POOL_CPU_SIBLINGS "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list"
+#define POOL_NODE_CPUS "/sys/devices/system/node/node%d/cpulist"
+#define POOL_MAX_NODES 64 //nodes looked for in sysfs
+#define POOL_PATH_SIZE 96
+#define POOL_PAGE 4096
+#define POOL_FIRST_TOUCH_MIN (1 << 20) //smaller buffers are zeroed by calloc on the calling thread
+
+/** A range of iterations of a parallel for
+*   p: the first iteration
+*   q: the iteration after the last iteration
+*/
+struct pool_range {
+    SMOPS_INDEX p;
+    SMOPS_INDEX q;
+};
+typedef struct pool_range POOL_RANGE;
+
+/** A Chase-Lev work stealing deque of ranges. The owner pushes and takes at the
+*   bottom, other workers steal the oldest (largest) range at the top. top and
+*   bottom only grow, the ranges are a circular buffer indexed by them.
+*/
+struct pool_deque {
+    int64_t top __attribute__((aligned(64)));
+    int64_t bottom __attribute__((aligned(64)));
+    POOL_RANGE ranges[POOL_DEQUE_SIZE];
+};
+typedef struct pool_deque POOL_DEQUE;
+
+/** A parallel for run by the pool, the loops of several calls run at once
+*   task: the task run on every range
+*   arg: the argument given to the task
+*   grain: ranges at most this long are not split further, the chunk size of
+*          the static and dynamic schedules and the smallest guided chunk
+*   workers: the workers 0 to workers - 1 taking part, the others leave at once
+*   schedule: how the ranges are handed out
+*   n: the number of iterations
+*   remaining: the number of iterations not run yet, the stealing job is done at 0
+*   next: the first iteration not handed out yet by the dynamic and guided schedules
+*   tasks: the number of ranges run
+*   deques: the deque of every worker of the loop, those of the slot of the loop
+*   joined: the number of worker indices handed out, the caller is worker 0
+*   inside: the number of pool threads working on the loop
+*   limit: the most pool threads the loop may have, its share of the pool
+*/
+struct pool_job {
+    POOL_TASK task;
+    void *arg;
+    SMOPS_INDEX grain;
+    int workers;
+    SCHEDULE schedule;
+    SMOPS_INDEX n;
+    SMOPS_INDEX remaining;
+    SMOPS_INDEX next;
+    long tasks;
+    POOL_DEQUE *deques;
+    int joined;
+    int inside;
+    int limit;
+};
+typedef struct pool_job POOL_JOB;
+
+/** A thread of the pool and its index */
+struct pool_worker {
+    POOL *pool;
+    int index;
+};
+typedef struct pool_worker POOL_WORKER;
+
+/** A pool of workers - 1 threads, the thread calling POOL_parallel_for is worker 0
+*   of its loop. The loops of several calls run at once, each in a slot, and the
+*   threads are split between them. A thread with no loop to join runs the
+*   calls queued on the pool, oldest first.
+*   workers: the number of workers including the calling thread
+*   threads: the threads of workers 1 to workers - 1
+*   args: the argument of every thread
+*   deques: workers deques for every slot
+*   lock: guards jobs, loops, ready, generation, the joined and limit of the loops and stop
+*   wake: broadcast when the loops change, a call is queued or the pool is stopped
+*   done: broadcast when a pool thread leaves a loop as the last one
+*   jobs: the loop running in every slot, NULL for a free slot
+*   loops: the number of loops running
+*   ready: the queued calls, oldest first
+*   ready_last: the newest queued call, NULL when none are queued
+*   generation: incremented when the loops or the calls change, threads poll it before sleeping
+*   stop: 1 when the threads should exit
+*   allowed: the CPUs the process could run on when the pool was made
+*   affinity: how the workers are pinned to CPUs
+*   cpus: the CPU of every worker when pinned
+*   nodes: the NUMA nodes the pinned workers are on
+*/
+struct pool {
+    int workers;
+    pthread_t *threads;
+    POOL_WORKER *args;
+    POOL_DEQUE *deques;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    POOL_JOB *jobs[POOL_MAX_LOOPS];
+    int loops;
+    POOL_CALL *ready;
+    POOL_CALL *ready_last;
+    unsigned long generation;
+    int stop;
+    cpu_set_t allowed;
+    AFFINITY affinity;
+    int *cpus;
+    int nodes;
+};
+
+/** A CPU the pool can pin a worker to
+*   cpu: the number of the CPU
+*   node: the NUMA node of the CPU
+*   secondary: 1 if another hardware thread of its core has a lower number
+*   rank: the position of the CPU in the compact order of its node
+*/
+struct pool_cpu {
+    int cpu;
+    int node;
+    int secondary;
+    int rank;
+};
+typedef struct pool_cpu POOL_CPU;
+
+/** Pushes a range to the bottom of a deque, only called by its owner
+*
+*   parameters:
+*       POOL_DEQUE *deque: the deque
+*       SMOPS_INDEX p: the first iteration of the range
+*       SMOPS_INDEX q: the iteration after the last iteration of the range
+*
+*   return:
+*       1 if the range was pushed, 0 if the deque is full
+*/
+static int pool_push(POOL_DEQUE *deque, SMOPS_INDEX p, SMOPS_INDEX q)
+{
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if(b - t >= POOL_DEQUE_SIZE) {return 0;}
+    POOL_RANGE *range = &deque->ranges[b % POOL_DEQUE_SIZE];
+    __atomic_store_n(&range->p, p, __ATOMIC_RELAXED);
+    __atomic_store_n(&range->q, q, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+/** Takes the newest range from the bottom of a deque, only called by its owner.
+*   When one range is left the owner races the thieves for it on top.
+*
+*   parameters:
+*       POOL_DEQUE *deque: the deque
+*       POOL_RANGE *range: where the range is stored
+*
+*   return:
+*       1 if a range was taken, 0 if the deque is empty
+*/
+static int pool_take(POOL_DEQUE *deque, POOL_RANGE *range)
+{
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if(t > b) {
+        __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    POOL_RANGE *slot = &deque->ranges[b % POOL_DEQUE_SIZE];
+    range->p = __atomic_load_n(&slot->p, __ATOMIC_RELAXED);
+    range->q = __atomic_load_n(&slot->q, __ATOMIC_RELAXED);
+    if(t < b) {return 1;}
+    int won = __atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, b + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+/** Steals the oldest range from the top of another worker's deque
+*
+*   parameters:
+*       POOL_DEQUE *deque: the deque to steal from
+*       POOL_RANGE *range: where the range is stored
+*
+*   return:
+*       1 if a range was stolen, 0 if the deque is empty or another worker won it
+*/
+static int pool_steal(POOL_DEQUE *deque, POOL_RANGE *range)
+{
+    int64_t t = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if(t >= b) {return 0;}
+    POOL_RANGE *slot = &deque->ranges[t % POOL_DEQUE_SIZE];
+    range->p = __atomic_load_n(&slot->p, __ATOMIC_RELAXED);
+    range->q = __atomic_load_n(&slot->q, __ATOMIC_RELAXED);
+    return __atomic_compare_exchange_n(&deque->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/** Lets a pool thread leave a job that has more threads than its share of the
+*   pool, so they go to the loops of other calls. The caller never leaves. The
+*   ranges the thread has run are added to the job first.
+*
+*   parameters:
+*       POOL_JOB *job: the job
+*       int w: the index of the worker
+*       long *tasks: the ranges the thread has run and not added yet, set to 0 when added
+*
+*   return:
+*       1 if the thread left the job, which it must not touch again, 0 otherwise
+*/
+static int pool_leave(POOL_JOB *job, int w, long *tasks)
+{
+    if(w == 0) {return 0;}
+    int inside = __atomic_load_n(&job->inside, __ATOMIC_RELAXED);
+    if(inside > __atomic_load_n(&job->limit, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&job->tasks, *tasks, __ATOMIC_RELAXED);
+        *tasks = 0;
+    }
+    while(inside > __atomic_load_n(&job->limit, __ATOMIC_RELAXED)) {
+        if(__atomic_compare_exchange_n(&job->inside, &inside, inside - 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {return 1;}
+    }
+    return 0;
+}
+
+/** Runs ranges of a job until all its iterations are done. A range longer than
+*   the grain is halved, the upper half is pushed for thieves and the lower half
+*   split again, so the largest ranges are the ones stolen. A worker with an
+*   empty deque steals from the others in turn, the deques of workers that left
+*   or never joined included.
+*
+*   parameters:
+*       POOL_JOB *job: the job to work on
+*       int w: the index of the worker
+*
+*   return:
+*       1 if the worker left the job for another loop, 0 otherwise
+*/
+static int pool_steal_work(POOL_JOB *job, int w)
+{
+    POOL_DEQUE *own = &job->deques[w];
+    POOL_RANGE range;
+    SMOPS_INDEX mid;
+    long tasks = 0;
+    int victim, found;
+    while(__atomic_load_n(&job->remaining, __ATOMIC_ACQUIRE) > 0) {
+        if(pool_leave(job, w, &tasks)) {return 1;}
+        found = pool_take(own, &range);
+        for(victim = 1; found == 0 && victim < job->workers; victim++) {
+            found = pool_steal(&job->deques[(w + victim) % job->workers], &range);
+        }
+        if(found == 0) {
+            sched_yield();
+            continue;
+        }
+        while(range.q - range.p > job->grain) {
+            mid = range.p + (range.q - range.p)/2;
+            if(pool_push(own, mid, range.q) == 0) {break;}
+            range.q = mid;
+        }
+        job->task(job->arg, range.p, range.q, w);
+        tasks++;
+        __atomic_sub_fetch(&job->remaining, range.q - range.p, __ATOMIC_ACQ_REL);
+    }
+    __atomic_add_fetch(&job->tasks, tasks, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/** Runs the chunks of grain iterations of a job dealt to a worker round robin,
+*   chunk k goes to worker k % workers
+*
+*   parameters:
+*       POOL_JOB *job: the job to work on
+*       int w: the index of the worker
+*/
+static void pool_static_work(POOL_JOB *job, int w)
+{
+    SMOPS_INDEX stride = (SMOPS_INDEX)job->workers*job->grain;
+    SMOPS_INDEX q;
+    long tasks = 0;
+    for(SMOPS_INDEX p = (SMOPS_INDEX)w*job->grain; p < job->n; p += stride) {
+        q = job->n - p > job->grain ? p + job->grain : job->n;
+        job->task(job->arg, p, q, w);
+        tasks++;
+    }
+    __atomic_add_fetch(&job->tasks, tasks, __ATOMIC_RELAXED);
+}
+
+/** Runs chunks of a job taken from its shared counter until none are left.
+*   Dynamic chunks are grain iterations, guided chunks are the iterations left
+*   split between the workers but no less than grain.
+*
+*   parameters:
+*       POOL_JOB *job: the job to work on
+*       int w: the index of the worker
+*
+*   return:
+*       1 if the worker left the job for another loop, 0 otherwise
+*/
+static int pool_shared_work(POOL_JOB *job, int w)
+{
+    SMOPS_INDEX p, q, chunk = job->grain;
+    long tasks = 0;
+    for(;;) {
+        if(pool_leave(job, w, &tasks)) {return 1;}
+        p = __atomic_load_n(&job->next, __ATOMIC_RELAXED);
+        do {
+            if(p >= job->n) {break;}
+            if(job->schedule == SCHEDULE_GUIDED) {
+                chunk = (job->n - p)/job->workers;
+                if(chunk < job->grain) {chunk = job->grain;}
+            }
+        } while(__atomic_compare_exchange_n(&job->next, &p, p + chunk, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == 0);
+        if(p >= job->n) {break;}
+        q = job->n - p > chunk ? p + chunk : job->n;
+        job->task(job->arg, p, q, w);
+        tasks++;
+    }
+    __atomic_add_fetch(&job->tasks, tasks, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/** Runs the part of a job of a worker with the schedule of the job. The static
+*   share of a worker is always run whole.
+*
+*   parameters:
+*       POOL_JOB *job: the job to work on
+*       int w: the index of the worker
+*
+*   return:
+*       1 if the worker left the job for another loop, 0 otherwise
+*/
+static int pool_work(POOL_JOB *job, int w)
+{
+    switch(job->schedule) {
+        case SCHEDULE_STATIC:
+            pool_static_work(job, w);
+            return 0;
+        case SCHEDULE_DYNAMIC:
+        case SCHEDULE_GUIDED:
+            return pool_shared_work(job, w);
+        default:
+            return pool_steal_work(job, w);
+    }
+}
+
+/** Checks if a pool thread can join a job, called holding the lock of the pool.
+*   A job whose iterations are all handed out takes no more threads.
+*
+*   parameters:
+*       POOL_JOB *job: the job
+*
+*   return:
+*       1 if the job has work left and room for one more thread, 0 otherwise
+*/
+static int pool_joinable(POOL_JOB *job)
+{
+    if(job->joined >= job->workers
+        || __atomic_load_n(&job->inside, __ATOMIC_RELAXED) >= job->limit) {return 0;}
+    switch(job->schedule) {
+        case SCHEDULE_STATIC:
+            return 1;
+        case SCHEDULE_DYNAMIC:
+        case SCHEDULE_GUIDED:
+            return __atomic_load_n(&job->next, __ATOMIC_RELAXED) < job->n;
+        default:
+            return __atomic_load_n(&job->remaining, __ATOMIC_RELAXED) > 0;
+    }
+}
+
+/** Splits the pool threads between the running loops, called holding the lock
+*   of the pool. Every caller is counted as one of the workers of the pool and
+*   the threads left are dealt round robin, no loop getting more than it has
+*   workers. While loops run the generation is moved on so idle threads look
+*   for a loop again.
+*
+*   parameters:
+*       POOL *pool: the pool
+*/
+static void pool_share(POOL *pool)
+{
+    int limits[POOL_MAX_LOOPS] = { 0 };
+    int spare = pool->workers - pool->loops, given = 1;
+    while(spare > 0 && given) {
+        given = 0;
+        for(int s = 0; s < POOL_MAX_LOOPS && spare > 0; s++) {
+            if(pool->jobs[s] != NULL && limits[s] < pool->jobs[s]->workers - 1) {
+                limits[s]++;
+                spare--;
+                given = 1;
+            }
+        }
+    }
+    for(int s = 0; s < POOL_MAX_LOOPS; s++) {
+        if(pool->jobs[s] != NULL) {
+            __atomic_store_n(&pool->jobs[s]->limit, limits[s], __ATOMIC_RELAXED);
+        }
+    }
+    if(pool->loops > 0) {
+        __atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&pool->wake);
+    }
+}
+
+/** Finds the loop a pool thread should join, called holding the lock of the
+*   pool. The loop with the fewest threads among those it can join is taken.
+*
+*   parameters:
+*       POOL *pool: the pool
+*
+*   return:
+*       the job of the loop, NULL if no loop can take the thread
+*/
+static POOL_JOB *pool_find(POOL *pool)
+{
+    POOL_JOB *found = NULL;
+    for(int s = 0; s < POOL_MAX_LOOPS; s++) {
+        if(pool->jobs[s] != NULL && pool_joinable(pool->jobs[s])
+            && (found == NULL || pool->jobs[s]->inside < found->inside)) {
+            found = pool->jobs[s];
+        }
+    }
+    return found;
+}
+
+/** The loop of a pool thread. It runs the oldest queued call, or else joins the
+*   running loop with the fewest threads under the next free worker index of
+*   that loop. When there is neither it polls for a change for a while before
+*   sleeping on the wake condition, which keeps the latency of back to back
+*   jobs low.
+*
+*   parameters:
+*       void *arg: the POOL_WORKER of the thread
+*
+*   return:
+*       NULL
+*/
+static void *pool_thread(void *arg)
+{
+    POOL_WORKER *worker = (POOL_WORKER *)arg;
+    POOL *pool = worker->pool;
+    unsigned long seen;
+    POOL_JOB *job;
+    POOL_CALL *call;
+    int index, left;
+    pthread_mutex_lock(&pool->lock);
+    for(;;) {
+        if(pool->stop) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        if((call = pool->ready) != NULL) {
+            pool->ready = call->next;
+            if(pool->ready == NULL) {pool->ready_last = NULL;}
+            pthread_mutex_unlock(&pool->lock);
+            //The call may be freed once it has run
+            call->run(call->arg);
+            pthread_mutex_lock(&pool->lock);
+            continue;
+        }
+        if((job = pool_find(pool)) == NULL) {
+            seen = pool->generation;
+            pthread_mutex_unlock(&pool->lock);
+            for(int spin = 0; spin < POOL_SPIN; spin++) {
+                if(__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) != seen) {break;}
+            }
+            pthread_mutex_lock(&pool->lock);
+            while(pool->generation == seen && pool->stop == 0) {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+            continue;
+        }
+        index = job->joined++;
+        __atomic_add_fetch(&job->inside, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&pool->lock);
+
+        left = pool_work(job, index);
+
+        //A thread that left has already counted itself out and may not touch the job
+        pthread_mutex_lock(&pool->lock);
+        if(left || __atomic_sub_fetch(&job->inside, 1, __ATOMIC_ACQ_REL) == 0) {
+            pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+/** Creates a thread pool, starting workers - 1 threads
+*
+*   parameters:
+*       int workers: the number of workers including the thread calling parallel for
+*
+*   return:
+*       the pool, NULL if it could not be created
+*/
+POOL *POOL_new(int workers)
+{
+    POOL *pool = (POOL *)malloc(sizeof(POOL));
+    if(pool == NULL) {return NULL;}
+    pool->workers = workers;
+    pool->threads = (pthread_t *)malloc(sizeof(pthread_t)*workers);
+    pool->args = (POOL_WORKER *)malloc(sizeof(POOL_WORKER)*workers);
+    pool->cpus = (int *)malloc(sizeof(int)*workers);
+    pool->deques = NULL;
+    if(posix_memalign((void **)&pool->deques, 64, sizeof(POOL_DEQUE)*workers*POOL_MAX_LOOPS) != 0) {
+        pool->deques = NULL;
+    }
+    if(pool->threads == NULL || pool->args == NULL || pool->cpus == NULL || pool->deques == NULL) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->cpus);
+        free(pool->deques);
+        free(pool);
+        return NULL;
+    }
+    for(int d = 0; d < workers*POOL_MAX_LOOPS; d++) {
+        pool->deques[d].top = 0;
+        pool->deques[d].bottom = 0;
+    }
+    for(int w = 0; w < workers; w++) {
+        pool->args[w].pool = pool;
+        pool->args[w].index = w;
+        pool->cpus[w] = -1;
+    }
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &pool->allowed) != 0) {
+        CPU_ZERO(&pool->allowed);
+    }
+    pool->affinity = AFFINITY_NONE;
+    pool->nodes = 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for(int s = 0; s < POOL_MAX_LOOPS; s++) {
+        pool->jobs[s] = NULL;
+    }
+    pool->loops = 0;
+    pool->ready = NULL;
+    pool->ready_last = NULL;
+    pool->generation = 0;
+    pool->stop = 0;
+
+    int started;
+    for(started = 1; started < workers; started++) {
+        if(pthread_create(&pool->threads[started], NULL, pool_thread, &pool->args[started]) != 0) {break;}
+    }
+    if(started < workers) {
+        pool->workers = started;
+        POOL_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/** Stops the threads of a pool and frees it, the calls still queued are not run
+*
+*   parameters:
+*       POOL *pool: the pool to free, may be NULL
+*/
+void POOL_free(POOL *pool)
+{
+    if(pool == NULL) {return;}
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for(int w = 1; w < pool->workers; w++) {
+        pthread_join(pool->threads[w], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->cpus);
+    free(pool->deques);
+    free(pool);
+}
+
+/** Queues a call on a pool, the first idle thread runs it. A pool with one
+*   worker has no threads, its calls only run when claimed back.
+*
+*   parameters:
+*       POOL *pool: the pool
+*       POOL_CALL *call: the call, left untouched by the pool once it has run
+*/
+void POOL_submit(POOL *pool, POOL_CALL *call)
+{
+    call->next = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if(pool->ready_last != NULL) {
+        pool->ready_last->next = call;
+    } else {
+        pool->ready = call;
+    }
+    pool->ready_last = call;
+    __atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/** Takes a queued call back from a pool before a thread runs it, so the thread
+*   waiting for the call can run it itself
+*
+*   parameters:
+*       POOL *pool: the pool
+*       POOL_CALL *call: the call
+*
+*   return:
+*       1 if the call was taken off the queue, 0 if it is not queued
+*/
+int POOL_claim(POOL *pool, POOL_CALL *call)
+{
+    pthread_mutex_lock(&pool->lock);
+    POOL_CALL *prev = NULL, *queued = pool->ready;
+    while(queued != NULL && queued != call) {
+        prev = queued;
+        queued = queued->next;
+    }
+    if(queued != NULL) {
+        if(prev != NULL) {
+            prev->next = call->next;
+        } else {
+            pool->ready = call->next;
+        }
+        if(pool->ready_last == call) {pool->ready_last = prev;}
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return queued != NULL;
+}
+
+/** Starts a job in a free slot of the pool, seeding the deques of the slot
+*   with an equal share for every worker when the ranges are stolen, and
+*   shares the threads of the pool again. Called holding the lock of the pool.
+*
+*   parameters:
+*       POOL *pool: the pool
+*       POOL_JOB *job: the job, its caller is worker 0
+*
+*   return:
+*       the slot of the job, -1 if every slot is taken
+*/
+static int pool_start(POOL *pool, POOL_JOB *job)
+{
+    int slot = -1;
+    for(int s = 0; s < POOL_MAX_LOOPS && slot < 0; s++) {
+        if(pool->jobs[s] == NULL) {slot = s;}
+    }
+    if(slot < 0) {return -1;}
+    //A slot is free once every thread has left its last job, so its deques are empty and unused
+    job->deques = &pool->deques[slot*pool->workers];
+    SMOPS_INDEX p, q;
+    for(int w = 0; w < job->workers && job->schedule == SCHEDULE_STEAL; w++) {
+        p = job->n*w/job->workers;
+        q = job->n*(w + 1)/job->workers;
+        if(q > p) {
+            pool_push(&job->deques[w], p, q);
+        }
+    }
+    pool->jobs[slot] = job;
+    pool->loops++;
+    pool_share(pool);
+    return slot;
+}
+
+/** Ends a job once its caller has run out of work. The static shares no thread
+*   joined for are run by the caller, then it waits for the threads still in the
+*   job, frees its slot and gives its threads to the other loops.
+*
+*   parameters:
+*       POOL *pool: the pool
+*       POOL_JOB *job: the job
+*       int slot: the slot of the job
+*/
+static void pool_end(POOL *pool, POOL_JOB *job, int slot)
+{
+    if(job->schedule == SCHEDULE_STATIC) {
+        pthread_mutex_lock(&pool->lock);
+        int first = job->joined;
+        job->joined = job->workers;
+        pthread_mutex_unlock(&pool->lock);
+        for(int w = first; w < job->workers; w++) {
+            pool_static_work(job, w);
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while(__atomic_load_n(&job->inside, __ATOMIC_ACQUIRE) > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pool->jobs[slot] = NULL;
+    pool->loops--;
+    pool_share(pool);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/** Runs task on the iterations 0 to n split into ranges between the first
+*   threads of the phase of the ctx with the given schedule, see POOL_parallel_for
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the pool and the phase
+*       SMOPS_INDEX n: the number of iterations
+*       SMOPS_INDEX grain: ranges at most this long are not split, 0 picks one
+*       SCHEDULE schedule: how the ranges are handed out
+*       POOL_TASK task: the task run on every range
+*       void *arg: the argument given to the task
+*/
+static void pool_run(SMOPS_CTX *ctx, SMOPS_INDEX n, SMOPS_INDEX grain, SCHEDULE schedule, POOL_TASK task, void *arg)
+{
+    if(n <= 0) {return;}
+    long *tasks = &ctx->phase_tasks[ctx->phase.kind];
+    POOL *pool = ctx->pool;
+    int workers = pool == NULL ? 1 : pool->workers;
+    if(ctx->phase.threads < workers) {workers = ctx->phase.threads;}
+    if(workers > 1 && grain <= 0) {
+        grain = schedule == SCHEDULE_STATIC ? (n + workers - 1)/workers
+            : n/((SMOPS_INDEX)workers*POOL_SPLITS_PER_WORKER);
+    }
+    if(grain < 1) {grain = 1;}
+
+    POOL_JOB job = { task, arg, grain, workers, schedule, n, n, 0, 0, NULL, 1, 0, 0 };
+    int slot = -1;
+    if(workers > 1 && n > grain) {
+        pthread_mutex_lock(&pool->lock);
+        slot = pool_start(pool, &job);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if(slot < 0) {
+        task(arg, 0, n, 0);
+        __atomic_add_fetch(tasks, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    pool_work(&job, 0);
+    pool_end(pool, &job, slot);
+    __atomic_add_fetch(tasks, job.tasks, __ATOMIC_RELAXED);
+}
+
+/** Runs task on the iterations 0 to n split into ranges between the workers of
+*   the pool of the ctx, handed out with the schedule of the ctx. By default
+*   every worker starts with an equal share in its deque and idle workers
+*   steal, so uneven iterations are balanced. Only the first threads of the
+*   phase of the ctx take part and a grain set for the phase replaces the grain
+*   of the loop. Loops of calls on the same pool run at the same time with the
+*   threads of the pool split between them. With one worker, or when every slot
+*   of the pool is taken, the task runs once on the whole range on the calling
+*   thread. Returns once every iteration has run, adding the ranges run to the
+*   tasks of the phase.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the pool, the schedule and the phase
+*       SMOPS_INDEX n: the number of iterations
+*       SMOPS_INDEX grain: ranges at most this long are not split, 0 picks one
+*                          giving every worker POOL_SPLITS_PER_WORKER ranges, or
+*                          one range for the static schedule
+*       POOL_TASK task: the task run on every range
+*       void *arg: the argument given to the task
+*/
+void POOL_parallel_for(SMOPS_CTX *ctx, SMOPS_INDEX n, SMOPS_INDEX grain, POOL_TASK task, void *arg)
+{
+    pool_run(ctx, n, ctx->phase.grain > 0 ? ctx->phase.grain : grain, ctx->schedule, task, arg);
+}
+
+/** Adds up the partial sums the workers of a parallel for left in sums
+*
+*   parameters:
+*       POOL_SUM *sums: the partial sum of every worker
+*       int workers: the number of workers
+*
+*   return:
+*       the total of both fields of the partial sums
+*/
+POOL_SUM POOL_reduce(POOL_SUM *sums, int workers)
+{
+    POOL_SUM total = { 0, 0 };
+    for(int w = 0; w < workers; w++) {
+        total.f += sums[w].f;
+        total.i += sums[w].i;
+    }
+    return total;
+}
+
+/** Arguments of pool_sum_task
+*   task: the task of the sum
+*   arg: the argument given to the task
+*   n: the number of iterations of the sum
+*/
+struct pool_sum_args {
+    POOL_TASK task;
+    void *arg;
+    SMOPS_INDEX n;
+};
+
+/** Runs the task of a reproducible sum on the blocks p to q, each block on its
+*   own so its partial sum only holds its own iterations
+*
+*   parameters:
+*       void *arg: the struct pool_sum_args
+*       SMOPS_INDEX p: the first block
+*       SMOPS_INDEX q: the block after the last block
+*       int worker: unused, the block is the slot the task adds to
+*/
+static void pool_sum_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct pool_sum_args *args = (struct pool_sum_args *)arg;
+    SMOPS_INDEX first, last;
+    for(SMOPS_INDEX b = p; b < q; b++) {
+        first = (SMOPS_INDEX)((int64_t)args->n*b/POOL_SUM_BLOCKS);
+        last = (SMOPS_INDEX)((int64_t)args->n*(b + 1)/POOL_SUM_BLOCKS);
+        if(last > first) {
+            args->task(args->arg, first, last, (int)b);
+        }
+    }
+}
+
+/** Gets the number of partial sums POOL_parallel_sum needs
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the threads and the reproducible flag
+*
+*   return:
+*       POOL_SUM_BLOCKS for reproducible sums, the number of threads otherwise
+*/
+int POOL_sum_slots(SMOPS_CTX *ctx)
+{
+    return ctx->reproducible ? POOL_SUM_BLOCKS : ctx->thread_num;
+}
+
+/** Runs a parallel for whose task adds to the partial sum sums[worker] and
+*   returns the total. Normally every worker has a partial sum. For reproducible
+*   sums the iterations are cut into POOL_SUM_BLOCKS blocks whose bounds only
+*   depend on n, the task is run once on every block adding to the partial sum
+*   of the block and the blocks are added in a pairwise tree, so the float total
+*   is the same whatever the threads, schedule or grain.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the pool and the reproducible flag
+*       SMOPS_INDEX n: the number of iterations
+*       SMOPS_INDEX grain: the grain of the loop, see POOL_parallel_for,
+*                          unused for reproducible sums
+*       POOL_TASK task: the task run on every range
+*       void *arg: the argument given to the task
+*       POOL_SUM *sums: the POOL_sum_slots partial sums the task adds to
+*
+*   return:
+*       the total of both fields of the partial sums
+*/
+POOL_SUM POOL_parallel_sum(SMOPS_CTX *ctx, SMOPS_INDEX n, SMOPS_INDEX grain, POOL_TASK task, void *arg, POOL_SUM *sums)
+{
+    int slots = POOL_sum_slots(ctx);
+    memset(sums, 0, sizeof(POOL_SUM)*slots);
+    if(ctx->reproducible == 0) {
+        POOL_parallel_for(ctx, n, grain, task, arg);
+        return POOL_reduce(sums, slots);
+    }
+    struct pool_sum_args args = { task, arg, n };
+    pool_run(ctx, POOL_SUM_BLOCKS, 1, ctx->schedule, pool_sum_task, &args);
+    for(int stride = 1; stride < slots; stride *= 2) {
+        for(int b = 0; b + stride < slots; b += 2*stride) {
+            sums[b].f += sums[b + stride].f;
+            sums[b].i += sums[b + stride].i;
+        }
+    }
+    return sums[0];
+}
+
+/** Splits the merge path of a CSR matrix into parts of equal length. The path
+*   walks the row ends ia[1] to ia[rows] and the non zero elements together, so
+*   every part holds the same number of rows plus non zero elements however the
+*   elements are spread over the rows, and a long row is split between parts.
+*   Part k runs from splits[k] to splits[k+1], the rows splits[k].row to
+*   splits[k+1].row - 1 end in it and the part of row splits[k+1].row in it is
+*   left over for the part ending that row. A reproducible run always has
+*   POOL_REPRODUCIBLE_PARTS parts, so the rows split between parts and the sums
+*   of their pieces do not depend on the threads.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for the threads of the phase and error handling
+*       CSR_DATA *csr: the CSR_DATA of the matrix, its offsets in either width
+*       int rows: the number of rows
+*       CSR_SPLIT **splits: where the splits are stored, freed by the caller
+*
+*   return:
+*       the number of parts, 0 if the splits could not be allocated filling error message
+*/
+int POOL_merge_path(SMOPS_CTX *ctx, CSR_DATA *csr, int rows, CSR_SPLIT **splits)
+{
+    SMOPS_INDEX nnz = CSR_ROW(csr, rows);
+    int64_t length = (int64_t)rows + nnz;
+    int64_t parts = ctx->reproducible ? POOL_REPRODUCIBLE_PARTS
+        : (int64_t)ctx->phase.threads*POOL_SPLITS_PER_WORKER;
+    if(parts > length) {parts = length;}
+    if(parts < 1) {parts = 1;}
+    *splits = (CSR_SPLIT *)malloc(sizeof(CSR_SPLIT)*(parts + 1));
+    if(*splits == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "failed to allocate memory for the merge path splits");
+        return 0;
+    }
+
+    int64_t diagonal, lo, hi, mid;
+    for(int64_t k = 0; k <= parts; k++) {
+        //The point on the diagonal is the first one whose row end comes after its non zero elements
+        diagonal = length*k/parts;
+        lo = diagonal - nnz > 0 ? diagonal - nnz : 0;
+        hi = diagonal < rows ? diagonal : rows;
+        while(lo < hi) {
+            mid = lo + (hi - lo)/2;
+            if(CSR_ROW(csr, mid + 1) <= diagonal - 1 - mid) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        (*splits)[k].row = (int)lo;
+        (*splits)[k].nz = (SMOPS_INDEX)(diagonal - lo);
+    }
+    return (int)parts;
+}
+
+/** Reads the first two numbers of a file, used for the cgroup and topology files
+*
+*   parameters:
+*       char *path: the file to read
+*       char *format: the scanf format of the numbers
+*       long *a: where the first number is stored
+*       long *b: where the second number is stored
+*
+*   return:
+*       the number of numbers read, 0 if the file could not be read
+*/
+static int pool_read_pair(char *path, char *format, long *a, long *b)
+{
+    FILE *file = fopen(path, "r");
+    if(file == NULL) {return 0;}
+    int read = fscanf(file, format, a, b);
+    fclose(file);
+    return read > 0 ? read : 0;
+}
+
+/** Gets the number of CPUs the cgroup quota of the process pays for, rounded up.
+*   cgroup v2 keeps the quota and period in cpu.max, v1 in two files.
+*
+*   return:
+*       the CPUs of the quota, 0 if there is no quota
+*/
+static int pool_cgroup_cpus()
+{
+    long quota = 0, period = 0;
+    if(pool_read_pair(POOL_CGROUP2_CPU, "%ld %ld", &quota, &period) != 2) {
+        //cpu.max holds "max <period>" when there is no quota, which reads nothing
+        quota = 0;
+        if(pool_read_pair(POOL_CGROUP1_QUOTA, "%ld", &quota, &period) == 0
+            || pool_read_pair(POOL_CGROUP1_PERIOD, "%ld", &period, &period) == 0) {return 0;}
+    }
+    if(quota <= 0 || period <= 0) {return 0;}
+    return (int)((quota + period - 1)/period);
+}
+
+/** Reads a sysfs CPU list such as "0,4" or "0-3,8-11" into a CPU set
+*
+*   parameters:
+*       char *path: the file with the list
+*       cpu_set_t *set: where the CPUs are stored
+*
+*   return:
+*       the number of CPUs in the list, 0 if the file could not be read
+*/
+static int pool_read_cpulist(char *path, cpu_set_t *set)
+{
+    long first = 0, last = 0;
+    CPU_ZERO(set);
+    FILE *file = fopen(path, "r");
+    if(file == NULL) {return 0;}
+    char sep = ',';
+    while(sep == ',' && fscanf(file, "%ld", &first) == 1) {
+        last = first;
+        if(fscanf(file, "%c", &sep) == 1 && sep == '-') {
+            if(fscanf(file, "%ld%c", &last, &sep) < 1) {break;}
+        }
+        for(long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, set);
+        }
+    }
+    fclose(file);
+    return CPU_COUNT(set);
+}
+
+/** Gets the number of threads worth running on this machine: the CPUs the
+*   process may run on, capped by the cgroup quota and by the physical cores.
+*   The kernels are memory bound, so a second hardware thread on a core adds
+*   little and only makes the threads wait longer on each other.
+*
+*   return:
+*       the number of threads, at least 1
+*/
+int POOL_cpu_count()
+{
+    cpu_set_t set;
+    int cpus = 0;
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0) {
+        cpus = CPU_COUNT(&set);
+    }
+    if(cpus <= 0) {
+        cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if(cpus <= 0) {return 1;}
+    char path[POOL_PATH_SIZE];
+    snprintf(path, POOL_PATH_SIZE, POOL_CPU_SIBLINGS, 0);
+    int width = pool_read_cpulist(path, &set);
+    int cores = cpus/(width > 0 ? width : 1);
+    if(cores >= 1 && cores < cpus) {cpus = cores;}
+    int quota = pool_cgroup_cpus();
+    if(quota >= 1 && quota < cpus) {cpus = quota;}
+    return cpus;
+}
+
+/** Orders CPUs compactly: by node, the first hardware thread of every core
+*   before the second, then by number
+*
+*   parameters:
+*       const void *a: the first POOL_CPU
+*       const void *b: the second POOL_CPU
+*
+*   return:
+*       the order of a and b for qsort
+*/
+static int pool_cpu_compact(const void *a, const void *b)
+{
+    const POOL_CPU *x = (const POOL_CPU *)a;
+    const POOL_CPU *y = (const POOL_CPU *)b;
+    if(x->node != y->node) {return x->node < y->node ? -1 : 1;}
+    if(x->secondary != y->secondary) {return x->secondary < y->secondary ? -1 : 1;}
+    return x->cpu < y->cpu ? -1 : x->cpu > y->cpu;
+}
+
+/** Orders CPUs scattered: by their rank in the compact order of their node,
+*   then by node, so consecutive workers go to different nodes
+*
+*   parameters:
+*       const void *a: the first POOL_CPU
+*       const void *b: the second POOL_CPU
+*
+*   return:
+*       the order of a and b for qsort
+*/
+static int pool_cpu_scatter(const void *a, const void *b)
+{
+    const POOL_CPU *x = (const POOL_CPU *)a;
+    const POOL_CPU *y = (const POOL_CPU *)b;
+    if(x->rank != y->rank) {return x->rank < y->rank ? -1 : 1;}
+    return x->node < y->node ? -1 : x->node > y->node;
+}
+
+/** Lists the CPUs the pool may run on in the order workers are pinned to them.
+*   The node of every CPU is read from sysfs, a machine without node
+*   information is one node.
+*
+*   parameters:
+*       POOL *pool: the pool with the CPUs it may run on
+*       AFFINITY affinity: the placement, compact or scatter
+*       POOL_CPU *cpus: where the CPUs are stored, CPU_SETSIZE entries
+*
+*   return:
+*       the number of CPUs
+*/
+static int pool_cpu_order(POOL *pool, AFFINITY affinity, POOL_CPU *cpus)
+{
+    char path[POOL_PATH_SIZE];
+    cpu_set_t node_sets[POOL_MAX_NODES], siblings;
+    int node_count = 0;
+    for(; node_count < POOL_MAX_NODES; node_count++) {
+        snprintf(path, POOL_PATH_SIZE, POOL_NODE_CPUS, node_count);
+        if(pool_read_cpulist(path, &node_sets[node_count]) == 0) {break;}
+    }
+
+    int n = 0;
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if(CPU_ISSET(cpu, &pool->allowed) == 0) {continue;}
+        cpus[n].cpu = cpu;
+        cpus[n].node = 0;
+        for(int node = 0; node < node_count; node++) {
+            if(CPU_ISSET(cpu, &node_sets[node])) {
+                cpus[n].node = node;
+                break;
+            }
+        }
+        snprintf(path, POOL_PATH_SIZE, POOL_CPU_SIBLINGS, cpu);
+        cpus[n].secondary = 0;
+        if(pool_read_cpulist(path, &siblings) > 1) {
+            for(int other = 0; other < cpu; other++) {
+                if(CPU_ISSET(other, &siblings)) {
+                    cpus[n].secondary = 1;
+                    break;
+                }
+            }
+        }
+        n++;
+    }
+
+    qsort(cpus, n, sizeof(POOL_CPU), pool_cpu_compact);
+    for(int k = 0; k < n; k++) {
+        cpus[k].rank = k > 0 && cpus[k].node == cpus[k-1].node ? cpus[k-1].rank + 1 : 0;
+    }
+    if(affinity == AFFINITY_SCATTER) {
+        qsort(cpus, n, sizeof(POOL_CPU), pool_cpu_scatter);
+    }
+    return n;
+}
+
+/** Pins the workers of a pool to CPUs. Compact placement puts consecutive
+*   workers on neighbouring cores of one node, scatter spreads them over the
+*   nodes. Worker 0 is the thread calling this, which is the thread calling
+*   parallel for. AFFINITY_NONE lets every worker run on any allowed CPU again.
+*
+*   parameters:
+*       POOL *pool: the pool
+*       AFFINITY affinity: the placement
+*
+*   return:
+*       1 if every worker was pinned, 0 otherwise
+*/
+int POOL_pin(POOL *pool, AFFINITY affinity)
+{
+    POOL_CPU *cpus = (POOL_CPU *)malloc(sizeof(POOL_CPU)*CPU_SETSIZE);
+    if(cpus == NULL) {return 0;}
+    int n = affinity == AFFINITY_NONE ? 0 : pool_cpu_order(pool, affinity, cpus);
+    if(affinity != AFFINITY_NONE && n == 0) {
+        free(cpus);
+        return 0;
+    }
+
+    cpu_set_t set;
+    pthread_t thread;
+    int pinned = 1, node_seen[POOL_MAX_NODES] = { 0 };
+    pool->nodes = 0;
+    for(int w = 0; w < pool->workers; w++) {
+        set = pool->allowed;
+        pool->cpus[w] = -1;
+        if(n > 0) {
+            CPU_ZERO(&set);
+            CPU_SET(cpus[w % n].cpu, &set);
+            pool->cpus[w] = cpus[w % n].cpu;
+            if(node_seen[cpus[w % n].node]++ == 0) {pool->nodes++;}
+        }
+        thread = w == 0 ? pthread_self() : pool->threads[w];
+        if(pthread_setaffinity_np(thread, sizeof(cpu_set_t), &set) != 0) {pinned = 0;}
+    }
+    pool->affinity = affinity;
+    free(cpus);
+    return pinned;
+}
+
+/** Describes where the workers of a pool are pinned for the plan report
+*
+*   parameters:
+*       POOL *pool: the pool
+*       char *line: where the description is stored
+*       int size: the size of line
+*/
+void POOL_placement(POOL *pool, char *line, int size)
+{
+    char *affinity_to_string[] = AFFINITY_MAP_STRING;
+    int len = snprintf(line, size, "plan: affinity %s", affinity_to_string[pool->affinity]);
+    if(pool->affinity == AFFINITY_NONE) {return;}
+    len += snprintf(line + len, len < size ? size - len : 0, " on %d node%s, cpus",
+        pool->nodes, pool->nodes == 1 ? "" : "s");
+    for(int w = 0; w < pool->workers && len < size; w++) {
+        len += snprintf(line + len, size - len, " %d", pool->cpus[w]);
+    }
+}
+
+/** Arguments of pool_touch_task */
+struct pool_touch_args {
+    char *buffer;
+    size_t bytes;
+};
+
+/** Zeroes the pages p to q of a buffer
+*
+*   parameters:
+*       void *arg: the struct pool_touch_args
+*       SMOPS_INDEX p: the first page
+*       SMOPS_INDEX q: the page after the last page
+*       int worker: unused
+*/
+static void pool_touch_task(void *arg, SMOPS_INDEX p, SMOPS_INDEX q, int worker)
+{
+    struct pool_touch_args *args = (struct pool_touch_args *)arg;
+    size_t start = (size_t)p*POOL_PAGE;
+    size_t end = (size_t)q*POOL_PAGE < args->bytes ? (size_t)q*POOL_PAGE : args->bytes;
+    memset(args->buffer + start, 0, end - start);
+}
+
+/** Allocates a zeroed array like calloc. A large array is zeroed by the workers
+*   of the phase, worker w touching the w-th share of its pages first, so with
+*   first touch placement every page lands on the node of the worker that
+*   starts with the matching share of rows in a parallel for.
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX with the pool and the phase
+*       size_t count: the number of elements
+*       size_t size: the size of an element
+*
+*   return:
+*       the zeroed array, NULL if it could not be allocated or count*size overflows
+*/
+void *POOL_calloc(SMOPS_CTX *ctx, size_t count, size_t size)
+{
+    if(size != 0 && count > SIZE_MAX/size) {return NULL;}
+    size_t bytes = count*size;
+    if(bytes < POOL_FIRST_TOUCH_MIN) {return calloc(count, size);}
+    char *buffer = (char *)malloc(bytes);
+    if(buffer == NULL) {return NULL;}
+    struct pool_touch_args args = { buffer, bytes };
+    pool_run(ctx, (SMOPS_INDEX)((bytes + POOL_PAGE - 1)/POOL_PAGE), 0, SCHEDULE_STATIC, pool_touch_task, &args);
+    return buffer;
+}
@@ -1,3 +1,5 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -10,6 +12,7 @@
 #define TIME_FORMAT "%d%m%Y_%H%M_"
 #define TIME_LEN 14
 #define FILE_SUFFIX ".out\0"
+#define PLACEMENT_SIZE 256
 
 char *get_log_filename(SMOPS_CTX *ctx, char *op_string)
 {
@@ -20,13 +23,14 @@ char *get_log_filename(SMOPS_CTX *ctx, char *op_string)
     }
     char *filename = (char *)calloc(BUF_SIZE, sizeof(char));
     char *ptr = filename;
-    strncpy(ptr, log_prefix, BUF_SIZE);
+    strncpy(ptr, log_prefix, BUF_SIZE - 1);
     ptr += strlen(log_prefix);
 
     time_t time_d;
     time(&time_d);
-    struct tm *time_done = localtime( &time_d);
-    strftime(ptr, BUF_SIZE - (ptr - filename), TIME_FORMAT, time_done);
+    struct tm time_done;
+    localtime_r(&time_d, &time_done);
+    strftime(ptr, BUF_SIZE - (ptr - filename), TIME_FORMAT, &time_done);
     ptr += TIME_LEN;
 
     strncpy(ptr, op_string, BUF_SIZE - (ptr - filename));
@@ -71,15 +75,15 @@ int display_results(SMOPS_CTX *ctx, FILE *fp, char *filename_a, char *filename_b
             //RESULT_DATA dense_matrix = result->result_data;
             fprintf(fp, "%s\n", type_to_string[result->type]);
             fprintf(fp, "%d\n%d\n", result->rows, result->cols);
-            int size = result->rows*result->cols;
+            size_t size = (size_t)result->rows*result->cols;
             switch(result->type) {
                 case INT:
-                    for(int i = 0; i < size; i++) {
+                    for(size_t i = 0; i < size; i++) {
                         fprintf(fp, "%d ", result->result_data.matrix[i].i);
                     }
                     break;
                 case FLOAT:
-                    for(int i = 0; i < size; i++) {
+                    for(size_t i = 0; i < size; i++) {
                         fprintf(fp, "%f ", result->result_data.matrix[i].f);
                     }
                     break;
@@ -90,6 +94,18 @@ int display_results(SMOPS_CTX *ctx, FILE *fp, char *filename_a, char *filename_b
             fprintf(fp, "\n");
             break;
     }
+    fprintf(fp, "%s", ctx->plan_report);
+    fprintf(fp, "plan: tasks load %ld convert %ld op %ld\n", ctx->phase_tasks[PHASE_LOAD],
+        ctx->phase_tasks[PHASE_CONVERT], ctx->phase_tasks[PHASE_OP]);
+    if(ctx->affinity != AFFINITY_NONE) {
+        char placement[PLACEMENT_SIZE];
+        POOL_placement(ctx->pool, placement, PLACEMENT_SIZE);
+        fprintf(fp, "%s\n", placement);
+    }
+    if(ctx->flop_count > 0 && ctx->time_op > 0) {
+        fprintf(fp, "%f GFLOP/s\n", ctx->flop_count/ctx->time_op/BILLION);
+        fprintf(fp, "%f GB/s\n", ctx->byte_count/ctx->time_op/BILLION);
+    }
     fprintf(fp, "%f\n%f\n", ctx->time_load, ctx->time_op);
     return 1;
 }
@@ -249,9 +265,33 @@ int SMOPS_RESULT_save_coo_matrix_result(SMOPS_CTX *ctx, MATRIX *result)
     }
     int rows = result->rows;
     int cols = result->cols;
-    int non_zero_size = result->non_zero_size;
+    SMOPS_INDEX non_zero_size = result->non_zero_size;
 
     MATRIX_DATA *dense_matrix = COO_to_dense(ctx, result->coo_data, rows, cols, non_zero_size);
     if(dense_matrix == NULL) {return 0;}
     return SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, result->type, rows, cols);
 }
+
+/** Saves the result of the operation of the form of a sparse matrix of format DIA to the SMOPS_CTX
+*
+*   parameters:
+*       SMOPS_CTX *ctx: the SMOPS_CTX for errror handling and saving the result
+*       MATRIX *result: the result sparse matrix of format DIA to save
+*
+*   return:
+*       1 if executed successfully, 0 otherwise filling error message
+*/
+int SMOPS_RESULT_save_dia_matrix_result(SMOPS_CTX *ctx, MATRIX *result)
+{
+    if(result == NULL) {
+        SMOPS_CTX_fill_err_msg(ctx, "no result matrix has been passed as result");
+        return 0;
+    }
+    if(result->format != DIA) {
+        SMOPS_CTX_fill_err_msg(ctx, "result matrix does not have DIA format or data");
+        return 0;
+    }
+    MATRIX_DATA *dense_matrix = DIA_to_dense(ctx, result->dia_data, result->rows, result->cols);
+    if(dense_matrix == NULL) {return 0;}
+    return SMOPS_RESULT_save_matrix_result(ctx, dense_matrix, result->type, result->rows, result->cols);
+}
@@ -1,11 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <getopt.h>
 
 #include "lib/smops.h"
 
-#define OPTLIST "t:lf:"
+#define OPTLIST "t:lf:d:s:g:a:r"
 #define LOGPREFIX "21955725_\0"
 
 struct filenames {
@@ -24,19 +25,56 @@ void usage(char *progam_name)
     printf("\t--tr: Calculate the Trace of the input matrix\n");
     printf("\t--ad: Add two matrices together specifed by the -f option\n");
     printf("\t--ts: Calculate the Transpose of the input matrix\n");
-    printf("\t--mm: Multiply two matrices specified by the -f option\n\n");
+    printf("\t--mm: Multiply two matrices specified by the -f option\n");
+    printf("\t--tp: Calculate the Trace of the product of the two matrices specified by the -f option\n");
+    printf("\t--ip: Calculate the Frobenius inner product of the two matrices specified by the -f option\n");
+    printf("\t--su: Calculate the Sum of all elements of the input matrix\n");
+    printf("\t--mv: Multiply the input matrix by the vector (one column matrix) in the optional file\n");
+    printf("\t--mb: Multiply the input matrix by the dense block of vectors in the optional file\n");
+    printf("\t--tv: Multiply the transpose of the input matrix by the vector in the optional file\n\n");
     printf("options:\n");
     printf("\t-t [number of threads]: How many threads should be used, runs sequentially if 1\n");
-    printf("\t-l: Results will be logged to file\n\n");
+    printf("\t   auto picks them from the CPUs, cgroup quota and cores, and the work of each phase\n");
+    printf("\t-l: Results will be logged to file\n");
+    printf("\t-d [density]: Density at or above which ad and mm use dense matrices, above 1 disables\n");
+    printf("\t-s [schedule]: How parallel loops hand out iterations: steal (default), static, dynamic or guided\n");
+    printf("\t-g [grain]: Iterations per task in the parallel loops of the operation, 0 lets each loop pick\n");
+    printf("\t-a [affinity]: How threads are pinned to CPUs: none (default), compact or scatter over NUMA nodes\n");
+    printf("\t-r: Reproducible float results, the same bit for bit for any number of threads\n\n");
     printf("matrix input: -f [file] [optional file]\n");
     printf("\tfile: file name of the input matrix\n");
-    printf("\toptional file: file name of the other input matrix for ad and mm\n");
+    printf("\toptional file: file name of the other input matrix for ad, mm, tp, ip, mv, mb and tv\n");
+}
+
+int parse_schedule(SMOPS_CTX *ctx, char *name)
+{
+    char *schedule_to_string[] = SCHEDULE_MAP_STRING;
+    for(int s = SCHEDULE_STEAL; s <= SCHEDULE_GUIDED; s++) {
+        if(strcmp(name, schedule_to_string[s]) == 0) {
+            return SMOPS_CTX_set_schedule(ctx, (SCHEDULE) s);
+        }
+    }
+    SMOPS_CTX_fill_err_msg(ctx, "unknown schedule");
+    return 0;
+}
+
+int parse_affinity(SMOPS_CTX *ctx, char *name)
+{
+    char *affinity_to_string[] = AFFINITY_MAP_STRING;
+    for(int a = AFFINITY_NONE; a <= AFFINITY_SCATTER; a++) {
+        if(strcmp(name, affinity_to_string[a]) == 0) {
+            return SMOPS_CTX_set_affinity(ctx, (AFFINITY) a);
+        }
+    }
+    SMOPS_CTX_fill_err_msg(ctx, "unknown affinity");
+    return 0;
 }
 
 int parse_opts(SMOPS_CTX *ctx, FILENAMES *filenames, double *sm_arg, int argc, char **argv)
 {
     int opt, index;
     int op_flag_temp = NO_OP;
+    long grain = 0;
     filenames->file_name1 = NULL;
     filenames->file_name2 = NULL;
 
@@ -46,19 +84,50 @@ int parse_opts(SMOPS_CTX *ctx, FILENAMES *filenames, double *sm_arg, int argc, c
         {"ad", no_argument, &op_flag_temp, ADD},
         {"ts", no_argument, &op_flag_temp, TRANSPOSE},
         {"mm", no_argument, &op_flag_temp, MATRIX_MULT},
+        {"tp", no_argument, &op_flag_temp, TRACE_PRODUCT},
+        {"ip", no_argument, &op_flag_temp, INNER_PRODUCT},
+        {"su", no_argument, &op_flag_temp, ELEMENT_SUM},
+        {"mv", no_argument, &op_flag_temp, MATRIX_VECTOR_MULT},
+        {"mb", no_argument, &op_flag_temp, MATRIX_BLOCK_MULT},
+        {"tv", no_argument, &op_flag_temp, TRANSPOSE_VECTOR_MULT},
         {   0, no_argument, 0, 0},
     };
 
     while ((opt = getopt_long(argc, argv, OPTLIST, long_optlist, NULL)) != -1) {
         switch (opt) {
             case 't':
-                if(SMOPS_CTX_set_thread_num(ctx, atoi(optarg)) == 0) {
+                if(strcmp(optarg, "auto") == 0) {
+                    if(SMOPS_CTX_set_thread_auto(ctx) == 0) {
+                        return 0;
+                    }
+                } else if(SMOPS_CTX_set_thread_num(ctx, atoi(optarg)) == 0) {
                     return 0;
                 }
                 break;
             case 'l':
                 SMOPS_CTX_set_log(ctx, 1);
                 break;
+            case 'd':
+                if(SMOPS_CTX_set_dense_threshold(ctx, atof(optarg)) == 0) {
+                    return 0;
+                }
+                break;
+            case 's':
+                if(parse_schedule(ctx, optarg) == 0) {
+                    return 0;
+                }
+                break;
+            case 'g':
+                grain = atol(optarg);
+                break;
+            case 'a':
+                if(parse_affinity(ctx, optarg) == 0) {
+                    return 0;
+                }
+                break;
+            case 'r':
+                SMOPS_CTX_set_reproducible(ctx, 1);
+                break;
             case 'f':
                 filenames->file_name1 = optarg;
                 index = optind;
@@ -81,7 +150,7 @@ int parse_opts(SMOPS_CTX *ctx, FILENAMES *filenames, double *sm_arg, int argc, c
     }
 
     SMOPS_CTX_set_operation(ctx, (OPERATION) op_flag_temp);
-    return 1;
+    return SMOPS_CTX_set_grain(ctx, (OPERATION) op_flag_temp, (SMOPS_INDEX) grain);
 }
 
 void smops_exit(SMOPS_CTX *ctx, MATRIX *a, MATRIX *b, MATRIX *c)
@@ -90,14 +159,15 @@ void smops_exit(SMOPS_CTX *ctx, MATRIX *a, MATRIX *b, MATRIX *c)
         SMOPS_CTX_print_err(ctx);
         SMOPS_CTX_free(ctx);
     }
-    if(a != NULL) MATRIX_free(a);
     if(b != NULL) MATRIX_free(b);
+    if(a != NULL) MATRIX_free(a);
     if(c != NULL) MATRIX_free(c);;
 }
 
 int main(int argc, char **argv)
 {
     double sm_arg;
+    MATRIX_DATA result_num;
     SMOPS_CTX *ctx = SMOPS_CTX_new();
     if(ctx == NULL) {
         fprintf(stderr, "Could not make SMOPS_CTX for controlling operation\n");
@@ -146,14 +216,19 @@ int main(int argc, char **argv)
             MATRIX_OP_scalar_multiplication(ctx, result, a, sm_arg);
             break;
         case TRACE:
+        case ELEMENT_SUM:
             if(MATRIX_load(ctx, a, filenames.file_name1) == 0) {
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
-            MATRIX_DATA result_num;
-            MATRIX_OP_trace(ctx, &result_num, a);
+            if(SMOPS_CTX_get_operation(ctx) == TRACE) {
+                MATRIX_OP_trace(ctx, &result_num, a);
+            } else {
+                MATRIX_OP_sum(ctx, &result_num, a);
+            }
             break;
         case ADD:
+        case INNER_PRODUCT:
             if(filenames.file_name2 == NULL) {
                 SMOPS_CTX_fill_err_msg(ctx, "no second file provided as input");
                 smops_exit(ctx, a, b, result);
@@ -165,19 +240,15 @@ int main(int argc, char **argv)
                 exit(EXIT_FAILURE);
             }
 
-            if(MATRIX_preload_type(ctx, a, filenames.file_name1, b, filenames.file_name2) == 0) {
-                smops_exit(ctx, a, b, result);
-                exit(EXIT_FAILURE);
-            }
-            if(MATRIX_load(ctx, a, filenames.file_name1) == 0) {
+            if(MATRIX_load_pair(ctx, a, filenames.file_name1, b, filenames.file_name2) == 0) {
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
-            if(MATRIX_load(ctx, b, filenames.file_name2) == 0) {
-                smops_exit(ctx, a, b, result);
-                exit(EXIT_FAILURE);
+            if(SMOPS_CTX_get_operation(ctx) == ADD) {
+                MATRIX_OP_addition(ctx, a, b);
+            } else {
+                MATRIX_OP_inner_product(ctx, &result_num, a, b);
             }
-            MATRIX_OP_addition(ctx, a, b);
             break;
         case TRANSPOSE:
             if(MATRIX_load(ctx, a, filenames.file_name1) == 0) {
@@ -187,6 +258,7 @@ int main(int argc, char **argv)
             MATRIX_OP_transpose(ctx, result, a);
             break;
         case MATRIX_MULT:
+        case TRACE_PRODUCT:
             if(filenames.file_name2 == NULL) {
                 SMOPS_CTX_fill_err_msg(ctx, "no second file provided as input");
                 smops_exit(ctx, a, b, result);
@@ -198,25 +270,49 @@ int main(int argc, char **argv)
                 exit(EXIT_FAILURE);
             }
 
-            if(MATRIX_preload_type(ctx, a, filenames.file_name1, b, filenames.file_name2) == 0) {
+            if(MATRIX_change_format(ctx, b, CSC) == 0) {
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
-
-            if(MATRIX_change_format(ctx, b, CSC) == 0) {
+            if(MATRIX_load_pair(ctx, a, filenames.file_name1, b, filenames.file_name2) == 0) {
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
-            if(MATRIX_load(ctx, b, filenames.file_name2) == 0) {
+            if(SMOPS_CTX_get_operation(ctx) == MATRIX_MULT) {
+                MATRIX_OP_multiplication(ctx, a, b);
+            } else {
+                MATRIX_OP_trace_product(ctx, &result_num, a, b);
+            }
+            break;
+        case MATRIX_VECTOR_MULT:
+        case MATRIX_BLOCK_MULT:
+        case TRANSPOSE_VECTOR_MULT:
+            if(filenames.file_name2 == NULL) {
+                SMOPS_CTX_fill_err_msg(ctx, "no vector file provided as input");
+                smops_exit(ctx, a, b, result);
+                usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+            if((b = MATRIX_new(ctx)) == NULL){
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
 
-            if(MATRIX_load(ctx, a, filenames.file_name1) == 0) {
+            if(MATRIX_change_format(ctx, b, DENSE) == 0) {
                 smops_exit(ctx, a, b, result);
                 exit(EXIT_FAILURE);
             }
-            MATRIX_OP_multiplication(ctx, a, b);
+            if(MATRIX_load_pair(ctx, a, filenames.file_name1, b, filenames.file_name2) == 0) {
+                smops_exit(ctx, a, b, result);
+                exit(EXIT_FAILURE);
+            }
+            if(SMOPS_CTX_get_operation(ctx) == MATRIX_VECTOR_MULT) {
+                MATRIX_OP_spmv(ctx, a, b);
+            } else if(SMOPS_CTX_get_operation(ctx) == TRANSPOSE_VECTOR_MULT) {
+                MATRIX_OP_transpose_spmv(ctx, a, b);
+            } else {
+                MATRIX_OP_spmm(ctx, a, b);
+            }
             break;
         default:
             break;
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../src/lib/smops.h"
+
+/* Chains asynchronous loads and operations on the thread pool through after,
+*  checking that a call held back by the call it waits for polls as not done,
+*  that waiting runs it to the right result and that a failed load skips every
+*  call after it, with and without pool threads.
+*/
+
+#define MISSING_FILE "test/missing.in"
+
+struct gate {
+    pthread_mutex_t lock;
+    pthread_cond_t opened;
+    int open;
+};
+
+struct gate_args {
+    struct gate *gate;
+    int *runs;
+};
+
+int gate_job(SMOPS_CTX *ctx, void *arg)
+{
+    struct gate_args *args = (struct gate_args *)arg;
+    __atomic_add_fetch(args->runs, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&args->gate->lock);
+    while(args->gate->open == 0) {
+        pthread_cond_wait(&args->gate->opened, &args->gate->lock);
+    }
+    pthread_mutex_unlock(&args->gate->lock);
+    return 1;
+}
+
+void open_gate(struct gate *gate)
+{
+    pthread_mutex_lock(&gate->lock);
+    gate->open = 1;
+    pthread_cond_broadcast(&gate->opened);
+    pthread_mutex_unlock(&gate->lock);
+}
+
+int check(int ok, char *what, int threads)
+{
+    if(ok == 0) {
+        printf("%d threads: %s\n", threads, what);
+    }
+    return ok == 0;
+}
+
+int run_chain(char *filename, int threads, double expected)
+{
+    SMOPS_CTX *ctx = SMOPS_CTX_new();
+    SMOPS_CTX_set_thread_num(ctx, threads);
+    SMOPS_CTX_set_operation(ctx, TRACE);
+    MATRIX *matrix = MATRIX_new(ctx);
+    MATRIX *missing = MATRIX_new(ctx);
+    struct gate gate = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 };
+    int gate_runs = 0, skipped_runs = 0, failed = 0;
+    struct gate_args gate_args = { &gate, &gate_runs };
+    struct gate_args skipped_args = { &gate, &skipped_runs };
+    MATRIX_DATA trace, missing_trace;
+
+    //load -> gate -> trace, the trace cannot finish before the gate opens
+    SMOPS_FUTURE *load = MATRIX_load_async(ctx, matrix, filename);
+    SMOPS_FUTURE *held = SMOPS_async(ctx, gate_job, &gate_args, sizeof(gate_args), &load, 1);
+    SMOPS_FUTURE *op = MATRIX_OP_async(ctx, TRACE, NULL, &trace, matrix, NULL, 0, &held, 1);
+    //missing load -> trace -> gate, both skipped
+    SMOPS_FUTURE *bad = MATRIX_load_async(ctx, missing, MISSING_FILE);
+    SMOPS_FUTURE *bad_op = MATRIX_OP_async(ctx, TRACE, NULL, &missing_trace, missing, NULL, 0, &bad, 1);
+    SMOPS_FUTURE *bad_next = SMOPS_async(ctx, gate_job, &skipped_args, sizeof(skipped_args), &bad_op, 1);
+    if(load == NULL || held == NULL || op == NULL || bad == NULL || bad_op == NULL || bad_next == NULL) {
+        SMOPS_CTX_print_err(ctx);
+        open_gate(&gate);
+        return 1;
+    }
+
+    failed += check(SMOPS_FUTURE_wait(load), "load failed", threads);
+    failed += check(SMOPS_FUTURE_poll(op) == 0, "trace finished before the call it waits for", threads);
+    failed += check(SMOPS_FUTURE_poll(held) == 0, "held call finished with the gate closed", threads);
+    open_gate(&gate);
+    failed += check(SMOPS_FUTURE_wait(op), "trace failed", threads);
+    failed += check(SMOPS_FUTURE_poll(op) && SMOPS_FUTURE_poll(held), "waited calls not done", threads);
+    failed += check(fabs(trace.f - expected) <= 1e-9*(1 + fabs(expected)), "wrong trace", threads);
+    failed += check(gate_runs == 1, "held call did not run once", threads);
+
+    failed += check(SMOPS_FUTURE_wait(bad_next) == 0, "call after a failed load succeeded", threads);
+    failed += check(SMOPS_FUTURE_wait(bad_op) == 0, "trace of a failed load succeeded", threads);
+    failed += check(SMOPS_FUTURE_wait(bad) == 0, "load of a missing file succeeded", threads);
+    failed += check(skipped_runs == 0, "call after a failed load ran", threads);
+    failed += check(ctx->err == 1, "failure not merged into the ctx", threads);
+
+    //A call made after the call it waits for has already failed is skipped as well
+    SMOPS_FUTURE *late = SMOPS_async(ctx, gate_job, &skipped_args, sizeof(skipped_args), &bad, 1);
+    failed += check(late != NULL && SMOPS_FUTURE_wait(late) == 0 && skipped_runs == 0,
+        "call made after a failed load ran", threads);
+
+    if(late != NULL) SMOPS_FUTURE_free(late);
+    SMOPS_FUTURE_free(bad_next);
+    SMOPS_FUTURE_free(bad_op);
+    SMOPS_FUTURE_free(bad);
+    SMOPS_FUTURE_free(op);
+    SMOPS_FUTURE_free(held);
+    SMOPS_FUTURE_free(load);
+    MATRIX_free(matrix);
+    MATRIX_free(missing);
+    SMOPS_CTX_free(ctx);
+    printf("%d threads: %d checks failed\n", threads, failed);
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        printf("Usage: %s [float matrix file]\n", argv[0]);
+        return 1;
+    }
+    SMOPS_CTX *ctx = SMOPS_CTX_new();
+    MATRIX *matrix = MATRIX_new(ctx);
+    MATRIX_DATA expected;
+    SMOPS_CTX_set_operation(ctx, TRACE);
+    if(MATRIX_load(ctx, matrix, argv[1]) == 0 || matrix->type != FLOAT
+        || MATRIX_OP_trace(ctx, &expected, matrix) == 0) {
+        printf("failed to take the trace of %s as a float matrix\n", argv[1]);
+        return 1;
+    }
+    MATRIX_free(matrix);
+    SMOPS_CTX_free(ctx);
+
+    int failed = run_chain(argv[1], 1, expected.f);
+    failed += run_chain(argv[1], 4, expected.f);
+    return failed > 0;
+}
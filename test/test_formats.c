@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../src/lib/smops.h"
+
+/* Loads a matrix for an operation, converts it to every format that has an
+*  engine for the operation with MATRIX_convert, whatever the planner would
+*  pick, and checks the result against the one worked out from its COO_DATA,
+*  with and without pool threads.
+*/
+
+#define FORMAT_SCALAR 2.5
+
+struct format_case {
+    OPERATION op;
+    MATRIX_FORMAT format;
+};
+
+double weight(long pos)
+{
+    return pos%7 + 1;
+}
+
+double dense_checksum(RESULT *result)
+{
+    double checksum = 0;
+    for(long pos = 0; pos < (long)result->rows*result->cols; pos++) {
+        checksum += result->result_data.matrix[pos].f*weight(pos);
+    }
+    return checksum;
+}
+
+double expected_value(MATRIX *matrix, OPERATION op)
+{
+    COO_DATA *coo = matrix->coo_data;
+    double expected = 0;
+    long i, j;
+    for(SMOPS_INDEX n = 0; n < matrix->non_zero_size; n++) {
+        i = coo->coords_i[n];
+        j = coo->coords_j[n];
+        switch(op) {
+            case TRACE:
+                expected += i == j ? coo->values[n].f : 0;
+                break;
+            case TRANSPOSE:
+                expected += coo->values[n].f*weight(j*matrix->rows + i);
+                break;
+            case SCALAR_MULT:
+                expected += FORMAT_SCALAR*coo->values[n].f*weight(i*matrix->cols + j);
+                break;
+            case ADD:
+                expected += 2*coo->values[n].f*weight(i*matrix->cols + j);
+                break;
+            default:
+                //y = A*x with x[j] = weight(j), weighted by row
+                expected += coo->values[n].f*weight(j)*weight(i);
+                break;
+        }
+    }
+    return expected;
+}
+
+/** Builds the dense vector x[j] = weight(j) of the matrix vector multiplication */
+MATRIX *weight_vector(SMOPS_CTX *ctx, int rows)
+{
+    MATRIX *vector = MATRIX_new(ctx);
+    if(vector == NULL || MATRIX_set_properties(ctx, vector, DENSE, FLOAT, rows, 1, rows) == 0) {return NULL;}
+    vector->dense_data->values = (MATRIX_DATA *)malloc(sizeof(MATRIX_DATA)*rows);
+    if(vector->dense_data->values == NULL) {return NULL;}
+    for(int j = 0; j < rows; j++) {
+        vector->dense_data->values[j].f = weight(j);
+    }
+    return vector;
+}
+
+/** Loads the matrix for the operation of the case and forces it into its format */
+MATRIX *load_format(SMOPS_CTX *ctx, char *filename, MATRIX_FORMAT format)
+{
+    MATRIX *matrix = MATRIX_new(ctx);
+    if(matrix == NULL || MATRIX_load(ctx, matrix, filename) == 0) {return NULL;}
+    if(format == BCSR && matrix->stats.bcsr_block == 0) {
+        matrix->stats.bcsr_block = BCSR_MIN_BLOCK;
+    }
+    if(MATRIX_convert(ctx, matrix, format) == 0 || matrix->format != format) {return NULL;}
+    return matrix;
+}
+
+int run_case(char *filename, struct format_case test, int threads, double *value, double *expected)
+{
+    SMOPS_CTX *ctx = SMOPS_CTX_new();
+    SMOPS_CTX_set_thread_num(ctx, threads);
+    SMOPS_CTX_set_operation(ctx, test.op);
+    MATRIX *matrix = load_format(ctx, filename, test.format);
+    MATRIX *other = NULL;
+    MATRIX *result = MATRIX_new(ctx);
+    MATRIX_DATA num;
+    int ok = matrix != NULL && result != NULL;
+    if(ok) {
+        *expected = expected_value(matrix, test.op);
+        switch(test.op) {
+            case TRACE:
+                ok = MATRIX_OP_trace(ctx, &num, matrix);
+                break;
+            case TRANSPOSE:
+                ok = MATRIX_OP_transpose(ctx, result, matrix);
+                break;
+            case SCALAR_MULT:
+                ok = MATRIX_OP_scalar_multiplication(ctx, result, matrix, FORMAT_SCALAR);
+                break;
+            case ADD:
+                other = load_format(ctx, filename, test.format);
+                ok = other != NULL && MATRIX_OP_addition(ctx, matrix, other);
+                break;
+            default:
+                other = weight_vector(ctx, matrix->cols);
+                ok = other != NULL && MATRIX_OP_spmv(ctx, matrix, other);
+                break;
+        }
+    }
+    if(ok) {
+        RESULT *res = SMOPS_CTX_take_result(ctx);
+        if(res != NULL && res->result_type == DENSE_MATRIX) {
+            *value = dense_checksum(res);
+        } else {
+            *value = num.f;
+        }
+        SMOPS_RESULT_free(res);
+    } else {
+        SMOPS_CTX_print_err(ctx);
+    }
+    if(matrix != NULL) MATRIX_free(matrix);
+    if(other != NULL) MATRIX_free(other);
+    if(result != NULL) MATRIX_free(result);
+    SMOPS_CTX_free(ctx);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        printf("Usage: %s [float matrix file]\n", argv[0]);
+        return 1;
+    }
+    struct format_case cases[] = {
+        { TRACE, SELL }, { TRACE, DIA }, { TRACE, CSRDU },
+        { SCALAR_MULT, SELL },
+        { TRANSPOSE, DIA },
+        { ADD, BCSR }, { ADD, DIA }, { ADD, DCSR }, { ADD, BITMAP }, { ADD, CSRDU },
+        { MATRIX_VECTOR_MULT, ELL }, { MATRIX_VECTOR_MULT, SELL }, { MATRIX_VECTOR_MULT, BCSR },
+        { MATRIX_VECTOR_MULT, DIA }, { MATRIX_VECTOR_MULT, DCSR }, { MATRIX_VECTOR_MULT, CSB },
+        { MATRIX_VECTOR_MULT, BITMAP }, { MATRIX_VECTOR_MULT, CSRDU }
+    };
+    int thread_nums[] = { 1, 4 };
+    char *op_to_string[] = OP_MAP_STRING;
+    char *format_to_string[] = FORMAT_MAP_STRING;
+    double value, expected;
+    int failed = 0, thread_failed;
+    for(int t = 0; t < 2; t++) {
+        thread_failed = 0;
+        for(int c = 0; c < (int)(sizeof(cases)/sizeof(cases[0])); c++) {
+            if(run_case(argv[1], cases[c], thread_nums[t], &value, &expected) == 0
+                || fabs(value - expected) > 1e-9*(1 + fabs(expected))) {
+                printf("%d threads: %s in %s failed\n", thread_nums[t],
+                    op_to_string[cases[c].op], format_to_string[cases[c].format]);
+                thread_failed++;
+            }
+        }
+        printf("%d threads: %d of %d formats failed\n", thread_nums[t], thread_failed,
+            (int)(sizeof(cases)/sizeof(cases[0])));
+        failed += thread_failed;
+    }
+    return failed > 0;
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "../src/lib/smops.h"
+
+/* Loads a matrix once for mv and runs trace, sum, transpose and scalar
+*  multiplication on views of it from several threads at the same time, every
+*  view has to be planned and converted for its own operation.
+*/
+
+#define VIEW_THREADS 4
+#define VIEW_CALLS 30
+#define VIEW_SCALAR 2.5
+
+struct view_test {
+    SMOPS_CTX *shared;
+    MATRIX *store;
+    OPERATION op;
+    double expected;
+    int failed;
+};
+
+double weight(long pos)
+{
+    return pos%7 + 1;
+}
+
+double dense_checksum(RESULT *result)
+{
+    double checksum = 0;
+    for(long pos = 0; pos < (long)result->rows*result->cols; pos++) {
+        checksum += result->result_data.matrix[pos].f*weight(pos);
+    }
+    return checksum;
+}
+
+double expected_value(MATRIX *store, OPERATION op)
+{
+    COO_DATA *coo = store->coo_data;
+    double expected = 0;
+    long i, j;
+    for(SMOPS_INDEX n = 0; n < store->non_zero_size; n++) {
+        i = coo->coords_i[n];
+        j = coo->coords_j[n];
+        switch(op) {
+            case TRACE:
+                expected += i == j ? coo->values[n].f : 0;
+                break;
+            case ELEMENT_SUM:
+                expected += coo->values[n].f;
+                break;
+            case TRANSPOSE:
+                expected += coo->values[n].f*weight(j*store->rows + i);
+                break;
+            default:
+                expected += VIEW_SCALAR*coo->values[n].f*weight(i*store->cols + j);
+                break;
+        }
+    }
+    return expected;
+}
+
+int run_view(struct view_test *test, double *value)
+{
+    SMOPS_CTX *call = SMOPS_CTX_new_call(test->shared);
+    if(call == NULL) {return 0;}
+    MATRIX *view = MATRIX_view(call, test->store);
+    MATRIX *result = MATRIX_new(call);
+    MATRIX_DATA num;
+    int ok = view != NULL && result != NULL;
+    if(ok) {
+        SMOPS_CTX_set_operation(call, test->op);
+        switch(test->op) {
+            case TRACE:
+                ok = MATRIX_OP_trace(call, &num, view);
+                break;
+            case ELEMENT_SUM:
+                ok = MATRIX_OP_sum(call, &num, view);
+                break;
+            case TRANSPOSE:
+                ok = MATRIX_OP_transpose(call, result, view);
+                break;
+            default:
+                ok = MATRIX_OP_scalar_multiplication(call, result, view, VIEW_SCALAR);
+                break;
+        }
+    }
+    if(ok) {
+        RESULT *res = SMOPS_CTX_take_result(call);
+        if(res != NULL && res->result_type == DENSE_MATRIX) {
+            *value = dense_checksum(res);
+        } else {
+            *value = num.f;
+        }
+        SMOPS_RESULT_free(res);
+    } else {
+        SMOPS_CTX_print_err(call);
+    }
+    if(view != NULL) MATRIX_free(view);
+    if(result != NULL) MATRIX_free(result);
+    SMOPS_CTX_free(call);
+    return ok;
+}
+
+void *view_thread(void *arg)
+{
+    struct view_test *test = (struct view_test *)arg;
+    double value;
+    for(int k = 0; k < VIEW_CALLS; k++) {
+        if(run_view(test, &value) == 0
+            || fabs(value - test->expected) > 1e-9*(1 + fabs(test->expected))) {
+            test->failed++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        printf("Usage: %s [float matrix file]\n", argv[0]);
+        return 1;
+    }
+    SMOPS_CTX *shared = SMOPS_CTX_new();
+    MATRIX *store = MATRIX_new(shared);
+    if(shared == NULL || store == NULL) {return 1;}
+    SMOPS_CTX_set_thread_num(shared, VIEW_THREADS);
+    SMOPS_CTX_set_operation(shared, MATRIX_VECTOR_MULT);
+    if(MATRIX_load(shared, store, argv[1]) == 0 || store->type != FLOAT) {
+        printf("failed to load %s as a float matrix\n", argv[1]);
+        return 1;
+    }
+
+    OPERATION ops[VIEW_THREADS] = { TRACE, ELEMENT_SUM, TRANSPOSE, SCALAR_MULT };
+    char *op_to_string[] = OP_MAP_STRING;
+    struct view_test tests[VIEW_THREADS];
+    pthread_t threads[VIEW_THREADS];
+    for(int t = 0; t < VIEW_THREADS; t++) {
+        tests[t] = (struct view_test){ shared, store, ops[t], expected_value(store, ops[t]), 0 };
+        pthread_create(&threads[t], NULL, view_thread, &tests[t]);
+    }
+    int failed = 0;
+    for(int t = 0; t < VIEW_THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        printf("%s on views of a matrix loaded for mv: %d of %d calls failed\n",
+            op_to_string[ops[t]], tests[t].failed, VIEW_CALLS);
+        failed += tests[t].failed;
+    }
+
+    MATRIX_free(store);
+    SMOPS_CTX_free(shared);
+    return failed > 0;
+}